@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+
+#include <iomanip>
+
+Benchmark::Benchmark(const std::string& name, int warmupFrames, int measureFrames) :
+	name(name), warmupFrames(warmupFrames), measureFrames(measureFrames), mode(0), frame(0)
+{
+}
+
+void Benchmark::addMode(const std::string& modeName)
+{
+	Mode m;
+	m.name = modeName;
+	m.cpuMs = 0.0;
+	m.gpuMs = 0.0;
+	modes.push_back(m);
+}
+
+void Benchmark::addCounter(const std::string& counter, double value)
+{
+	if (isFinished() || isWarmingUp())
+		return;
+	size_t index = 0;
+	while (index < counterNames.size() && counterNames[index] != counter)
+		index++;
+	if (index == counterNames.size())
+		counterNames.push_back(counter);
+	std::vector<double>& counters = modes[mode].counters;
+	if (counters.size() < counterNames.size())
+		counters.resize(counterNames.size(), 0.0);
+	counters[index] += value;
+}
+
+void Benchmark::frameDone(double cpuMs, double gpuMs)
+{
+	if (isFinished())
+		return;
+	if (!isWarmingUp())
+	{
+		modes[mode].cpuMs += cpuMs;
+		modes[mode].gpuMs += gpuMs;
+	}
+	if (++frame == warmupFrames + measureFrames)
+	{
+		frame = 0;
+		mode++;
+	}
+}
+
+void Benchmark::printReport(std::ostream& out) const
+{
+	out << "Benchmark: " << name << " (" << measureFrames << " frames per mode after "
+		<< warmupFrames << " warm-up frames)" << std::endl;
+	out << std::left << std::setw(24) << "mode" << std::right
+		<< std::setw(12) << "cpu ms" << std::setw(12) << "gpu ms";
+	for (size_t i = 0; i < counterNames.size(); i++)
+		out << std::setw(16) << counterNames[i];
+	out << std::endl;
+
+	out << std::fixed << std::setprecision(3);
+	for (size_t m = 0; m < modes.size(); m++)
+	{
+		out << std::left << std::setw(24) << modes[m].name << std::right
+			<< std::setw(12) << modes[m].cpuMs / measureFrames
+			<< std::setw(12) << modes[m].gpuMs / measureFrames;
+		for (size_t i = 0; i < counterNames.size(); i++)
+		{
+			double sum = i < modes[m].counters.size() ? modes[m].counters[i] : 0.0;
+			out << std::setw(16) << sum / measureFrames;
+		}
+		out << std::endl;
+	}
+	out.unsetf(std::ios_base::floatfield);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+// Drives the render loop through a list of modes (configurations to compare),
+// a fixed number of frames each, and prints the averages as a table.
+// The loop asks getMode() which configuration to render with and reports
+// every finished frame with frameDone().
+class Benchmark
+{
+public:
+	Benchmark(const std::string& name, int warmupFrames = 60, int measureFrames = 300);
+
+	void addMode(const std::string& name);
+	// index of the mode the current frame has to be rendered with
+	int getMode() const { return mode; }
+	bool isWarmingUp() const { return frame < warmupFrames; }
+	bool isFinished() const { return mode >= (int)modes.size(); }
+
+	// per-frame value of a custom counter, averaged over the measured frames
+	void addCounter(const std::string& counter, double value);
+	// call once per frame, after the counters
+	void frameDone(double cpuMs, double gpuMs);
+
+	void printReport(std::ostream& out) const;
+private:
+	struct Mode
+	{
+		std::string name;
+		double cpuMs;
+		double gpuMs;
+		std::vector<double> counters;
+	};
+	std::string name;
+	int warmupFrames;
+	int measureFrames;
+	std::vector<Mode> modes;
+	std::vector<std::string> counterNames;
+	int mode;
+	int frame;
+};
+
+#endif
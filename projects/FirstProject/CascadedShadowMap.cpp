@@ -0,0 +1,251 @@
+#include "CascadedShadowMap.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+CascadedShadowMap::CascadedShadowMap(ShaderManager& shaders, int resolution, int cascadeCount) :
+	maxDistance(50.f), splitLambda(0.75f), cacheEnabled(true),
+	resolution(resolution), cascadeCount(std::min(cascadeCount, MAX_CASCADES)),
+	cameraPos(0.f), cameraFront(0.f, 0.f, 1.f), fittedCameraVersion(0), fittedLightDir(0.f),
+	fittedMaxDistance(0.f), fittedSplitLambda(0.f), fittedCasterCount(0)
+{
+	for (int i = 0; i < MAX_CASCADES; i++)
+	{
+		std::string index = "[" + std::to_string(i) + "]";
+		lightSpaceNames[i] = "lightSpaceMatrices" + index;
+		splitNames[i] = "cascadeSplits" + index;
+	}
+
+	// one depth layer per cascade
+	glGenTextures(1, &depthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, this->cascadeCount,
+		0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// linear filtering + compare mode gives hardware 2x2 PCF
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float border[] = { 1.f, 1.f, 1.f, 1.f };
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::SHADOW_MAP::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	depthShader = shaders.load("shaders/shadow_depth.vert", "shaders/shadow_depth.frag");
+
+	for (int i = 0; i < MAX_CASCADES; i++)
+	{
+		cascades[i].lightSpace = glm::mat4(1.f);
+		cascades[i].splitFar = 0.f;
+		cascades[i].texelSize = 0.f;
+		cascades[i].dirty = true;
+		cascades[i].rendered = false;
+		cascades[i].cachedLightSpace = glm::mat4(1.f);
+		cascades[i].cachedCasterHash = 0;
+		cascades[i].valid = false;
+		timers[i] = i < this->cascadeCount ? new GpuTimer() : NULL;
+	}
+}
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+	for (int i = 0; i < MAX_CASCADES; i++)
+		delete timers[i];
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteTextures(1, &depthArray);
+}
+
+void CascadedShadowMap::invalidate()
+{
+	for (int i = 0; i < cascadeCount; i++)
+		cascades[i].valid = false;
+}
+
+void CascadedShadowMap::update(Camera& camera, const glm::vec3& lightDir, const std::vector<ShadowCaster>& casters)
+{
+	cameraPos = camera.Position;
+	cameraFront = camera.Front;
+
+	// nothing the fit depends on has changed: the cascades keep their matrices
+	// and casters, only the ones that lost their depth layer are rendered again
+	bool castersChanged = casters.size() != fittedCasterCount;
+	for (size_t i = 0; i < casters.size() && !castersChanged; i++)
+		castersChanged = casters[i].moved;
+	unsigned int cameraVersion = camera.GetVersion();
+	if (cacheEnabled && !castersChanged && cameraVersion == fittedCameraVersion && lightDir == fittedLightDir
+		&& maxDistance == fittedMaxDistance && splitLambda == fittedSplitLambda)
+	{
+		for (int i = 0; i < cascadeCount; i++)
+			cascades[i].dirty = !cascades[i].valid;
+		return;
+	}
+	fittedCameraVersion = cameraVersion;
+	fittedLightDir = lightDir;
+	fittedMaxDistance = maxDistance;
+	fittedSplitLambda = splitLambda;
+	fittedCasterCount = casters.size();
+
+	float nearZ = camera.zNear;
+	float farZ = std::min(camera.zFar, maxDistance);
+
+	// the light looks along lightDir from the origin; only the fitted ortho box moves
+	glm::vec3 up = std::fabs(lightDir.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.f), glm::normalize(lightDir), up);
+
+	float tanV = tan(glm::radians(camera.Fov) * 0.5f);
+	float tanH = tanV * camera.AspectRatio;
+
+	float splitNear = nearZ;
+	for (int i = 0; i < cascadeCount; i++)
+	{
+		// "practical" split scheme: blend of uniform and logarithmic splits
+		float p = (i + 1) / (float)cascadeCount;
+		float logSplit = nearZ * pow(farZ / nearZ, p);
+		float uniformSplit = nearZ + (farZ - nearZ) * p;
+		float splitFar = uniformSplit + (logSplit - uniformSplit) * splitLambda;
+
+		// corners of the frustum slice in world space
+		glm::vec3 corners[8];
+		int k = 0;
+		for (int d = 0; d < 2; d++)
+		{
+			float depth = d == 0 ? splitNear : splitFar;
+			glm::vec3 c = camera.Position + camera.Front * depth;
+			for (int sy = -1; sy <= 1; sy += 2)
+				for (int sx = -1; sx <= 1; sx += 2)
+					corners[k++] = c + camera.Right * (sx * depth * tanH) + camera.Up * (sy * depth * tanV);
+		}
+
+		cascades[i].splitFar = splitFar;
+		fitCascade(cascades[i], lightView, corners, casters);
+		splitNear = splitFar;
+	}
+}
+
+void CascadedShadowMap::fitCascade(ShadowCascade& cascade, const glm::mat4& lightView, const glm::vec3 corners[8],
+	const std::vector<ShadowCaster>& casters)
+{
+	// bounding sphere of the slice - its size doesn't depend on the camera rotation
+	glm::vec3 center(0.f);
+	for (int i = 0; i < 8; i++)
+		center += corners[i];
+	center /= 8.f;
+	float radius = 0.f;
+	for (int i = 0; i < 8; i++)
+		radius = std::max(radius, glm::length(corners[i] - center));
+	radius = ceil(radius * 16.f) / 16.f;
+
+	// move the box by whole texels only, so the rasterized shadows don't crawl
+	float texel = 2.f * radius / resolution;
+	glm::vec3 lc = glm::vec3(lightView * glm::vec4(center, 1.f));
+	lc.x = floor(lc.x / texel) * texel;
+	lc.y = floor(lc.y / texel) * texel;
+
+	// casters culling: keep spheres that overlap the box in light space and
+	// pull the near plane towards the light to include casters outside the slice
+	float top = lc.z + radius;
+	size_t hash = 0;
+	bool moved = false;
+	cascade.casters.clear();
+	for (size_t i = 0; i < casters.size(); i++)
+	{
+		glm::vec3 c = glm::vec3(lightView * glm::vec4(casters[i].center, 1.f));
+		float r = casters[i].radius;
+		if (std::fabs(c.x - lc.x) > radius + r || std::fabs(c.y - lc.y) > radius + r)
+			continue;
+		if (c.z + r < lc.z - radius) // completely behind the slice
+			continue;
+		cascade.casters.push_back((int)i);
+		top = std::max(top, c.z + r);
+		hash = hash * 31 + i + 1;
+		moved = moved || casters[i].moved;
+	}
+
+	// whole units, so small motion of casters doesn't change the matrix
+	float nearPlane = floor(-top);
+	float farPlane = ceil(-(lc.z - radius));
+	glm::mat4 projection = glm::ortho(lc.x - radius, lc.x + radius, lc.y - radius, lc.y + radius, nearPlane, farPlane);
+	cascade.lightSpace = projection * lightView;
+	cascade.texelSize = texel;
+
+	cascade.dirty = !cacheEnabled || !cascade.valid || moved
+		|| hash != cascade.cachedCasterHash
+		|| cascade.lightSpace != cascade.cachedLightSpace;
+	cascade.cachedCasterHash = hash;
+}
+
+void CascadedShadowMap::render(const std::vector<ShadowCaster>& casters)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, resolution, resolution);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	// back faces + slope bias keep acne away from lit surfaces
+	glCullFace(GL_FRONT);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+	depthShader->use();
+
+	for (int i = 0; i < cascadeCount; i++)
+	{
+		ShadowCascade& cascade = cascades[i];
+		cascade.rendered = false;
+		if (!cascade.dirty)
+			continue;
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		timers[i]->begin();
+		depthShader->setMatrix4f("lightSpace", cascade.lightSpace);
+		for (size_t j = 0; j < cascade.casters.size(); j++)
+		{
+			const ShadowCaster& caster = casters[cascade.casters[j]];
+			glm::mat4 model = caster.model;
+			depthShader->setMatrix4f("model", model);
+			glBindVertexArray(caster.VAO);
+			glDrawArrays(GL_TRIANGLES, 0, caster.vertexCount);
+		}
+		timers[i]->end();
+
+		cascade.cachedLightSpace = cascade.lightSpace;
+		cascade.valid = true;
+		cascade.rendered = true;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glCullFace(GL_BACK);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+// the shader has to be in use
+void CascadedShadowMap::apply(Shader& shader, int textureUnit)
+{
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.setInt("shadowMap", textureUnit);
+	shader.setInt("cascadeCount", cascadeCount);
+	shader.setVec3("shadowCameraPos", cameraPos);
+	shader.setVec3("shadowCameraFront", cameraFront);
+	for (int i = 0; i < cascadeCount; i++)
+	{
+		shader.setMatrix4f(lightSpaceNames[i], cascades[i].lightSpace);
+		shader.setFloat(splitNames[i], cascades[i].splitFar);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "ShaderManager.h"
+#include "camera.h"
+#include "GpuTimer.h"
+
+// must match MAX_CASCADES in shaders/shadow.glsl, the include basic.frag gets it from
+const int MAX_CASCADES = 4;
+
+// Everything the shadow pass needs to know about an object
+struct ShadowCaster
+{
+	glm::mat4 model;
+	glm::vec3 center;   // world space bounding sphere
+	float radius;
+	GLuint VAO;
+	GLsizei vertexCount;
+	bool moved;         // transform changed since the previous frame
+};
+
+struct ShadowCascade
+{
+	glm::mat4 lightSpace;       // light projection * light view
+	float splitFar;             // view depth where the cascade ends
+	float texelSize;            // world units covered by one shadow map texel
+	std::vector<int> casters;   // indices of the casters that touch the cascade
+	bool dirty;                 // has to be re-rendered this frame
+	bool rendered;              // was re-rendered this frame (false = cached)
+
+	// state the cached depth layer was rendered with
+	glm::mat4 cachedLightSpace;
+	size_t cachedCasterHash;
+	bool valid;
+};
+
+// Shadow maps for a directional light, split along the camera view depth.
+// Every cascade is fitted with a bounding sphere of its frustum slice and
+// snapped to whole texels, so it doesn't shimmer when the camera moves.
+// Cascades keep their depth layer while neither the fitted matrix nor their
+// casters change.
+class CascadedShadowMap
+{
+public:
+	float maxDistance;  // no shadows further than this from the camera
+	float splitLambda;  // 0 - uniform splits, 1 - logarithmic splits
+	bool cacheEnabled;  // re-render only cascades whose contents moved
+
+	// the depth program is built by the manager, usable after its finish()
+	CascadedShadowMap(ShaderManager& shaders, int resolution, int cascadeCount = MAX_CASCADES);
+	~CascadedShadowMap();
+
+	// fit cascades to the camera frustum and pick casters for each of them
+	void update(Camera& camera, const glm::vec3& lightDir, const std::vector<ShadowCaster>& casters);
+	// render the depth of dirty cascades
+	void render(const std::vector<ShadowCaster>& casters);
+	// set matrices, splits and the shadow texture for a lit shader
+	void apply(Shader& shader, int textureUnit);
+	// drop cached cascades
+	void invalidate();
+
+	int getCascadeCount() const { return cascadeCount; }
+	int getResolution() const { return resolution; }
+	const ShadowCascade& getCascade(int i) const { return cascades[i]; }
+	// GPU time of the last real render of the cascade in milliseconds
+	float getCascadeGpuMs(int i) { return timers[i]->getMs(); }
+private:
+	int resolution;
+	int cascadeCount;
+	ShadowCascade cascades[MAX_CASCADES];
+	GpuTimer* timers[MAX_CASCADES];
+	glm::vec3 cameraPos;
+	glm::vec3 cameraFront;
+	// "lightSpaceMatrices[i]" and "cascadeSplits[i]", built once so apply() doesn't allocate
+	std::string lightSpaceNames[MAX_CASCADES];
+	std::string splitNames[MAX_CASCADES];
+	// what the cascades were last fitted to
+	unsigned int fittedCameraVersion;
+	glm::vec3 fittedLightDir;
+	float fittedMaxDistance, fittedSplitLambda;
+	size_t fittedCasterCount;
+
+	GLuint depthArray;
+	GLuint FBO;
+	Shader* depthShader;
+
+	void fitCascade(ShadowCascade& cascade, const glm::mat4& lightView, const glm::vec3 corners[8],
+		const std::vector<ShadowCaster>& casters);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float SCALE_STEP = 0.05f;
+	const int COOLDOWN_FRAMES = 15;
+	const float SMOOTHING = 0.1f;       // weight of the newest frame time
+	const float HEADROOM = 0.85f;       // scale up only below this part of the budget
+}
+
+DynamicResolution::DynamicResolution(ShaderManager& shaders, float budgetMs, float minScale, float maxScale) :
+	enabled(true), budgetMs(budgetMs), minScale(minScale), maxScale(maxScale), sharpness(0.5f),
+	scale(maxScale), smoothedMs(0.f), cooldown(0)
+{
+	upscaleShader = shaders.load("shaders/fullscreen.vert", "shaders/upscale_sharpen.frag");
+	glGenVertexArrays(1, &emptyVAO);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void DynamicResolution::update(float gpuMs)
+{
+	// the timer has no result yet
+	if (gpuMs <= 0.f)
+		return;
+	smoothedMs = smoothedMs == 0.f ? gpuMs : smoothedMs + (gpuMs - smoothedMs) * SMOOTHING;
+
+	if (!enabled)
+	{
+		scale = maxScale;
+		return;
+	}
+	if (cooldown > 0)
+	{
+		cooldown--;
+		return;
+	}
+
+	// the cost of the scene is roughly proportional to the pixel count, i.e. scale^2
+	float target = scale;
+	if (smoothedMs > budgetMs)
+		target = scale * std::sqrt(budgetMs / smoothedMs);
+	else if (smoothedMs < budgetMs * HEADROOM)
+		target = scale * std::sqrt(budgetMs * HEADROOM / smoothedMs);
+	// whole steps, at most two per change
+	float steps = std::max(-2.f, std::min(2.f, std::round((target - scale) / SCALE_STEP)));
+	float newScale = std::max(minScale, std::min(maxScale, scale + steps * SCALE_STEP));
+	if (newScale != scale)
+	{
+		scale = newScale;
+		cooldown = COOLDOWN_FRAMES;
+	}
+}
+
+int DynamicResolution::scaledWidth(int screenWidth) const
+{
+	return std::max((int)(screenWidth * scale), 1);
+}
+
+int DynamicResolution::scaledHeight(int screenHeight) const
+{
+	return std::max((int)(screenHeight * scale), 1);
+}
+
+void DynamicResolution::present(RenderTarget& scene, int screenWidth, int screenHeight)
+{
+	if (scene.getWidth() >= screenWidth && scene.getHeight() >= screenHeight)
+	{
+		scene.blitToScreen(screenWidth, screenHeight);
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, screenWidth, screenHeight);
+	glDisable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	upscaleShader->use();
+	upscaleShader->setInt("source", 0);
+	upscaleShader->setFloat("sharpness", sharpness);
+	glBindTexture(GL_TEXTURE_2D, scene.getColorTexture());
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glEnable(GL_DEPTH_TEST);
+}
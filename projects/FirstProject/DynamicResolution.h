@@ -0,0 +1,47 @@
+#pragma once
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "ShaderManager.h"
+#include "RenderTarget.h"
+
+// Scales the resolution of the offscreen scene so that the GPU frame time
+// stays within a budget, and upscales the result to the window with a
+// sharpening filter. The scale moves in fixed steps and waits a few frames
+// after each change, because GPU times arrive with a delay of several frames.
+class DynamicResolution
+{
+public:
+	bool enabled;
+	float budgetMs;     // target GPU time per frame
+	float minScale;     // bounds of the per-axis scale
+	float maxScale;
+	float sharpness;    // 0 - plain bilinear upscale, 1 - strongest sharpening
+
+	// the upscale program is built by the manager, usable after its finish()
+	DynamicResolution(ShaderManager& shaders, float budgetMs = 16.6f, float minScale = 0.5f, float maxScale = 1.f);
+	~DynamicResolution();
+
+	// feed the latest measured GPU frame time, once per frame
+	void update(float gpuMs);
+	// size of the scene target for a window of the given size
+	int scaledWidth(int screenWidth) const;
+	int scaledHeight(int screenHeight) const;
+	// copy the scene to the default framebuffer, upscaled and sharpened if it is smaller
+	void present(RenderTarget& scene, int screenWidth, int screenHeight);
+
+	float getScale() const { return scale; }
+	float getSmoothedMs() const { return smoothedMs; }
+private:
+	float scale;
+	float smoothedMs;
+	int cooldown;       // frames left before the next change
+
+	Shader* upscaleShader;
+	GLuint emptyVAO;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<long long> allocations(0);
+	thread_local long long threadAllocations = 0;
+
+	void* CountedMalloc(size_t size)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		threadAllocations++;
+		return malloc(size ? size : 1);
+	}
+
+	size_t AlignUp(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* p = CountedMalloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = CountedMalloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedMalloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedMalloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+long long HeapCounter::getAllocations()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+long long HeapCounter::getThreadAllocations()
+{
+	return threadAllocations;
+}
+
+FrameArena::FrameArena(size_t capacity) : capacity(capacity), used(0), overflowBytes(0), highWater(0), overflowCount(0)
+{
+	block = new unsigned char[capacity];
+}
+
+FrameArena::~FrameArena()
+{
+	reset();
+	delete[] block;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+	// aligned by address, the block itself is only max_align_t aligned
+	uintptr_t base = (uintptr_t)block;
+	size_t offset = AlignUp(base + used, alignment) - base;
+	if (offset + size <= capacity)
+	{
+		used = offset + size;
+		return block + offset;
+	}
+	// until the reset, anything that doesn't fit gets its own block
+	unsigned char* extra = new unsigned char[size + alignment];
+	overflow.push_back(extra);
+	overflowBytes += size + alignment;
+	return (void*)AlignUp((uintptr_t)extra, alignment);
+}
+
+void FrameArena::reset()
+{
+	highWater = std::max(highWater, used + overflowBytes);
+	if (!overflow.empty())
+	{
+		for (size_t i = 0; i < overflow.size(); i++)
+			delete[] overflow[i];
+		std::vector<unsigned char*>().swap(overflow);
+		overflowCount++;
+		// room for the whole frame next time, with a margin for growth
+		delete[] block;
+		capacity = highWater + highWater / 4;
+		block = new unsigned char[capacity];
+	}
+	used = 0;
+	overflowBytes = 0;
+}
+
+FrameAllocator::FrameAllocator(int threadCount, size_t arenaBytes) : frames(threadCount, 0)
+{
+	for (int i = 0; i < threadCount * FRAMES; i++)
+		arenas.push_back(new FrameArena(arenaBytes));
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	for (size_t i = 0; i < arenas.size(); i++)
+		delete arenas[i];
+}
+
+FrameArena& FrameAllocator::beginFrame(int thread)
+{
+	frames[thread]++;
+	FrameArena& arena = current(thread);
+	arena.reset();
+	return arena;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <vector>
+
+// Bump allocator: allocations are carved one after another out of a block and
+// all of them are freed at once by reset(). When the block runs out, extra
+// blocks are taken from the heap until the reset, which then grows the block
+// to what the frame needed, so a steady frame loop stops touching the heap.
+// Only one thread may use an arena at a time.
+class FrameArena
+{
+public:
+	FrameArena(size_t capacity);
+	~FrameArena();
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	template <typename T>
+	T* allocateArray(size_t count) { return (T*)allocate(count * sizeof(T), alignof(T)); }
+	// frees everything allocated since the last reset
+	void reset();
+
+	size_t getUsed() const { return used + overflowBytes; }
+	size_t getCapacity() const { return capacity; }
+	// the most a frame has used
+	size_t getHighWater() const { return highWater; }
+	// frames that didn't fit in the block
+	int getOverflowCount() const { return overflowCount; }
+private:
+	unsigned char* block;
+	size_t capacity;
+	size_t used;
+	std::vector<unsigned char*> overflow; // freed at the reset
+	size_t overflowBytes;
+	size_t highWater;
+	int overflowCount;
+};
+
+// Frame scoped memory: every thread that builds per frame data gets two
+// arenas and alternates between them frame by frame. What a thread allocated
+// in a frame stays valid during its next frame, so data handed from the
+// simulation to the renderer lives until the renderer is done with it, as
+// long as the two run at most one frame apart.
+class FrameAllocator
+{
+public:
+	static const int FRAMES = 2;
+
+	FrameAllocator(int threadCount, size_t arenaBytes);
+	~FrameAllocator();
+	int getThreadCount() const { return (int)arenas.size() / FRAMES; }
+
+	// starts a frame of the thread: its arena of two frames ago is reset and becomes current
+	FrameArena& beginFrame(int thread);
+	FrameArena& current(int thread) { return *arenas[thread * FRAMES + frames[thread] % FRAMES]; }
+	// what the thread allocated in its previous frame
+	FrameArena& previous(int thread) { return *arenas[thread * FRAMES + (frames[thread] + 1) % FRAMES]; }
+private:
+	std::vector<FrameArena*> arenas;
+	std::vector<unsigned int> frames;
+};
+
+// STL allocator on an arena; deallocate() does nothing, the memory comes back
+// at the reset. Containers must not outlive the frame of their arena.
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+	T* allocate(size_t count) { return arena->allocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+	FrameArena* getArena() const { return arena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.getArena(); }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.getArena(); }
+private:
+	FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T> >;
+
+// Counts the calls of the global operator new, which this module replaces, so
+// a loop can check that it doesn't allocate. Memory that C code or drivers
+// take with malloc directly isn't seen.
+class HeapCounter
+{
+public:
+	// of every thread since the start
+	static long long getAllocations();
+	// of the calling thread
+	static long long getThreadAllocations();
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	const double DELTA_SMOOTHING = 0.1;
+}
+
+FramePacer::FramePacer() :
+	swapInterval(1), targetFps(0.0), started(false),
+	deltaTime(0.0), smoothedDelta(0.0), historyCount(0), historyPos(0), jitterMs(0.0), waitMs(0.0),
+	sleepMean(1e-3), sleepM2(0.0), sleepCount(1)
+{
+	for (int i = 0; i < HISTORY; i++)
+		frameMs[i] = 0.0;
+}
+
+void FramePacer::setSwapInterval(int interval)
+{
+	// negative intervals need the swap control tear extension
+	if (interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+		&& !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		interval = 1;
+	swapInterval = interval;
+	glfwSwapInterval(interval);
+}
+
+void FramePacer::setTargetFps(double fps)
+{
+	targetFps = std::max(fps, 0.0);
+	started = false;
+}
+
+double FramePacer::beginFrame()
+{
+	Clock::time_point now = Clock::now();
+	if (!started)
+	{
+		lastFrame = now;
+		deadline = now;
+		started = true;
+		deltaTime = 0.0;
+		return deltaTime;
+	}
+	deltaTime = std::chrono::duration<double>(now - lastFrame).count();
+	lastFrame = now;
+
+	// a long stall (window drag, breakpoint) shouldn't throw the smoothed value off for seconds
+	double clamped = std::min(deltaTime, 0.25);
+	smoothedDelta = smoothedDelta == 0.0 ? clamped : smoothedDelta + (clamped - smoothedDelta) * DELTA_SMOOTHING;
+
+	frameMs[historyPos] = deltaTime * 1000.0;
+	historyPos = (historyPos + 1) % HISTORY;
+	historyCount = std::min(historyCount + 1, HISTORY);
+	double mean = 0.0;
+	for (int i = 0; i < historyCount; i++)
+		mean += frameMs[i];
+	mean /= historyCount;
+	double variance = 0.0;
+	for (int i = 0; i < historyCount; i++)
+		variance += (frameMs[i] - mean) * (frameMs[i] - mean);
+	jitterMs = std::sqrt(variance / historyCount);
+	return deltaTime;
+}
+
+void FramePacer::waitForFrame()
+{
+	waitMs = 0.0;
+	if (targetFps <= 0.0)
+		return;
+
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+	Clock::time_point now = Clock::now();
+	deadline += period;
+	// more than a frame behind: start over instead of rushing frames to catch up
+	if (deadline < now - period)
+		deadline = now;
+	if (deadline <= now)
+		return;
+
+	preciseWait(deadline);
+	waitMs = std::chrono::duration<double, std::milli>(Clock::now() - now).count();
+}
+
+void FramePacer::preciseWait(Clock::time_point until)
+{
+	// sleep in 1ms slices while the remaining time is safely longer than a sleep
+	// usually takes (mean + 2 standard deviations), then spin
+	while (true)
+	{
+		double remaining = std::chrono::duration<double>(until - Clock::now()).count();
+		double estimate = sleepMean + 2.0 * std::sqrt(sleepM2 / std::max(sleepCount - 1, 1L));
+		if (remaining <= estimate)
+			break;
+
+		Clock::time_point start = Clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double slept = std::chrono::duration<double>(Clock::now() - start).count();
+
+		// Welford's online mean and variance
+		sleepCount++;
+		double delta = slept - sleepMean;
+		sleepMean += delta / sleepCount;
+		sleepM2 += delta * (slept - sleepMean);
+	}
+	while (Clock::now() < until)
+		std::this_thread::yield();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+
+// Keeps the loop at a fixed cadence: sets the swap interval and, with a
+// target frame rate, waits before the swap with a hybrid limiter - sleep
+// while far from the deadline, then spin for the last part that the OS
+// sleep can't hit precisely. Also measures the frame times: raw and smoothed
+// delta time and the jitter (standard deviation of the frame time).
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// 0 - no vsync, 1 - every vblank, -1 - adaptive vsync if the driver supports it
+	void setSwapInterval(int interval);
+	int getSwapInterval() const { return swapInterval; }
+	// 0 - unlimited
+	void setTargetFps(double fps);
+	double getTargetFps() const { return targetFps; }
+
+	// call once at the start of a frame; returns the raw delta time in seconds
+	double beginFrame();
+	// call right before glfwSwapBuffers
+	void waitForFrame();
+
+	double getDeltaTime() const { return deltaTime; }
+	// exponentially smoothed delta time, in seconds, for movement and animation
+	double getSmoothedDeltaTime() const { return smoothedDelta; }
+	// standard deviation of the frame time over the last frames, in milliseconds
+	double getJitterMs() const { return jitterMs; }
+	// time spent in waitForFrame() during the last frame, in milliseconds
+	double getWaitMs() const { return waitMs; }
+private:
+	typedef std::chrono::steady_clock Clock;
+	static const int HISTORY = 120;
+
+	int swapInterval;
+	double targetFps;
+	Clock::time_point lastFrame;
+	Clock::time_point deadline;
+	bool started;
+
+	double deltaTime;
+	double smoothedDelta;
+	double frameMs[HISTORY];
+	int historyCount;
+	int historyPos;
+	double jitterMs;
+	double waitMs;
+
+	// running estimate of how long a 1ms sleep really takes
+	double sleepMean;
+	double sleepM2;
+	long sleepCount;
+
+	void preciseWait(Clock::time_point until);
+};
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// View frustum as 6 planes (left, right, bottom, top, near, far) facing inside,
+// extracted from a projection-view matrix
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    Frustum() {}
+
+    explicit Frustum(const glm::mat4& pv)
+    {
+        // rows of the matrix (glm is column-major)
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(pv[0][i], pv[1][i], pv[2][i], pv[3][i]);
+        planes[0] = row[3] + row[0];
+        planes[1] = row[3] - row[0];
+        planes[2] = row[3] + row[1];
+        planes[3] = row[3] - row[1];
+        planes[4] = row[3] + row[2];
+        planes[5] = row[3] - row[2];
+        for (int i = 0; i < 6; i++)
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+
+    // axis aligned box given by its center and half size
+    bool intersectsBox(const glm::vec3& center, const glm::vec3& extent) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 normal = glm::vec3(planes[i]);
+            float radius = glm::dot(extent, glm::abs(normal));
+            if (glm::dot(normal, center) + planes[i].w + radius < 0.f)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (int i = 0; i < 6; i++)
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w + radius < 0.f)
+                return false;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,1157 @@
+#include "GLCapture.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// the glad pointers the wrappers forward to
+	struct RealFunctions
+	{
+		PFNGLGENBUFFERSPROC GenBuffers;
+		PFNGLDELETEBUFFERSPROC DeleteBuffers;
+		PFNGLGENVERTEXARRAYSPROC GenVertexArrays;
+		PFNGLDELETEVERTEXARRAYSPROC DeleteVertexArrays;
+		PFNGLGENTEXTURESPROC GenTextures;
+		PFNGLDELETETEXTURESPROC DeleteTextures;
+		PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+		PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+		PFNGLGENRENDERBUFFERSPROC GenRenderbuffers;
+		PFNGLDELETERENDERBUFFERSPROC DeleteRenderbuffers;
+		PFNGLCREATESHADERPROC CreateShader;
+		PFNGLDELETESHADERPROC DeleteShader;
+		PFNGLSHADERSOURCEPROC ShaderSource;
+		PFNGLCOMPILESHADERPROC CompileShader;
+		PFNGLCREATEPROGRAMPROC CreateProgram;
+		PFNGLDELETEPROGRAMPROC DeleteProgram;
+		PFNGLATTACHSHADERPROC AttachShader;
+		PFNGLLINKPROGRAMPROC LinkProgram;
+		PFNGLTRANSFORMFEEDBACKVARYINGSPROC TransformFeedbackVaryings;
+		PFNGLUSEPROGRAMPROC UseProgram;
+		PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+		PFNGLUNIFORM1IPROC Uniform1i;
+		PFNGLUNIFORM1FPROC Uniform1f;
+		PFNGLUNIFORM2FPROC Uniform2f;
+		PFNGLUNIFORM3FPROC Uniform3f;
+		PFNGLUNIFORM4FPROC Uniform4f;
+		PFNGLUNIFORMMATRIX4FVPROC UniformMatrix4fv;
+		PFNGLBINDBUFFERPROC BindBuffer;
+		PFNGLBINDBUFFERBASEPROC BindBufferBase;
+		PFNGLBUFFERDATAPROC BufferData;
+		PFNGLBUFFERSUBDATAPROC BufferSubData;
+		PFNGLGETBUFFERSUBDATAPROC GetBufferSubData;
+		PFNGLBINDVERTEXARRAYPROC BindVertexArray;
+		PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+		PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+		PFNGLVERTEXATTRIBDIVISORPROC VertexAttribDivisor;
+		PFNGLVERTEXATTRIB1FPROC VertexAttrib1f;
+		PFNGLACTIVETEXTUREPROC ActiveTexture;
+		PFNGLBINDTEXTUREPROC BindTexture;
+		PFNGLTEXIMAGE2DPROC TexImage2D;
+		PFNGLTEXIMAGE3DPROC TexImage3D;
+		PFNGLTEXSUBIMAGE2DPROC TexSubImage2D;
+		PFNGLTEXSUBIMAGE3DPROC TexSubImage3D;
+		PFNGLTEXPARAMETERIPROC TexParameteri;
+		PFNGLTEXPARAMETERFVPROC TexParameterfv;
+		PFNGLGENERATEMIPMAPPROC GenerateMipmap;
+		PFNGLPIXELSTOREIPROC PixelStorei;
+		PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+		PFNGLFRAMEBUFFERTEXTURE2DPROC FramebufferTexture2D;
+		PFNGLFRAMEBUFFERTEXTURELAYERPROC FramebufferTextureLayer;
+		PFNGLFRAMEBUFFERRENDERBUFFERPROC FramebufferRenderbuffer;
+		PFNGLBINDRENDERBUFFERPROC BindRenderbuffer;
+		PFNGLRENDERBUFFERSTORAGEPROC RenderbufferStorage;
+		PFNGLDRAWBUFFERPROC DrawBuffer;
+		PFNGLREADBUFFERPROC ReadBuffer;
+		PFNGLBLITFRAMEBUFFERPROC BlitFramebuffer;
+		PFNGLENABLEPROC Enable;
+		PFNGLDISABLEPROC Disable;
+		PFNGLVIEWPORTPROC Viewport;
+		PFNGLPOLYGONMODEPROC PolygonMode;
+		PFNGLPOLYGONOFFSETPROC PolygonOffset;
+		PFNGLDEPTHMASKPROC DepthMask;
+		PFNGLDEPTHFUNCPROC DepthFunc;
+		PFNGLCOLORMASKPROC ColorMask;
+		PFNGLCULLFACEPROC CullFace;
+		PFNGLFRONTFACEPROC FrontFace;
+		PFNGLCLEARCOLORPROC ClearColor;
+		PFNGLCLEARPROC Clear;
+		PFNGLDRAWARRAYSPROC DrawArrays;
+		PFNGLDRAWELEMENTSPROC DrawElements;
+		PFNGLDRAWELEMENTSINSTANCEDPROC DrawElementsInstanced;
+		PFNGLBEGINTRANSFORMFEEDBACKPROC BeginTransformFeedback;
+		PFNGLENDTRANSFORMFEEDBACKPROC EndTransformFeedback;
+		PFNGLFLUSHPROC Flush;
+		PFNGLFINISHPROC Finish;
+	};
+
+	RealFunctions real;
+	GLFWwindow* captureWindow = NULL;
+	bool recording = false;
+	std::vector<unsigned char> stream;
+	// the unpack state decides how many bytes glTex(Sub)Image reads
+	GLint unpackAlignment = 4;
+	GLint unpackRowLength = 0;
+
+	bool Recording()
+	{
+		return recording && glfwGetCurrentContext() == captureWindow;
+	}
+
+	template <typename T>
+	void Put(const T& value)
+	{
+		const unsigned char* bytes = (const unsigned char*)&value;
+		stream.insert(stream.end(), bytes, bytes + sizeof(T));
+	}
+
+	void PutOp(GLCapture::Op op)
+	{
+		stream.push_back((unsigned char)op);
+	}
+
+	// size followed by the bytes; NULL data is stored as size 0
+	void PutBlob(const void* data, size_t size)
+	{
+		if (!data)
+			size = 0;
+		Put((unsigned int)size);
+		const unsigned char* bytes = (const unsigned char*)data;
+		if (size)
+			stream.insert(stream.end(), bytes, bytes + size);
+	}
+
+	void PutNames(GLCapture::Op op, GLsizei n, const GLuint* names)
+	{
+		PutOp(op);
+		Put(n);
+		PutBlob(names, n * sizeof(GLuint));
+	}
+
+	// bytes glTexImage reads from client memory, with the current unpack state
+	size_t ImageSize(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type)
+	{
+		size_t components = 4;
+		switch (format)
+		{
+		case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: case GL_DEPTH_STENCIL:
+			components = 1;
+			break;
+		case GL_RG: case GL_RG_INTEGER:
+			components = 2;
+			break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+			components = 3;
+			break;
+		}
+		size_t pixel;
+		switch (type)
+		{
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			pixel = components * 2;
+			break;
+		case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+			pixel = components * 4;
+			break;
+		case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+			pixel = 4;  // packed, the whole pixel
+			break;
+		case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+			pixel = 2;
+			break;
+		default:
+			pixel = components;
+			break;
+		}
+		size_t rows = (size_t)height * depth;
+		if (width <= 0 || rows == 0)
+			return 0;
+		size_t rowLength = unpackRowLength > 0 ? unpackRowLength : width;
+		size_t alignment = unpackAlignment > 0 ? unpackAlignment : 1;
+		size_t rowBytes = (rowLength * pixel + alignment - 1) / alignment * alignment;
+		// the last row isn't padded
+		return rowBytes * (rows - 1) + width * pixel;
+	}
+
+	void APIENTRY CaptureGenBuffers(GLsizei n, GLuint* buffers)
+	{
+		real.GenBuffers(n, buffers);
+		if (Recording())
+			PutNames(GLCapture::OP_GEN_BUFFERS, n, buffers);
+	}
+
+	void APIENTRY CaptureDeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		if (Recording())
+			PutNames(GLCapture::OP_DELETE_BUFFERS, n, buffers);
+		real.DeleteBuffers(n, buffers);
+	}
+
+	void APIENTRY CaptureGenVertexArrays(GLsizei n, GLuint* arrays)
+	{
+		real.GenVertexArrays(n, arrays);
+		if (Recording())
+			PutNames(GLCapture::OP_GEN_VERTEX_ARRAYS, n, arrays);
+	}
+
+	void APIENTRY CaptureDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+	{
+		if (Recording())
+			PutNames(GLCapture::OP_DELETE_VERTEX_ARRAYS, n, arrays);
+		real.DeleteVertexArrays(n, arrays);
+	}
+
+	void APIENTRY CaptureGenTextures(GLsizei n, GLuint* textures)
+	{
+		real.GenTextures(n, textures);
+		if (Recording())
+			PutNames(GLCapture::OP_GEN_TEXTURES, n, textures);
+	}
+
+	void APIENTRY CaptureDeleteTextures(GLsizei n, const GLuint* textures)
+	{
+		if (Recording())
+			PutNames(GLCapture::OP_DELETE_TEXTURES, n, textures);
+		real.DeleteTextures(n, textures);
+	}
+
+	void APIENTRY CaptureGenFramebuffers(GLsizei n, GLuint* framebuffers)
+	{
+		real.GenFramebuffers(n, framebuffers);
+		if (Recording())
+			PutNames(GLCapture::OP_GEN_FRAMEBUFFERS, n, framebuffers);
+	}
+
+	void APIENTRY CaptureDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+	{
+		if (Recording())
+			PutNames(GLCapture::OP_DELETE_FRAMEBUFFERS, n, framebuffers);
+		real.DeleteFramebuffers(n, framebuffers);
+	}
+
+	void APIENTRY CaptureGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+	{
+		real.GenRenderbuffers(n, renderbuffers);
+		if (Recording())
+			PutNames(GLCapture::OP_GEN_RENDERBUFFERS, n, renderbuffers);
+	}
+
+	void APIENTRY CaptureDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+	{
+		if (Recording())
+			PutNames(GLCapture::OP_DELETE_RENDERBUFFERS, n, renderbuffers);
+		real.DeleteRenderbuffers(n, renderbuffers);
+	}
+
+	GLuint APIENTRY CaptureCreateShader(GLenum type)
+	{
+		GLuint shader = real.CreateShader(type);
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_CREATE_SHADER);
+			Put(type);
+			Put(shader);
+		}
+		return shader;
+	}
+
+	void APIENTRY CaptureDeleteShader(GLuint shader)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DELETE_SHADER);
+			Put(shader);
+		}
+		real.DeleteShader(shader);
+	}
+
+	void APIENTRY CaptureShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+	{
+		if (Recording())
+		{
+			// the pieces are stored joined
+			std::string source;
+			for (GLsizei i = 0; i < count; i++)
+				if (length && length[i] >= 0)
+					source.append(string[i], length[i]);
+				else
+					source.append(string[i]);
+			PutOp(GLCapture::OP_SHADER_SOURCE);
+			Put(shader);
+			PutBlob(source.data(), source.size());
+		}
+		real.ShaderSource(shader, count, string, length);
+	}
+
+	void APIENTRY CaptureCompileShader(GLuint shader)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_COMPILE_SHADER);
+			Put(shader);
+		}
+		real.CompileShader(shader);
+	}
+
+	GLuint APIENTRY CaptureCreateProgram()
+	{
+		GLuint program = real.CreateProgram();
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_CREATE_PROGRAM);
+			Put(program);
+		}
+		return program;
+	}
+
+	void APIENTRY CaptureDeleteProgram(GLuint program)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DELETE_PROGRAM);
+			Put(program);
+		}
+		real.DeleteProgram(program);
+	}
+
+	void APIENTRY CaptureAttachShader(GLuint program, GLuint shader)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_ATTACH_SHADER);
+			Put(program);
+			Put(shader);
+		}
+		real.AttachShader(program, shader);
+	}
+
+	void APIENTRY CaptureLinkProgram(GLuint program)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_LINK_PROGRAM);
+			Put(program);
+		}
+		real.LinkProgram(program);
+	}
+
+	void APIENTRY CaptureTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar* const* varyings, GLenum bufferMode)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TRANSFORM_FEEDBACK_VARYINGS);
+			Put(program);
+			Put(bufferMode);
+			Put(count);
+			for (GLsizei i = 0; i < count; i++)
+				PutBlob(varyings[i], strlen(varyings[i]));
+		}
+		real.TransformFeedbackVaryings(program, count, varyings, bufferMode);
+	}
+
+	void APIENTRY CaptureUseProgram(GLuint program)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_USE_PROGRAM);
+			Put(program);
+		}
+		real.UseProgram(program);
+	}
+
+	GLint APIENTRY CaptureGetUniformLocation(GLuint program, const GLchar* name)
+	{
+		// the replay looks the name up again and maps the locations
+		GLint location = real.GetUniformLocation(program, name);
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_GET_UNIFORM_LOCATION);
+			Put(program);
+			Put(location);
+			PutBlob(name, strlen(name));
+		}
+		return location;
+	}
+
+	void APIENTRY CaptureUniform1i(GLint location, GLint v0)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_1I);
+			Put(location);
+			Put(v0);
+		}
+		real.Uniform1i(location, v0);
+	}
+
+	void APIENTRY CaptureUniform1f(GLint location, GLfloat v0)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_1F);
+			Put(location);
+			Put(v0);
+		}
+		real.Uniform1f(location, v0);
+	}
+
+	void APIENTRY CaptureUniform2f(GLint location, GLfloat v0, GLfloat v1)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_2F);
+			Put(location);
+			Put(v0);
+			Put(v1);
+		}
+		real.Uniform2f(location, v0, v1);
+	}
+
+	void APIENTRY CaptureUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_3F);
+			Put(location);
+			Put(v0);
+			Put(v1);
+			Put(v2);
+		}
+		real.Uniform3f(location, v0, v1, v2);
+	}
+
+	void APIENTRY CaptureUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_4F);
+			Put(location);
+			Put(v0);
+			Put(v1);
+			Put(v2);
+			Put(v3);
+		}
+		real.Uniform4f(location, v0, v1, v2, v3);
+	}
+
+	void APIENTRY CaptureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_UNIFORM_MATRIX_4FV);
+			Put(location);
+			Put(transpose);
+			PutBlob(value, count * 16 * sizeof(GLfloat));
+		}
+		real.UniformMatrix4fv(location, count, transpose, value);
+	}
+
+	void APIENTRY CaptureBindBuffer(GLenum target, GLuint buffer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_BUFFER);
+			Put(target);
+			Put(buffer);
+		}
+		real.BindBuffer(target, buffer);
+	}
+
+	void APIENTRY CaptureBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_BUFFER_BASE);
+			Put(target);
+			Put(index);
+			Put(buffer);
+		}
+		real.BindBufferBase(target, index, buffer);
+	}
+
+	void APIENTRY CaptureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BUFFER_DATA);
+			Put(target);
+			Put(usage);
+			Put((long long)size);
+			PutBlob(data, size);
+		}
+		real.BufferData(target, size, data, usage);
+	}
+
+	void APIENTRY CaptureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BUFFER_SUB_DATA);
+			Put(target);
+			Put((long long)offset);
+			PutBlob(data, size);
+		}
+		real.BufferSubData(target, offset, size, data);
+	}
+
+	void APIENTRY CaptureGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void* data)
+	{
+		// the read back stalls like in the application, so the replay does it too
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_GET_BUFFER_SUB_DATA);
+			Put(target);
+			Put((long long)offset);
+			Put((long long)size);
+		}
+		real.GetBufferSubData(target, offset, size, data);
+	}
+
+	void APIENTRY CaptureBindVertexArray(GLuint array)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_VERTEX_ARRAY);
+			Put(array);
+		}
+		real.BindVertexArray(array);
+	}
+
+	void APIENTRY CaptureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+	{
+		// the renderer always sources attributes from buffers, the pointer is an offset
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_VERTEX_ATTRIB_POINTER);
+			Put(index);
+			Put(size);
+			Put(type);
+			Put(normalized);
+			Put(stride);
+			Put((unsigned long long)(size_t)pointer);
+		}
+		real.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+	}
+
+	void APIENTRY CaptureEnableVertexAttribArray(GLuint index)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_ENABLE_VERTEX_ATTRIB_ARRAY);
+			Put(index);
+		}
+		real.EnableVertexAttribArray(index);
+	}
+
+	void APIENTRY CaptureVertexAttribDivisor(GLuint index, GLuint divisor)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_VERTEX_ATTRIB_DIVISOR);
+			Put(index);
+			Put(divisor);
+		}
+		real.VertexAttribDivisor(index, divisor);
+	}
+
+	void APIENTRY CaptureVertexAttrib1f(GLuint index, GLfloat x)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_VERTEX_ATTRIB_1F);
+			Put(index);
+			Put(x);
+		}
+		real.VertexAttrib1f(index, x);
+	}
+
+	void APIENTRY CaptureActiveTexture(GLenum texture)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_ACTIVE_TEXTURE);
+			Put(texture);
+		}
+		real.ActiveTexture(texture);
+	}
+
+	void APIENTRY CaptureBindTexture(GLenum target, GLuint texture)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_TEXTURE);
+			Put(target);
+			Put(texture);
+		}
+		real.BindTexture(target, texture);
+	}
+
+	void APIENTRY CaptureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+		GLint border, GLenum format, GLenum type, const void* pixels)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_IMAGE_2D);
+			Put(target);
+			Put(level);
+			Put(internalformat);
+			Put(width);
+			Put(height);
+			Put(border);
+			Put(format);
+			Put(type);
+			PutBlob(pixels, ImageSize(width, height, 1, format, type));
+		}
+		real.TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	}
+
+	void APIENTRY CaptureTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+		GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_IMAGE_3D);
+			Put(target);
+			Put(level);
+			Put(internalformat);
+			Put(width);
+			Put(height);
+			Put(depth);
+			Put(border);
+			Put(format);
+			Put(type);
+			PutBlob(pixels, ImageSize(width, height, depth, format, type));
+		}
+		real.TexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	}
+
+	void APIENTRY CaptureTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+		GLsizei height, GLenum format, GLenum type, const void* pixels)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_SUB_IMAGE_2D);
+			Put(target);
+			Put(level);
+			Put(xoffset);
+			Put(yoffset);
+			Put(width);
+			Put(height);
+			Put(format);
+			Put(type);
+			PutBlob(pixels, ImageSize(width, height, 1, format, type));
+		}
+		real.TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	}
+
+	void APIENTRY CaptureTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_SUB_IMAGE_3D);
+			Put(target);
+			Put(level);
+			Put(xoffset);
+			Put(yoffset);
+			Put(zoffset);
+			Put(width);
+			Put(height);
+			Put(depth);
+			Put(format);
+			Put(type);
+			PutBlob(pixels, ImageSize(width, height, depth, format, type));
+		}
+		real.TexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	}
+
+	void APIENTRY CaptureTexParameteri(GLenum target, GLenum pname, GLint param)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_PARAMETER_I);
+			Put(target);
+			Put(pname);
+			Put(param);
+		}
+		real.TexParameteri(target, pname, param);
+	}
+
+	void APIENTRY CaptureTexParameterfv(GLenum target, GLenum pname, const GLfloat* params)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_TEX_PARAMETER_FV);
+			Put(target);
+			Put(pname);
+			PutBlob(params, (pname == GL_TEXTURE_BORDER_COLOR ? 4 : 1) * sizeof(GLfloat));
+		}
+		real.TexParameterfv(target, pname, params);
+	}
+
+	void APIENTRY CaptureGenerateMipmap(GLenum target)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_GENERATE_MIPMAP);
+			Put(target);
+		}
+		real.GenerateMipmap(target);
+	}
+
+	void APIENTRY CapturePixelStorei(GLenum pname, GLint param)
+	{
+		if (pname == GL_UNPACK_ALIGNMENT)
+			unpackAlignment = param;
+		else if (pname == GL_UNPACK_ROW_LENGTH)
+			unpackRowLength = param;
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_PIXEL_STORE_I);
+			Put(pname);
+			Put(param);
+		}
+		real.PixelStorei(pname, param);
+	}
+
+	void APIENTRY CaptureBindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_FRAMEBUFFER);
+			Put(target);
+			Put(framebuffer);
+		}
+		real.BindFramebuffer(target, framebuffer);
+	}
+
+	void APIENTRY CaptureFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_FRAMEBUFFER_TEXTURE_2D);
+			Put(target);
+			Put(attachment);
+			Put(textarget);
+			Put(texture);
+			Put(level);
+		}
+		real.FramebufferTexture2D(target, attachment, textarget, texture, level);
+	}
+
+	void APIENTRY CaptureFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_FRAMEBUFFER_TEXTURE_LAYER);
+			Put(target);
+			Put(attachment);
+			Put(texture);
+			Put(level);
+			Put(layer);
+		}
+		real.FramebufferTextureLayer(target, attachment, texture, level, layer);
+	}
+
+	void APIENTRY CaptureFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_FRAMEBUFFER_RENDERBUFFER);
+			Put(target);
+			Put(attachment);
+			Put(renderbuffertarget);
+			Put(renderbuffer);
+		}
+		real.FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	}
+
+	void APIENTRY CaptureBindRenderbuffer(GLenum target, GLuint renderbuffer)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BIND_RENDERBUFFER);
+			Put(target);
+			Put(renderbuffer);
+		}
+		real.BindRenderbuffer(target, renderbuffer);
+	}
+
+	void APIENTRY CaptureRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_RENDERBUFFER_STORAGE);
+			Put(target);
+			Put(internalformat);
+			Put(width);
+			Put(height);
+		}
+		real.RenderbufferStorage(target, internalformat, width, height);
+	}
+
+	void APIENTRY CaptureDrawBuffer(GLenum buf)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DRAW_BUFFER);
+			Put(buf);
+		}
+		real.DrawBuffer(buf);
+	}
+
+	void APIENTRY CaptureReadBuffer(GLenum src)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_READ_BUFFER);
+			Put(src);
+		}
+		real.ReadBuffer(src);
+	}
+
+	void APIENTRY CaptureBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0,
+		GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BLIT_FRAMEBUFFER);
+			Put(srcX0);
+			Put(srcY0);
+			Put(srcX1);
+			Put(srcY1);
+			Put(dstX0);
+			Put(dstY0);
+			Put(dstX1);
+			Put(dstY1);
+			Put(mask);
+			Put(filter);
+		}
+		real.BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	}
+
+	void APIENTRY CaptureEnable(GLenum cap)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_ENABLE);
+			Put(cap);
+		}
+		real.Enable(cap);
+	}
+
+	void APIENTRY CaptureDisable(GLenum cap)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DISABLE);
+			Put(cap);
+		}
+		real.Disable(cap);
+	}
+
+	void APIENTRY CaptureViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_VIEWPORT);
+			Put(x);
+			Put(y);
+			Put(width);
+			Put(height);
+		}
+		real.Viewport(x, y, width, height);
+	}
+
+	void APIENTRY CapturePolygonMode(GLenum face, GLenum mode)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_POLYGON_MODE);
+			Put(face);
+			Put(mode);
+		}
+		real.PolygonMode(face, mode);
+	}
+
+	void APIENTRY CapturePolygonOffset(GLfloat factor, GLfloat units)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_POLYGON_OFFSET);
+			Put(factor);
+			Put(units);
+		}
+		real.PolygonOffset(factor, units);
+	}
+
+	void APIENTRY CaptureDepthMask(GLboolean flag)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DEPTH_MASK);
+			Put(flag);
+		}
+		real.DepthMask(flag);
+	}
+
+	void APIENTRY CaptureDepthFunc(GLenum func)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DEPTH_FUNC);
+			Put(func);
+		}
+		real.DepthFunc(func);
+	}
+
+	void APIENTRY CaptureColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_COLOR_MASK);
+			Put(red);
+			Put(green);
+			Put(blue);
+			Put(alpha);
+		}
+		real.ColorMask(red, green, blue, alpha);
+	}
+
+	void APIENTRY CaptureCullFace(GLenum mode)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_CULL_FACE);
+			Put(mode);
+		}
+		real.CullFace(mode);
+	}
+
+	void APIENTRY CaptureFrontFace(GLenum mode)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_FRONT_FACE);
+			Put(mode);
+		}
+		real.FrontFace(mode);
+	}
+
+	void APIENTRY CaptureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_CLEAR_COLOR);
+			Put(red);
+			Put(green);
+			Put(blue);
+			Put(alpha);
+		}
+		real.ClearColor(red, green, blue, alpha);
+	}
+
+	void APIENTRY CaptureClear(GLbitfield mask)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_CLEAR);
+			Put(mask);
+		}
+		real.Clear(mask);
+	}
+
+	void APIENTRY CaptureDrawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DRAW_ARRAYS);
+			Put(mode);
+			Put(first);
+			Put(count);
+		}
+		real.DrawArrays(mode, first, count);
+	}
+
+	void APIENTRY CaptureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+	{
+		// indices always come from the bound element buffer
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DRAW_ELEMENTS);
+			Put(mode);
+			Put(count);
+			Put(type);
+			Put((unsigned long long)(size_t)indices);
+		}
+		real.DrawElements(mode, count, type, indices);
+	}
+
+	void APIENTRY CaptureDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_DRAW_ELEMENTS_INSTANCED);
+			Put(mode);
+			Put(count);
+			Put(type);
+			Put((unsigned long long)(size_t)indices);
+			Put(instancecount);
+		}
+		real.DrawElementsInstanced(mode, count, type, indices, instancecount);
+	}
+
+	void APIENTRY CaptureBeginTransformFeedback(GLenum primitiveMode)
+	{
+		if (Recording())
+		{
+			PutOp(GLCapture::OP_BEGIN_TRANSFORM_FEEDBACK);
+			Put(primitiveMode);
+		}
+		real.BeginTransformFeedback(primitiveMode);
+	}
+
+	void APIENTRY CaptureEndTransformFeedback()
+	{
+		if (Recording())
+			PutOp(GLCapture::OP_END_TRANSFORM_FEEDBACK);
+		real.EndTransformFeedback();
+	}
+
+	void APIENTRY CaptureFlush()
+	{
+		if (Recording())
+			PutOp(GLCapture::OP_FLUSH);
+		real.Flush();
+	}
+
+	void APIENTRY CaptureFinish()
+	{
+		if (Recording())
+			PutOp(GLCapture::OP_FINISH);
+		real.Finish();
+	}
+
+	// swaps every recorded glad pointer with its wrapper, or back
+	void Hook(bool install)
+	{
+#define CAPTURE_HOOK(name) \
+		if (install) { real.name = glad_gl##name; glad_gl##name = Capture##name; } \
+		else glad_gl##name = real.name;
+
+		CAPTURE_HOOK(GenBuffers) CAPTURE_HOOK(DeleteBuffers)
+		CAPTURE_HOOK(GenVertexArrays) CAPTURE_HOOK(DeleteVertexArrays)
+		CAPTURE_HOOK(GenTextures) CAPTURE_HOOK(DeleteTextures)
+		CAPTURE_HOOK(GenFramebuffers) CAPTURE_HOOK(DeleteFramebuffers)
+		CAPTURE_HOOK(GenRenderbuffers) CAPTURE_HOOK(DeleteRenderbuffers)
+		CAPTURE_HOOK(CreateShader) CAPTURE_HOOK(DeleteShader) CAPTURE_HOOK(ShaderSource) CAPTURE_HOOK(CompileShader)
+		CAPTURE_HOOK(CreateProgram) CAPTURE_HOOK(DeleteProgram) CAPTURE_HOOK(AttachShader) CAPTURE_HOOK(LinkProgram)
+		CAPTURE_HOOK(TransformFeedbackVaryings) CAPTURE_HOOK(UseProgram) CAPTURE_HOOK(GetUniformLocation)
+		CAPTURE_HOOK(Uniform1i) CAPTURE_HOOK(Uniform1f) CAPTURE_HOOK(Uniform2f) CAPTURE_HOOK(Uniform3f)
+		CAPTURE_HOOK(Uniform4f) CAPTURE_HOOK(UniformMatrix4fv)
+		CAPTURE_HOOK(BindBuffer) CAPTURE_HOOK(BindBufferBase) CAPTURE_HOOK(BufferData) CAPTURE_HOOK(BufferSubData)
+		CAPTURE_HOOK(GetBufferSubData)
+		CAPTURE_HOOK(BindVertexArray) CAPTURE_HOOK(VertexAttribPointer) CAPTURE_HOOK(EnableVertexAttribArray)
+		CAPTURE_HOOK(VertexAttribDivisor) CAPTURE_HOOK(VertexAttrib1f)
+		CAPTURE_HOOK(ActiveTexture) CAPTURE_HOOK(BindTexture) CAPTURE_HOOK(TexImage2D) CAPTURE_HOOK(TexImage3D)
+		CAPTURE_HOOK(TexSubImage2D) CAPTURE_HOOK(TexSubImage3D) CAPTURE_HOOK(TexParameteri)
+		CAPTURE_HOOK(TexParameterfv) CAPTURE_HOOK(GenerateMipmap) CAPTURE_HOOK(PixelStorei)
+		CAPTURE_HOOK(BindFramebuffer) CAPTURE_HOOK(FramebufferTexture2D) CAPTURE_HOOK(FramebufferTextureLayer)
+		CAPTURE_HOOK(FramebufferRenderbuffer) CAPTURE_HOOK(BindRenderbuffer) CAPTURE_HOOK(RenderbufferStorage)
+		CAPTURE_HOOK(DrawBuffer) CAPTURE_HOOK(ReadBuffer) CAPTURE_HOOK(BlitFramebuffer)
+		CAPTURE_HOOK(Enable) CAPTURE_HOOK(Disable) CAPTURE_HOOK(Viewport) CAPTURE_HOOK(PolygonMode)
+		CAPTURE_HOOK(PolygonOffset) CAPTURE_HOOK(DepthMask) CAPTURE_HOOK(DepthFunc) CAPTURE_HOOK(ColorMask)
+		CAPTURE_HOOK(CullFace) CAPTURE_HOOK(FrontFace) CAPTURE_HOOK(ClearColor) CAPTURE_HOOK(Clear)
+		CAPTURE_HOOK(DrawArrays) CAPTURE_HOOK(DrawElements) CAPTURE_HOOK(DrawElementsInstanced)
+		CAPTURE_HOOK(BeginTransformFeedback) CAPTURE_HOOK(EndTransformFeedback)
+		CAPTURE_HOOK(Flush) CAPTURE_HOOK(Finish)
+
+#undef CAPTURE_HOOK
+	}
+
+	// flush the stream to the file past this size
+	const size_t FLUSH_BYTES = 4 << 20;
+}
+
+GLCapture::GLCapture(GLFWwindow* window, const std::string& path, int firstFrame, int frameCount) :
+	frame(0), finished(false), bytesWritten(0)
+{
+	header.magic = MAGIC;
+	header.version = VERSION;
+	glfwGetFramebufferSize(window, &header.width, &header.height);
+	header.firstFrame = firstFrame > 0 ? firstFrame : 0;
+	header.frameCount = frameCount > 0 ? frameCount : 1;
+
+	if (captureWindow)
+	{
+		std::cout << "ERROR::CAPTURE::ALREADY_ACTIVE" << std::endl;
+		finished = true;
+		return;
+	}
+	file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::CAPTURE::FILE_NOT_OPENED " << path << std::endl;
+		finished = true;
+		return;
+	}
+	// the frame count is rewritten at the end
+	file.write((const char*)&header, sizeof(header));
+	bytesWritten = sizeof(header);
+
+	GLint value;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &value);
+	unpackAlignment = value;
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &value);
+	unpackRowLength = value;
+
+	stream.clear();
+	captureWindow = window;
+	recording = true;
+	Hook(true);
+}
+
+GLCapture::~GLCapture()
+{
+	if (!finished)
+	{
+		// the range wasn't reached, keep what was recorded
+		header.frameCount = frame > header.firstFrame ? frame - header.firstFrame : 0;
+		finish();
+	}
+}
+
+void GLCapture::frameDone()
+{
+	if (finished)
+		return;
+	PutOp(OP_FRAME);
+	frame++;
+	if (frame >= header.firstFrame + header.frameCount)
+		finish();
+	else if (stream.size() >= FLUSH_BYTES)
+		flush();
+}
+
+void GLCapture::flush()
+{
+	file.write((const char*)stream.data(), stream.size());
+	bytesWritten += stream.size();
+	stream.clear();
+}
+
+void GLCapture::finish()
+{
+	Hook(false);
+	recording = false;
+	captureWindow = NULL;
+
+	PutOp(OP_END);
+	flush();
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.close();
+	finished = true;
+	std::vector<unsigned char>().swap(stream);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef GL_CAPTURE_H
+#define GL_CAPTURE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Records the GL commands of the renderer into a binary file that GLReplay
+// plays back without the application: state changes, object creation, the
+// contents of buffers and textures, shader sources, uniforms and draws.
+//
+// The glad function pointers of the recorded calls are swapped for wrappers
+// that write the call and then forward it, so nothing in the renderer has to
+// change. Only the calls made while the given window's context is current are
+// recorded (not the shader reloader's background context). Queries, fences and
+// getters are not recorded - they don't draw anything and the replay measures
+// the frames itself.
+//
+// Everything from the construction on is recorded, so the replay can rebuild
+// every object; the frames before firstFrame are played untimed, as a warm up
+// and to reproduce cached results (shadow maps, visibility) of the range.
+class GLCapture
+{
+public:
+	// one call in the file: the opcode byte followed by its arguments, tightly packed
+	enum Op
+	{
+		OP_END, OP_FRAME,
+		OP_GEN_BUFFERS, OP_DELETE_BUFFERS, OP_GEN_VERTEX_ARRAYS, OP_DELETE_VERTEX_ARRAYS,
+		OP_GEN_TEXTURES, OP_DELETE_TEXTURES, OP_GEN_FRAMEBUFFERS, OP_DELETE_FRAMEBUFFERS,
+		OP_GEN_RENDERBUFFERS, OP_DELETE_RENDERBUFFERS,
+		OP_CREATE_SHADER, OP_DELETE_SHADER, OP_SHADER_SOURCE, OP_COMPILE_SHADER,
+		OP_CREATE_PROGRAM, OP_DELETE_PROGRAM, OP_ATTACH_SHADER, OP_LINK_PROGRAM,
+		OP_TRANSFORM_FEEDBACK_VARYINGS, OP_USE_PROGRAM, OP_GET_UNIFORM_LOCATION,
+		OP_UNIFORM_1I, OP_UNIFORM_1F, OP_UNIFORM_2F, OP_UNIFORM_3F, OP_UNIFORM_4F, OP_UNIFORM_MATRIX_4FV,
+		OP_BIND_BUFFER, OP_BIND_BUFFER_BASE, OP_BUFFER_DATA, OP_BUFFER_SUB_DATA, OP_GET_BUFFER_SUB_DATA,
+		OP_BIND_VERTEX_ARRAY, OP_VERTEX_ATTRIB_POINTER, OP_ENABLE_VERTEX_ATTRIB_ARRAY,
+		OP_VERTEX_ATTRIB_DIVISOR, OP_VERTEX_ATTRIB_1F,
+		OP_ACTIVE_TEXTURE, OP_BIND_TEXTURE, OP_TEX_IMAGE_2D, OP_TEX_IMAGE_3D, OP_TEX_SUB_IMAGE_2D,
+		OP_TEX_SUB_IMAGE_3D, OP_TEX_PARAMETER_I, OP_TEX_PARAMETER_FV, OP_GENERATE_MIPMAP, OP_PIXEL_STORE_I,
+		OP_BIND_FRAMEBUFFER, OP_FRAMEBUFFER_TEXTURE_2D, OP_FRAMEBUFFER_TEXTURE_LAYER,
+		OP_FRAMEBUFFER_RENDERBUFFER, OP_BIND_RENDERBUFFER, OP_RENDERBUFFER_STORAGE,
+		OP_DRAW_BUFFER, OP_READ_BUFFER, OP_BLIT_FRAMEBUFFER,
+		OP_ENABLE, OP_DISABLE, OP_VIEWPORT, OP_POLYGON_MODE, OP_POLYGON_OFFSET, OP_DEPTH_MASK,
+		OP_DEPTH_FUNC, OP_COLOR_MASK, OP_CULL_FACE, OP_FRONT_FACE, OP_CLEAR_COLOR, OP_CLEAR,
+		OP_DRAW_ARRAYS, OP_DRAW_ELEMENTS, OP_DRAW_ELEMENTS_INSTANCED,
+		OP_BEGIN_TRANSFORM_FEEDBACK, OP_END_TRANSFORM_FEEDBACK, OP_FLUSH, OP_FINISH,
+		OP_COUNT
+	};
+	static const unsigned int MAGIC = 0x50434C47; // "GLCP"
+	static const unsigned int VERSION = 2;
+	// file header; frameCount is filled in when the capture finishes
+	struct Header
+	{
+		unsigned int magic;
+		unsigned int version;
+		int width, height;  // framebuffer size when the capture started
+		int firstFrame;     // frames before it are played untimed
+		int frameCount;     // captured frames from firstFrame on
+	};
+
+	// call after gladLoadGLLoader, with the window's context current; only one capture can exist
+	GLCapture(GLFWwindow* window, const std::string& path, int firstFrame, int frameCount);
+	// finishes the file if the range wasn't reached
+	~GLCapture();
+	// call after every glfwSwapBuffers
+	void frameDone();
+	// the last frame of the range is recorded and the file written
+	bool isFinished() const { return finished; }
+	long long getBytesWritten() const { return bytesWritten; }
+private:
+	std::ofstream file;
+	Header header;
+	int frame;
+	bool finished;
+	long long bytesWritten;
+
+	void flush();
+	void finish();
+};
+
+#endif
@@ -0,0 +1,635 @@
+#include "GLReplay.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+GLReplay::GLReplay() : position(0), currentProgram(0), unknownNames(0), totalMs(0.0), callCount(0)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+GLReplay::~GLReplay()
+{
+}
+
+bool GLReplay::load(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::REPLAY::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	if (data.size() < sizeof(header))
+	{
+		std::cout << "ERROR::REPLAY::TRUNCATED " << path << std::endl;
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != GLCapture::MAGIC || header.version != GLCapture::VERSION)
+	{
+		std::cout << "ERROR::REPLAY::UNKNOWN_FORMAT " << path << std::endl;
+		return false;
+	}
+	this->path = path;
+	return true;
+}
+
+void GLReplay::run(GLFWwindow* window)
+{
+	for (int i = 0; i < NAME_KIND_COUNT; i++)
+		names[i].clear();
+	locations.clear();
+	currentProgram = 0;
+	unknownNames = 0;
+	callCount = 0;
+	cpuMs.clear();
+	gpuMs.clear();
+	position = sizeof(header);
+	glfwSwapInterval(0);
+
+	// the frames before the range build the objects and the cached results
+	int frame = 0;
+	while (frame < header.firstFrame && playFrame())
+	{
+		glfwSwapBuffers(window);
+		frame++;
+	}
+	glFinish();
+	int setupCalls = callCount;
+
+	std::vector<GLuint> queries(std::max(header.frameCount, 1));
+	glGenQueries((GLsizei)queries.size(), queries.data());
+	double start = glfwGetTime();
+	for (int i = 0; i < header.frameCount; i++)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, queries[i]);
+		double frameStart = glfwGetTime();
+		bool complete = playFrame();
+		double frameMs = (glfwGetTime() - frameStart) * 1000.0;
+		glEndQuery(GL_TIME_ELAPSED);
+		if (!complete)
+			break;
+		glfwSwapBuffers(window);
+		cpuMs.push_back(frameMs);
+	}
+	glFinish();
+	totalMs = (glfwGetTime() - start) * 1000.0;
+	callCount -= setupCalls;
+
+	for (size_t i = 0; i < cpuMs.size(); i++)
+	{
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+		gpuMs.push_back(ns / 1.0e6);
+	}
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+}
+
+void GLReplay::printReport(std::ostream& out) const
+{
+	out << "Replay: " << path << " (" << header.width << "x" << header.height << ", frames "
+		<< header.firstFrame << ".." << header.firstFrame + (int)cpuMs.size() - 1 << ", "
+		<< callCount << " calls)" << std::endl;
+	out << std::left << std::setw(24) << "frame" << std::right
+		<< std::setw(12) << "cpu ms" << std::setw(12) << "gpu ms" << std::endl;
+
+	out << std::fixed << std::setprecision(3);
+	double cpuSum = 0.0, gpuSum = 0.0;
+	double cpuMin = 1e30, cpuMax = 0.0, gpuMin = 1e30, gpuMax = 0.0;
+	for (size_t i = 0; i < cpuMs.size(); i++)
+	{
+		out << std::left << std::setw(24) << header.firstFrame + (int)i << std::right
+			<< std::setw(12) << cpuMs[i] << std::setw(12) << gpuMs[i] << std::endl;
+		cpuSum += cpuMs[i];
+		gpuSum += gpuMs[i];
+		cpuMin = std::min(cpuMin, cpuMs[i]);
+		cpuMax = std::max(cpuMax, cpuMs[i]);
+		gpuMin = std::min(gpuMin, gpuMs[i]);
+		gpuMax = std::max(gpuMax, gpuMs[i]);
+	}
+	if (!cpuMs.empty())
+	{
+		double n = (double)cpuMs.size();
+		out << std::left << std::setw(24) << "average" << std::right
+			<< std::setw(12) << cpuSum / n << std::setw(12) << gpuSum / n << std::endl;
+		out << std::left << std::setw(24) << "min" << std::right
+			<< std::setw(12) << cpuMin << std::setw(12) << gpuMin << std::endl;
+		out << std::left << std::setw(24) << "max" << std::right
+			<< std::setw(12) << cpuMax << std::setw(12) << gpuMax << std::endl;
+		out << "total " << totalMs << " ms, " << n * 1000.0 / std::max(totalMs, 1e-3) << " fps" << std::endl;
+	}
+	out.unsetf(std::ios_base::floatfield);
+	if (unknownNames > 0)
+		out << unknownNames << " calls used objects the capture didn't create (hot reloaded shaders?)" << std::endl;
+}
+
+bool GLReplay::playFrame()
+{
+	while (position < data.size())
+	{
+		GLCapture::Op op = (GLCapture::Op)data[position++];
+		if (op == GLCapture::OP_END)
+			return false;
+		if (op == GLCapture::OP_FRAME)
+			return true;
+		if (op >= GLCapture::OP_COUNT)
+		{
+			std::cout << "ERROR::REPLAY::UNKNOWN_OP " << (int)op << std::endl;
+			position = data.size();
+			return false;
+		}
+		playCall(op);
+		callCount++;
+	}
+	return false;
+}
+
+const void* GLReplay::getBlob(unsigned int& size)
+{
+	size = get<unsigned int>();
+	if (position + size > data.size())
+		size = 0;
+	const void* blob = size ? &data[position] : NULL;
+	position += size;
+	return blob;
+}
+
+GLuint GLReplay::map(NameKind kind, GLuint name)
+{
+	if (name == 0)
+		return 0;
+	std::map<GLuint, GLuint>::const_iterator it = names[kind].find(name);
+	if (it == names[kind].end())
+	{
+		unknownNames++;
+		return 0;
+	}
+	return it->second;
+}
+
+GLint GLReplay::mapLocation(GLint location)
+{
+	if (location < 0)
+		return location;
+	std::map<std::pair<GLuint, GLint>, GLint>::const_iterator it = locations.find(std::make_pair(currentProgram, location));
+	// without a recorded lookup the location was fixed by the shader
+	return it == locations.end() ? location : it->second;
+}
+
+void GLReplay::genNames(NameKind kind, void (APIENTRYP gen)(GLsizei, GLuint*))
+{
+	GLsizei n = get<GLsizei>();
+	unsigned int size;
+	const GLuint* captured = (const GLuint*)getBlob(size);
+	std::vector<GLuint> created(n);
+	gen(n, created.data());
+	for (GLsizei i = 0; i < n && captured; i++)
+		names[kind][captured[i]] = created[i];
+}
+
+void GLReplay::deleteNames(NameKind kind, void (APIENTRYP del)(GLsizei, const GLuint*))
+{
+	GLsizei n = get<GLsizei>();
+	unsigned int size;
+	const GLuint* captured = (const GLuint*)getBlob(size);
+	std::vector<GLuint> mapped;
+	for (GLsizei i = 0; i < n && captured; i++)
+	{
+		if (captured[i] == 0)
+			continue;
+		mapped.push_back(map(kind, captured[i]));
+		names[kind].erase(captured[i]);
+	}
+	if (!mapped.empty())
+		del((GLsizei)mapped.size(), mapped.data());
+}
+
+void GLReplay::playCall(GLCapture::Op op)
+{
+	unsigned int size;
+	switch (op)
+	{
+	case GLCapture::OP_GEN_BUFFERS: genNames(BUFFER, glGenBuffers); break;
+	case GLCapture::OP_DELETE_BUFFERS: deleteNames(BUFFER, glDeleteBuffers); break;
+	case GLCapture::OP_GEN_VERTEX_ARRAYS: genNames(VERTEX_ARRAY, glGenVertexArrays); break;
+	case GLCapture::OP_DELETE_VERTEX_ARRAYS: deleteNames(VERTEX_ARRAY, glDeleteVertexArrays); break;
+	case GLCapture::OP_GEN_TEXTURES: genNames(TEXTURE, glGenTextures); break;
+	case GLCapture::OP_DELETE_TEXTURES: deleteNames(TEXTURE, glDeleteTextures); break;
+	case GLCapture::OP_GEN_FRAMEBUFFERS: genNames(FRAMEBUFFER, glGenFramebuffers); break;
+	case GLCapture::OP_DELETE_FRAMEBUFFERS: deleteNames(FRAMEBUFFER, glDeleteFramebuffers); break;
+	case GLCapture::OP_GEN_RENDERBUFFERS: genNames(RENDERBUFFER, glGenRenderbuffers); break;
+	case GLCapture::OP_DELETE_RENDERBUFFERS: deleteNames(RENDERBUFFER, glDeleteRenderbuffers); break;
+	case GLCapture::OP_CREATE_SHADER:
+	{
+		GLenum type = get<GLenum>();
+		GLuint shader = get<GLuint>();
+		names[SHADER][shader] = glCreateShader(type);
+		break;
+	}
+	case GLCapture::OP_DELETE_SHADER:
+	{
+		GLuint shader = get<GLuint>();
+		glDeleteShader(map(SHADER, shader));
+		names[SHADER].erase(shader);
+		break;
+	}
+	case GLCapture::OP_SHADER_SOURCE:
+	{
+		GLuint shader = map(SHADER, get<GLuint>());
+		const GLchar* source = (const GLchar*)getBlob(size);
+		GLint length = (GLint)size;
+		if (!source)
+			source = "";
+		glShaderSource(shader, 1, &source, &length);
+		break;
+	}
+	case GLCapture::OP_COMPILE_SHADER: glCompileShader(map(SHADER, get<GLuint>())); break;
+	case GLCapture::OP_CREATE_PROGRAM:
+	{
+		GLuint program = get<GLuint>();
+		names[PROGRAM][program] = glCreateProgram();
+		break;
+	}
+	case GLCapture::OP_DELETE_PROGRAM:
+	{
+		GLuint program = get<GLuint>();
+		glDeleteProgram(map(PROGRAM, program));
+		names[PROGRAM].erase(program);
+		break;
+	}
+	case GLCapture::OP_ATTACH_SHADER:
+	{
+		GLuint program = map(PROGRAM, get<GLuint>());
+		glAttachShader(program, map(SHADER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_LINK_PROGRAM: glLinkProgram(map(PROGRAM, get<GLuint>())); break;
+	case GLCapture::OP_TRANSFORM_FEEDBACK_VARYINGS:
+	{
+		GLuint program = map(PROGRAM, get<GLuint>());
+		GLenum mode = get<GLenum>();
+		GLsizei count = get<GLsizei>();
+		std::vector<std::string> varyings(count);
+		std::vector<const GLchar*> pointers(count);
+		for (GLsizei i = 0; i < count; i++)
+		{
+			const char* name = (const char*)getBlob(size);
+			varyings[i].assign(name ? name : "", size);
+			pointers[i] = varyings[i].c_str();
+		}
+		glTransformFeedbackVaryings(program, count, pointers.data(), mode);
+		break;
+	}
+	case GLCapture::OP_USE_PROGRAM:
+		currentProgram = get<GLuint>();
+		glUseProgram(map(PROGRAM, currentProgram));
+		break;
+	case GLCapture::OP_GET_UNIFORM_LOCATION:
+	{
+		GLuint program = get<GLuint>();
+		GLint location = get<GLint>();
+		const char* blob = (const char*)getBlob(size);
+		std::string name(blob ? blob : "", size);
+		GLint replayed = glGetUniformLocation(map(PROGRAM, program), name.c_str());
+		if (location >= 0)
+			locations[std::make_pair(program, location)] = replayed;
+		break;
+	}
+	case GLCapture::OP_UNIFORM_1I:
+	{
+		GLint location = mapLocation(get<GLint>());
+		glUniform1i(location, get<GLint>());
+		break;
+	}
+	case GLCapture::OP_UNIFORM_1F:
+	{
+		GLint location = mapLocation(get<GLint>());
+		glUniform1f(location, get<GLfloat>());
+		break;
+	}
+	case GLCapture::OP_UNIFORM_2F:
+	{
+		GLint location = mapLocation(get<GLint>());
+		GLfloat v0 = get<GLfloat>();
+		GLfloat v1 = get<GLfloat>();
+		glUniform2f(location, v0, v1);
+		break;
+	}
+	case GLCapture::OP_UNIFORM_3F:
+	{
+		GLint location = mapLocation(get<GLint>());
+		GLfloat v0 = get<GLfloat>();
+		GLfloat v1 = get<GLfloat>();
+		GLfloat v2 = get<GLfloat>();
+		glUniform3f(location, v0, v1, v2);
+		break;
+	}
+	case GLCapture::OP_UNIFORM_4F:
+	{
+		GLint location = mapLocation(get<GLint>());
+		GLfloat v0 = get<GLfloat>();
+		GLfloat v1 = get<GLfloat>();
+		GLfloat v2 = get<GLfloat>();
+		GLfloat v3 = get<GLfloat>();
+		glUniform4f(location, v0, v1, v2, v3);
+		break;
+	}
+	case GLCapture::OP_UNIFORM_MATRIX_4FV:
+	{
+		GLint location = mapLocation(get<GLint>());
+		GLboolean transpose = get<GLboolean>();
+		const GLfloat* value = (const GLfloat*)getBlob(size);
+		if (value)
+			glUniformMatrix4fv(location, size / (16 * sizeof(GLfloat)), transpose, value);
+		break;
+	}
+	case GLCapture::OP_BIND_BUFFER:
+	{
+		GLenum target = get<GLenum>();
+		glBindBuffer(target, map(BUFFER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_BIND_BUFFER_BASE:
+	{
+		GLenum target = get<GLenum>();
+		GLuint index = get<GLuint>();
+		glBindBufferBase(target, index, map(BUFFER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_BUFFER_DATA:
+	{
+		GLenum target = get<GLenum>();
+		GLenum usage = get<GLenum>();
+		GLsizeiptr bytes = (GLsizeiptr)get<long long>();
+		glBufferData(target, bytes, getBlob(size), usage);
+		break;
+	}
+	case GLCapture::OP_BUFFER_SUB_DATA:
+	{
+		GLenum target = get<GLenum>();
+		GLintptr offset = (GLintptr)get<long long>();
+		const void* blob = getBlob(size);
+		if (blob)
+			glBufferSubData(target, offset, size, blob);
+		break;
+	}
+	case GLCapture::OP_GET_BUFFER_SUB_DATA:
+	{
+		GLenum target = get<GLenum>();
+		GLintptr offset = (GLintptr)get<long long>();
+		GLsizeiptr bytes = (GLsizeiptr)get<long long>();
+		scratch.resize(std::max((size_t)bytes, scratch.size()));
+		glGetBufferSubData(target, offset, bytes, scratch.data());
+		break;
+	}
+	case GLCapture::OP_BIND_VERTEX_ARRAY: glBindVertexArray(map(VERTEX_ARRAY, get<GLuint>())); break;
+	case GLCapture::OP_VERTEX_ATTRIB_POINTER:
+	{
+		GLuint index = get<GLuint>();
+		GLint components = get<GLint>();
+		GLenum type = get<GLenum>();
+		GLboolean normalized = get<GLboolean>();
+		GLsizei stride = get<GLsizei>();
+		unsigned long long offset = get<unsigned long long>();
+		glVertexAttribPointer(index, components, type, normalized, stride, (void*)(size_t)offset);
+		break;
+	}
+	case GLCapture::OP_ENABLE_VERTEX_ATTRIB_ARRAY: glEnableVertexAttribArray(get<GLuint>()); break;
+	case GLCapture::OP_VERTEX_ATTRIB_DIVISOR:
+	{
+		GLuint index = get<GLuint>();
+		glVertexAttribDivisor(index, get<GLuint>());
+		break;
+	}
+	case GLCapture::OP_VERTEX_ATTRIB_1F:
+	{
+		GLuint index = get<GLuint>();
+		glVertexAttrib1f(index, get<GLfloat>());
+		break;
+	}
+	case GLCapture::OP_ACTIVE_TEXTURE: glActiveTexture(get<GLenum>()); break;
+	case GLCapture::OP_BIND_TEXTURE:
+	{
+		GLenum target = get<GLenum>();
+		glBindTexture(target, map(TEXTURE, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_TEX_IMAGE_2D:
+	{
+		GLenum target = get<GLenum>();
+		GLint level = get<GLint>();
+		GLint internalFormat = get<GLint>();
+		GLsizei width = get<GLsizei>();
+		GLsizei height = get<GLsizei>();
+		GLint border = get<GLint>();
+		GLenum format = get<GLenum>();
+		GLenum type = get<GLenum>();
+		glTexImage2D(target, level, internalFormat, width, height, border, format, type, getBlob(size));
+		break;
+	}
+	case GLCapture::OP_TEX_IMAGE_3D:
+	{
+		GLenum target = get<GLenum>();
+		GLint level = get<GLint>();
+		GLint internalFormat = get<GLint>();
+		GLsizei width = get<GLsizei>();
+		GLsizei height = get<GLsizei>();
+		GLsizei depth = get<GLsizei>();
+		GLint border = get<GLint>();
+		GLenum format = get<GLenum>();
+		GLenum type = get<GLenum>();
+		glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, getBlob(size));
+		break;
+	}
+	case GLCapture::OP_TEX_SUB_IMAGE_2D:
+	{
+		GLenum target = get<GLenum>();
+		GLint level = get<GLint>();
+		GLint x = get<GLint>();
+		GLint y = get<GLint>();
+		GLsizei width = get<GLsizei>();
+		GLsizei height = get<GLsizei>();
+		GLenum format = get<GLenum>();
+		GLenum type = get<GLenum>();
+		const void* pixels = getBlob(size);
+		if (pixels)
+			glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+		break;
+	}
+	case GLCapture::OP_TEX_SUB_IMAGE_3D:
+	{
+		GLenum target = get<GLenum>();
+		GLint level = get<GLint>();
+		GLint x = get<GLint>();
+		GLint y = get<GLint>();
+		GLint z = get<GLint>();
+		GLsizei width = get<GLsizei>();
+		GLsizei height = get<GLsizei>();
+		GLsizei depth = get<GLsizei>();
+		GLenum format = get<GLenum>();
+		GLenum type = get<GLenum>();
+		const void* pixels = getBlob(size);
+		if (pixels)
+			glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+		break;
+	}
+	case GLCapture::OP_TEX_PARAMETER_I:
+	{
+		GLenum target = get<GLenum>();
+		GLenum pname = get<GLenum>();
+		glTexParameteri(target, pname, get<GLint>());
+		break;
+	}
+	case GLCapture::OP_TEX_PARAMETER_FV:
+	{
+		GLenum target = get<GLenum>();
+		GLenum pname = get<GLenum>();
+		const GLfloat* params = (const GLfloat*)getBlob(size);
+		if (params)
+			glTexParameterfv(target, pname, params);
+		break;
+	}
+	case GLCapture::OP_GENERATE_MIPMAP: glGenerateMipmap(get<GLenum>()); break;
+	case GLCapture::OP_PIXEL_STORE_I:
+	{
+		GLenum pname = get<GLenum>();
+		glPixelStorei(pname, get<GLint>());
+		break;
+	}
+	case GLCapture::OP_BIND_FRAMEBUFFER:
+	{
+		GLenum target = get<GLenum>();
+		glBindFramebuffer(target, map(FRAMEBUFFER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_FRAMEBUFFER_TEXTURE_2D:
+	{
+		GLenum target = get<GLenum>();
+		GLenum attachment = get<GLenum>();
+		GLenum texTarget = get<GLenum>();
+		GLuint texture = map(TEXTURE, get<GLuint>());
+		glFramebufferTexture2D(target, attachment, texTarget, texture, get<GLint>());
+		break;
+	}
+	case GLCapture::OP_FRAMEBUFFER_TEXTURE_LAYER:
+	{
+		GLenum target = get<GLenum>();
+		GLenum attachment = get<GLenum>();
+		GLuint texture = map(TEXTURE, get<GLuint>());
+		GLint level = get<GLint>();
+		glFramebufferTextureLayer(target, attachment, texture, level, get<GLint>());
+		break;
+	}
+	case GLCapture::OP_FRAMEBUFFER_RENDERBUFFER:
+	{
+		GLenum target = get<GLenum>();
+		GLenum attachment = get<GLenum>();
+		GLenum renderbufferTarget = get<GLenum>();
+		glFramebufferRenderbuffer(target, attachment, renderbufferTarget, map(RENDERBUFFER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_BIND_RENDERBUFFER:
+	{
+		GLenum target = get<GLenum>();
+		glBindRenderbuffer(target, map(RENDERBUFFER, get<GLuint>()));
+		break;
+	}
+	case GLCapture::OP_RENDERBUFFER_STORAGE:
+	{
+		GLenum target = get<GLenum>();
+		GLenum internalFormat = get<GLenum>();
+		GLsizei width = get<GLsizei>();
+		glRenderbufferStorage(target, internalFormat, width, get<GLsizei>());
+		break;
+	}
+	case GLCapture::OP_DRAW_BUFFER: glDrawBuffer(get<GLenum>()); break;
+	case GLCapture::OP_READ_BUFFER: glReadBuffer(get<GLenum>()); break;
+	case GLCapture::OP_BLIT_FRAMEBUFFER:
+	{
+		GLint rect[8];
+		for (int i = 0; i < 8; i++)
+			rect[i] = get<GLint>();
+		GLbitfield mask = get<GLbitfield>();
+		GLenum filter = get<GLenum>();
+		glBlitFramebuffer(rect[0], rect[1], rect[2], rect[3], rect[4], rect[5], rect[6], rect[7], mask, filter);
+		break;
+	}
+	case GLCapture::OP_ENABLE: glEnable(get<GLenum>()); break;
+	case GLCapture::OP_DISABLE: glDisable(get<GLenum>()); break;
+	case GLCapture::OP_VIEWPORT:
+	{
+		GLint x = get<GLint>();
+		GLint y = get<GLint>();
+		GLsizei width = get<GLsizei>();
+		glViewport(x, y, width, get<GLsizei>());
+		break;
+	}
+	case GLCapture::OP_POLYGON_MODE:
+	{
+		GLenum face = get<GLenum>();
+		glPolygonMode(face, get<GLenum>());
+		break;
+	}
+	case GLCapture::OP_POLYGON_OFFSET:
+	{
+		GLfloat factor = get<GLfloat>();
+		glPolygonOffset(factor, get<GLfloat>());
+		break;
+	}
+	case GLCapture::OP_DEPTH_MASK: glDepthMask(get<GLboolean>()); break;
+	case GLCapture::OP_DEPTH_FUNC: glDepthFunc(get<GLenum>()); break;
+	case GLCapture::OP_COLOR_MASK:
+	{
+		GLboolean r = get<GLboolean>();
+		GLboolean g = get<GLboolean>();
+		GLboolean b = get<GLboolean>();
+		glColorMask(r, g, b, get<GLboolean>());
+		break;
+	}
+	case GLCapture::OP_CULL_FACE: glCullFace(get<GLenum>()); break;
+	case GLCapture::OP_FRONT_FACE: glFrontFace(get<GLenum>()); break;
+	case GLCapture::OP_CLEAR_COLOR:
+	{
+		GLfloat r = get<GLfloat>();
+		GLfloat g = get<GLfloat>();
+		GLfloat b = get<GLfloat>();
+		glClearColor(r, g, b, get<GLfloat>());
+		break;
+	}
+	case GLCapture::OP_CLEAR: glClear(get<GLbitfield>()); break;
+	case GLCapture::OP_DRAW_ARRAYS:
+	{
+		GLenum mode = get<GLenum>();
+		GLint first = get<GLint>();
+		glDrawArrays(mode, first, get<GLsizei>());
+		break;
+	}
+	case GLCapture::OP_DRAW_ELEMENTS:
+	{
+		GLenum mode = get<GLenum>();
+		GLsizei count = get<GLsizei>();
+		GLenum type = get<GLenum>();
+		unsigned long long offset = get<unsigned long long>();
+		glDrawElements(mode, count, type, (void*)(size_t)offset);
+		break;
+	}
+	case GLCapture::OP_DRAW_ELEMENTS_INSTANCED:
+	{
+		GLenum mode = get<GLenum>();
+		GLsizei count = get<GLsizei>();
+		GLenum type = get<GLenum>();
+		unsigned long long offset = get<unsigned long long>();
+		glDrawElementsInstanced(mode, count, type, (void*)(size_t)offset, get<GLsizei>());
+		break;
+	}
+	case GLCapture::OP_BEGIN_TRANSFORM_FEEDBACK: glBeginTransformFeedback(get<GLenum>()); break;
+	case GLCapture::OP_END_TRANSFORM_FEEDBACK: glEndTransformFeedback(); break;
+	case GLCapture::OP_FLUSH: glFlush(); break;
+	case GLCapture::OP_FINISH: glFinish(); break;
+	default:
+		break;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef GL_REPLAY_H
+#define GL_REPLAY_H
+
+#include "GLCapture.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Plays a file written by GLCapture as fast as possible: no vsync, no
+// simulation, no culling or other CPU work of the application - only the
+// recorded GL calls. The timings of the captured frames show what the GL
+// stream itself costs, the same on every run.
+//
+// Object names and uniform locations of the capture are mapped to the ones
+// this context hands out. Every captured frame is timed on the CPU (issuing
+// the calls) and on the GPU (a GL_TIME_ELAPSED query); the queries are read
+// after the last frame, so the replay never waits for the GPU in between.
+class GLReplay
+{
+public:
+	GLReplay();
+	~GLReplay();
+	bool load(const std::string& path);
+	int getWidth() const { return header.width; }
+	int getHeight() const { return header.height; }
+	int getFirstFrame() const { return header.firstFrame; }
+	int getFrameCount() const { return header.frameCount; }
+
+	// plays the whole file into the window's default framebuffer, the context has to be current
+	void run(GLFWwindow* window);
+	void printReport(std::ostream& out) const;
+private:
+	enum NameKind
+	{
+		BUFFER, VERTEX_ARRAY, TEXTURE, FRAMEBUFFER, RENDERBUFFER, SHADER, PROGRAM, NAME_KIND_COUNT
+	};
+
+	GLCapture::Header header;
+	std::string path;
+	std::vector<unsigned char> data;
+	size_t position;
+
+	std::map<GLuint, GLuint> names[NAME_KIND_COUNT];
+	// (captured program, captured location) -> location
+	std::map<std::pair<GLuint, GLint>, GLint> locations;
+	GLuint currentProgram; // captured name
+	int unknownNames;
+	std::vector<unsigned char> scratch;
+
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+	double totalMs;
+	int callCount;
+
+	// plays calls up to the next frame marker; false at the end of the file
+	bool playFrame();
+	void playCall(GLCapture::Op op);
+
+	template <typename T>
+	T get()
+	{
+		T value = T();
+		if (position + sizeof(T) <= data.size())
+			memcpy(&value, &data[position], sizeof(T));
+		position += sizeof(T);
+		return value;
+	}
+	// pointer to the bytes of a blob, NULL for an empty one
+	const void* getBlob(unsigned int& size);
+	GLuint map(NameKind kind, GLuint name);
+	GLint mapLocation(GLint location);
+	void genNames(NameKind kind, void (APIENTRYP gen)(GLsizei, GLuint*));
+	void deleteNames(NameKind kind, void (APIENTRYP del)(GLsizei, const GLuint*));
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "GpuTimer.h"
+
+GpuQuery::GpuQuery(GLenum target) : target(target), current(0), active(false), lastResult(0)
+{
+	glGenQueries(QUERY_COUNT, queries);
+	for (int i = 0; i < QUERY_COUNT; i++)
+		pending[i] = false;
+}
+
+GpuQuery::~GpuQuery()
+{
+	glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void GpuQuery::begin()
+{
+	collect();
+	// every query is still in flight - skip this measurement instead of stalling
+	if (pending[current])
+		return;
+	glBeginQuery(target, queries[current]);
+	active = true;
+}
+
+void GpuQuery::end()
+{
+	if (!active)
+		return;
+	glEndQuery(target);
+	pending[current] = true;
+	current = (current + 1) % QUERY_COUNT;
+	active = false;
+}
+
+GLuint64 GpuQuery::getResult()
+{
+	collect();
+	return lastResult;
+}
+
+void GpuQuery::collect()
+{
+	// the slot after the last written one is the oldest
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int q = (current + i) % QUERY_COUNT;
+		if (!pending[q])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &lastResult);
+		pending[q] = false;
+	}
+}
+
+GpuTimer::GpuTimer() : current(0), active(false), lastResult(0)
+{
+	glGenQueries(QUERY_COUNT, starts);
+	glGenQueries(QUERY_COUNT, ends);
+	for (int i = 0; i < QUERY_COUNT; i++)
+		pending[i] = false;
+}
+
+GpuTimer::~GpuTimer()
+{
+	glDeleteQueries(QUERY_COUNT, starts);
+	glDeleteQueries(QUERY_COUNT, ends);
+}
+
+void GpuTimer::begin()
+{
+	collect();
+	// every pair is still in flight - skip this measurement instead of stalling
+	if (pending[current])
+		return;
+	glQueryCounter(starts[current], GL_TIMESTAMP);
+	active = true;
+}
+
+void GpuTimer::end()
+{
+	if (!active)
+		return;
+	glQueryCounter(ends[current], GL_TIMESTAMP);
+	pending[current] = true;
+	current = (current + 1) % QUERY_COUNT;
+	active = false;
+}
+
+float GpuTimer::getMs()
+{
+	collect();
+	return (float)(lastResult / 1.0e6);
+}
+
+void GpuTimer::collect()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int q = (current + i) % QUERY_COUNT;
+		if (!pending[q])
+			continue;
+		// the end timestamp is written last
+		GLint available = 0;
+		glGetQueryObjectiv(ends[q], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(starts[q], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(ends[q], GL_QUERY_RESULT, &end);
+		lastResult = end > start ? end - start : 0;
+		pending[q] = false;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Ring of GL queries of one type (GL_TIME_ELAPSED, GL_SAMPLES_PASSED, ...).
+// Results are collected a few frames later, so reading them never makes
+// the CPU wait for the GPU.
+class GpuQuery
+{
+public:
+	GpuQuery(GLenum target);
+	virtual ~GpuQuery();
+	void begin();
+	void end();
+	// the latest result that is available
+	GLuint64 getResult();
+private:
+	static const int QUERY_COUNT = 4;
+	GLenum target;
+	GLuint queries[QUERY_COUNT];
+	bool pending[QUERY_COUNT];
+	int current;
+	bool active;
+	GLuint64 lastResult;
+
+	// read back every query the GPU has already finished
+	void collect();
+};
+
+// Measures how long the GPU spends on the commands between begin() and end().
+// A GL_TIME_ELAPSED query can't be active twice, so the timer takes a
+// GL_TIMESTAMP at either end instead: timers may nest, e.g. the cascades of
+// the shadow pass inside the frame.
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+	void begin();
+	void end();
+	// in milliseconds
+	float getMs();
+private:
+	static const int QUERY_COUNT = 4;
+	GLuint starts[QUERY_COUNT];
+	GLuint ends[QUERY_COUNT];
+	bool pending[QUERY_COUNT];
+	int current;
+	bool active;
+	GLuint64 lastResult;
+
+	void collect();
+};
+
+#endif
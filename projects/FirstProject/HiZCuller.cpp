@@ -0,0 +1,193 @@
+#include "HiZCuller.h"
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+HiZCuller::HiZCuller(ShaderManager& shaders, int width, int height) : width(width), height(height), pyramidPv(1.f), resultCapacity(0)
+{
+	glGenFramebuffers(1, &FBO);
+	glGenVertexArrays(1, &emptyVAO);
+	createPyramid();
+
+	// one point per box: center and extent
+	glGenVertexArrays(1, &boxVAO);
+	glGenBuffers(1, &boxVBO);
+	glBindVertexArray(boxVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CullBox), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CullBox), (void*)sizeof(glm::vec3));
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glGenBuffers(1, &resultBuffer);
+
+	reduceShader = shaders.load("shaders/fullscreen.vert", "shaders/hiz_reduce.frag");
+	cullShader = shaders.load("shaders/hiz_cull.vert", "shaders/hiz_cull.frag", std::vector<std::string>(),
+		std::vector<std::string>(1, "visible"));
+}
+
+HiZCuller::~HiZCuller()
+{
+	glDeleteBuffers(1, &resultBuffer);
+	glDeleteBuffers(1, &boxVBO);
+	glDeleteVertexArrays(1, &boxVAO);
+	glDeleteVertexArrays(1, &emptyVAO);
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteTextures(1, &pyramid);
+}
+
+namespace
+{
+	int CeilPowerOfTwo(int value)
+	{
+		int power = 1;
+		while (power < value)
+			power *= 2;
+		return power;
+	}
+}
+
+int HiZCuller::levelWidth(int level) const
+{
+	return std::max((CeilPowerOfTwo(width) / 2) >> level, 1);
+}
+
+int HiZCuller::levelHeight(int level) const
+{
+	return std::max((CeilPowerOfTwo(height) / 2) >> level, 1);
+}
+
+void HiZCuller::createPyramid()
+{
+	built = false;
+	levels = 1;
+	while (levelWidth(levels - 1) > 1 || levelHeight(levels - 1) > 1)
+		levels++;
+
+	glGenTextures(1, &pyramid);
+	glBindTexture(GL_TEXTURE_2D, pyramid);
+	for (int i = 0; i < levels; i++)
+		glTexImage2D(GL_TEXTURE_2D, i, GL_R32F, levelWidth(i), levelHeight(i), 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HiZCuller::resize(int newWidth, int newHeight)
+{
+	if (newWidth == width && newHeight == height)
+		return;
+	glDeleteTextures(1, &pyramid);
+	width = newWidth;
+	height = newHeight;
+	createPyramid();
+}
+
+void HiZCuller::buildPyramid(GLuint depthTexture, const glm::mat4& pv)
+{
+	GLint oldFBO, viewport[4], polygonMode[2];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldFBO);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glBindVertexArray(emptyVAO);
+	reduceShader->use();
+	reduceShader->setInt("source", 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	for (int i = 0; i < levels; i++)
+	{
+		// level 0 reduces the depth buffer, the others the level above them;
+		// the sampled level is the only one visible, so there's no feedback loop
+		if (i == 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+			reduceShader->setInt("sourceWidth", width);
+			reduceShader->setInt("sourceHeight", height);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, pyramid);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, i - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, i - 1);
+			reduceShader->setInt("sourceWidth", levelWidth(i - 1));
+			reduceShader->setInt("sourceHeight", levelHeight(i - 1));
+		}
+		reduceShader->setInt("targetWidth", levelWidth(i));
+		reduceShader->setInt("targetHeight", levelHeight(i));
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, i);
+		glViewport(0, 0, levelWidth(i), levelHeight(i));
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, pyramid);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, oldFBO);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+	if (cullFace)
+		glEnable(GL_CULL_FACE);
+	built = true;
+	pyramidPv = pv;
+}
+
+void HiZCuller::test(const std::vector<CullBox>& boxes, std::vector<GLint>& visible)
+{
+	visible.resize(boxes.size());
+	if (boxes.empty())
+		return;
+	// nothing to be occluded by yet
+	if (!built)
+	{
+		std::fill(visible.begin(), visible.end(), 1);
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+	glBufferData(GL_ARRAY_BUFFER, boxes.size() * sizeof(CullBox), boxes.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (resultCapacity < boxes.size())
+	{
+		resultCapacity = boxes.size();
+		glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, resultBuffer);
+		glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, resultCapacity * sizeof(GLint), NULL, GL_STREAM_READ);
+	}
+
+	cullShader->use();
+	cullShader->setMatrix4f("pv", pyramidPv);
+	cullShader->setInt("hiZ", 0);
+	cullShader->setInt("hiZLevels", levels);
+	glUniform2f(glGetUniformLocation(cullShader->ID, "hiZSize"), (float)levelWidth(0), (float)levelHeight(0));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, pyramid);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, resultBuffer);
+	glBeginTransformFeedback(GL_POINTS);
+	glBindVertexArray(boxVAO);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)boxes.size());
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	// the draw calls of this frame need the answer now: this waits for the GPU
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, resultBuffer);
+	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, boxes.size() * sizeof(GLint), visible.data());
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
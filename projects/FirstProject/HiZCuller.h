@@ -0,0 +1,67 @@
+#pragma once
+#ifndef HIZ_CULLER_H
+#define HIZ_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Shader.h"
+#include "ShaderManager.h"
+
+// world space axis aligned box, as uploaded to the culling shader
+struct CullBox
+{
+	glm::vec3 center;
+	glm::vec3 extent; // half size
+};
+
+// Hierarchical-Z occlusion culling. A pyramid of max depths is built from a
+// depth texture with a fragment shader reduction; boxes are then tested against
+// it in a vertex shader (one point per box) whose results are captured with
+// transform feedback and read back. The pyramid is a power of two in both
+// directions, so every level halves the previous one exactly and no row or
+// column of the depth texture is dropped. It keeps the matrix it was built
+// with, so the pyramid of the previous frame can be tested against as well.
+class HiZCuller
+{
+public:
+	// size of the depth texture the pyramid is built from; the programs are
+	// built by the manager, usable after its finish()
+	HiZCuller(ShaderManager& shaders, int width, int height);
+	~HiZCuller();
+	void resize(int width, int height);
+
+	// build the pyramid from depth rendered with the projection-view matrix pv;
+	// keeps the framebuffer binding, the viewport and the polygon mode
+	void buildPyramid(GLuint depthTexture, const glm::mat4& pv);
+	// false until a pyramid is built, and again after a resize
+	bool hasPyramid() const { return built; }
+	// visible[i] = 1 when boxes[i] may be visible, 0 when it's surely occluded
+	// by the depth the pyramid was built from
+	void test(const std::vector<CullBox>& boxes, std::vector<GLint>& visible);
+private:
+	int width;
+	int height;
+	int levels;
+	GLuint pyramid;     // R32F, level 0 is half the depth texture size rounded up to a power of two
+	bool built;
+	glm::mat4 pyramidPv;
+	GLuint FBO;
+	GLuint emptyVAO;    // the reduction draws a full screen triangle from gl_VertexID
+
+	GLuint boxVAO;
+	GLuint boxVBO;
+	GLuint resultBuffer;
+	size_t resultCapacity;
+
+	Shader* reduceShader;
+	Shader* cullShader;
+
+	int levelWidth(int level) const;
+	int levelHeight(int level) const;
+	void createPyramid();
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "LodMesh.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+LodMesh::LodMesh(const MeshData& mesh, int maxLods, float reduction, bool upload) :
+	pixelThreshold(1.f), hysteresis(0.25f), lodEnabled(true), boundingRadius(0.f), instanceCapacity(0),
+	VAO(0), VBO(0), EBO(0), instanceVBO(0)
+{
+	// LOD chain: every level simplifies the previous one
+	MeshLod lod0 = { 0, (GLsizei)mesh.indices.size(), 0.f };
+	lods.push_back(lod0);
+	std::vector<unsigned int> indices = mesh.indices;
+
+	std::vector<unsigned int> previous = mesh.indices;
+	float error = 0.f;
+	while ((int)lods.size() < std::min(maxLods, MAX_LODS))
+	{
+		float stepError = 0.f;
+		size_t target = (size_t)(previous.size() / 3 * reduction);
+		std::vector<unsigned int> simplified = SimplifyMesh(mesh.vertices, previous, target, stepError);
+		// stop when the simplifier got stuck
+		if (simplified.size() > previous.size() * 0.8f)
+			break;
+		error += stepError;
+		MeshLod lod = { (GLuint)indices.size(), (GLsizei)simplified.size(), error };
+		lods.push_back(lod);
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		previous = simplified;
+	}
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		boundingRadius = std::max(boundingRadius, glm::length(mesh.vertices[i].position));
+
+	if (!upload)
+	{
+		// every LOD keeps only the vertices it uses, a CPU renderer transforms whole meshes
+		std::vector<int> remap(mesh.vertices.size());
+		for (size_t l = 0; l < lods.size(); l++)
+		{
+			MeshData lodMesh;
+			std::fill(remap.begin(), remap.end(), -1);
+			for (GLsizei i = 0; i < lods[l].indexCount; i++)
+			{
+				unsigned int vertex = indices[lods[l].firstIndex + i];
+				if (remap[vertex] < 0)
+				{
+					remap[vertex] = (int)lodMesh.vertices.size();
+					lodMesh.vertices.push_back(mesh.vertices[vertex]);
+				}
+				lodMesh.indices.push_back((unsigned int)remap[vertex]);
+			}
+			lodMeshes.push_back(lodMesh);
+		}
+		return;
+	}
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glGenBuffers(1, &instanceVBO);
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+	glEnableVertexAttribArray(3);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	// per instance model matrix at locations 4..7 and texture layer at 8;
+	// the pointers are set per LOD group in draw()
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (int i = 0; i < 5; i++)
+	{
+		glEnableVertexAttribArray(4 + i);
+		glVertexAttribDivisor(4 + i, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+LodMesh::~LodMesh()
+{
+	if (!VAO)
+		return;
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &instanceVBO);
+}
+
+size_t LodMesh::select(const std::vector<MeshInstance>& instances, Camera& camera, int viewportHeight, const Frustum& frustum)
+{
+	currentLod.resize(instances.size(), 0);
+	for (size_t i = 0; i < lods.size(); i++)
+		lodInstances[i].clear();
+
+	// pixels per world unit at distance 1
+	float pixelsPerUnit = viewportHeight * 0.5f / tan(glm::radians(camera.Fov) * 0.5f);
+	int lodCount = lodEnabled ? (int)lods.size() : 1;
+
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const glm::mat4& model = instances[i].model;
+		glm::vec3 center = glm::vec3(model[3]);
+		float scale = std::max(glm::length(glm::vec3(model[0])),
+			std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		float radius = boundingRadius * scale;
+		if (!frustum.intersectsSphere(center, radius))
+			continue;
+
+		// projected size of the LOD error at the nearest point of the bounds
+		float distance = std::max(glm::length(center - camera.Position) - radius, camera.zNear);
+		float errorScale = scale * pixelsPerUnit / distance;
+
+		int lod = std::min(currentLod[i], lodCount - 1);
+		while (lod > 0 && lods[lod].error * errorScale > pixelThreshold)
+			lod--;
+		while (lod + 1 < lodCount && lods[lod + 1].error * errorScale < pixelThreshold * (1.f - hysteresis))
+			lod++;
+		currentLod[i] = lod;
+		lodInstances[lod].push_back(instances[i]);
+	}
+
+	size_t triangles = 0;
+	for (size_t i = 0; i < lods.size(); i++)
+		triangles += lodInstances[i].size() * lods[i].indexCount / 3;
+	return triangles;
+}
+
+size_t LodMesh::draw(const std::vector<MeshInstance>& instances, Camera& camera, int viewportHeight, const Frustum& frustum)
+{
+	size_t triangles = select(instances, camera, viewportHeight, frustum);
+
+	// all the groups go into one buffer one after another
+	size_t visible = 0;
+	for (size_t i = 0; i < lods.size(); i++)
+		visible += lodInstances[i].size();
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	if (visible > instanceCapacity)
+		instanceCapacity = visible * 2;
+	// orphan the old storage, the GPU may still be reading it
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(MeshInstance), NULL, GL_STREAM_DRAW);
+
+	glBindVertexArray(VAO);
+	size_t offset = 0;
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		const std::vector<MeshInstance>& group = lodInstances[i];
+		if (group.empty())
+			continue;
+		glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(MeshInstance), group.size() * sizeof(MeshInstance), group.data());
+		// no base instance in GL 3.3: point the instance attributes at the group
+		size_t groupStart = offset * sizeof(MeshInstance);
+		for (int c = 0; c < 4; c++)
+			glVertexAttribPointer(4 + c, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+				(void*)(groupStart + offsetof(MeshInstance, model) + c * sizeof(glm::vec4)));
+		glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+			(void*)(groupStart + offsetof(MeshInstance, layer)));
+		glDrawElementsInstanced(GL_TRIANGLES, lods[i].indexCount, GL_UNSIGNED_INT,
+			(void*)(lods[i].firstIndex * sizeof(unsigned int)), (GLsizei)group.size());
+		offset += group.size();
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return triangles;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef LOD_MESH_H
+#define LOD_MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Mesh.h"
+#include "camera.h"
+#include "Frustum.h"
+
+const int MAX_LODS = 8;
+
+struct MeshLod
+{
+	GLuint firstIndex;
+	GLsizei indexCount;
+	float error; // world space deviation from the full detail mesh
+};
+
+// A mesh with a chain of simplified versions built at load time. All the LODs
+// share one vertex buffer (the simplifier only drops vertices) and differ
+// in their index ranges. Instances are drawn instanced, grouped by LOD.
+class LodMesh
+{
+public:
+	float pixelThreshold;   // largest allowed screen space error, in pixels
+	float hysteresis;       // a coarser LOD needs error < threshold * (1 - hysteresis)
+	bool lodEnabled;        // false - always draw LOD 0
+
+	// upload = false keeps the LODs on the CPU as meshes of their own, for
+	// renderers without GL; draw() can't be used then
+	LodMesh(const MeshData& mesh, int maxLods = MAX_LODS, float reduction = 0.5f, bool upload = true);
+	~LodMesh();
+
+	// cull, pick LODs and draw the instances with the shader in use;
+	// returns the number of triangles drawn
+	size_t draw(const std::vector<MeshInstance>& instances, Camera& camera, int viewportHeight, const Frustum& frustum);
+	// the culling and the LOD choice of draw() alone; returns the number of triangles
+	size_t select(const std::vector<MeshInstance>& instances, Camera& camera, int viewportHeight, const Frustum& frustum);
+
+	int getLodCount() const { return (int)lods.size(); }
+	const MeshLod& getLod(int i) const { return lods[i]; }
+	// how many instances used every LOD in the last draw
+	int getLodInstances(int i) const { return (int)lodInstances[i].size(); }
+	// the instances the last draw or select put in a LOD
+	const std::vector<MeshInstance>& getLodGroup(int i) const { return lodInstances[i]; }
+	// the vertices a LOD uses and its indices into them; only without upload
+	const MeshData& getLodMesh(int i) const { return lodMeshes[i]; }
+private:
+	std::vector<MeshLod> lods;
+	std::vector<MeshData> lodMeshes;
+	float boundingRadius;
+	std::vector<int> currentLod; // per instance, to apply the hysteresis
+	std::vector<MeshInstance> lodInstances[MAX_LODS];
+	size_t instanceCapacity;
+
+	GLuint VAO;
+	GLuint VBO;
+	GLuint EBO;
+	GLuint instanceVBO;
+};
+
+#endif
@@ -0,0 +1,547 @@
+#include "MathKernels.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATH_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC compiles any intrinsic without /arch, the calls are only made after CPUID said so
+#define KERNEL_TARGET(isa)
+#else
+#include <cpuid.h>
+// GCC and Clang need the instruction set per function, the rest of the file stays baseline
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+	struct Kernels
+	{
+		// aStep is 0 for a shared left matrix, 1 for one per item
+		void(*multiply)(const glm::mat4* a, int aStep, const glm::mat4* b, glm::mat4* out, int count);
+		void(*transform)(const glm::mat4* m, int mStep, const glm::vec4* v, glm::vec4* out, int count);
+		// position and scale may be NULL for none
+		void(*compose)(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+			glm::mat4* out, int count);
+	};
+
+	void MultiplyScalar(const glm::mat4* a, int aStep, const glm::mat4* b, glm::mat4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = a[i * aStep] * b[i];
+	}
+
+	void TransformScalar(const glm::mat4* m, int mStep, const glm::vec4* v, glm::vec4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = m[i * mStep] * v[i];
+	}
+
+	void ComposeScalar(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+		glm::mat4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			glm::mat4 model = glm::mat4_cast(rotation[i]);
+			if (scale)
+			{
+				model[0] *= scale[i].x;
+				model[1] *= scale[i].y;
+				model[2] *= scale[i].z;
+			}
+			if (position)
+				model[3] = glm::vec4(position[i], 1.f);
+			out[i] = model;
+		}
+	}
+
+	const Kernels SCALAR_KERNELS = { MultiplyScalar, TransformScalar, ComposeScalar };
+
+#ifdef MATH_KERNELS_X86
+	void Cpuid(int leaf, int subleaf, unsigned int regs[4])
+	{
+#ifdef _MSC_VER
+		int r[4];
+		__cpuidex(r, leaf, subleaf);
+		for (int i = 0; i < 4; i++)
+			regs[i] = (unsigned int)r[i];
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	// which register states the OS saves on a context switch
+	unsigned long long EnabledStates()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return ((unsigned long long)high << 32) | low;
+#endif
+	}
+
+	MathIsa DetectIsa()
+	{
+		unsigned int regs[4];
+		Cpuid(0, 0, regs);
+		unsigned int maxLeaf = regs[0];
+		Cpuid(1, 0, regs);
+		bool sse2 = (regs[3] >> 26) & 1, fma = (regs[2] >> 12) & 1;
+		bool osxsave = (regs[2] >> 27) & 1, avx = (regs[2] >> 28) & 1;
+		if (!sse2)
+			return MATH_SCALAR;
+		// the wider registers are only usable if the OS saves them: XMM and YMM,
+		// and for AVX-512 the mask registers and all 32 ZMM registers as well
+		if (!osxsave || !avx || maxLeaf < 7)
+			return MATH_SSE2;
+		unsigned long long states = EnabledStates();
+		if ((states & 0x6) != 0x6)
+			return MATH_SSE2;
+		Cpuid(7, 0, regs);
+		bool avx2 = (regs[1] >> 5) & 1, avx512f = (regs[1] >> 16) & 1;
+		if (!avx2 || !fma)
+			return MATH_SSE2;
+		if (avx512f && (states & 0xe6) == 0xe6)
+			return MATH_AVX512;
+		return MATH_AVX2;
+	}
+
+	// SSE2
+
+	KERNEL_TARGET("sse2") void MultiplySse2(const glm::mat4* a, int aStep, const glm::mat4* b, glm::mat4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const float* left = (const float*)&a[i * aStep];
+			const float* right = (const float*)&b[i];
+			__m128 a0 = _mm_loadu_ps(left), a1 = _mm_loadu_ps(left + 4);
+			__m128 a2 = _mm_loadu_ps(left + 8), a3 = _mm_loadu_ps(left + 12);
+			float* result = (float*)&out[i];
+			for (int j = 0; j < 4; j++)
+			{
+				// glm's order: ((a0 * b.x + a1 * b.y) + a2 * b.z) + a3 * b.w
+				__m128 column = _mm_loadu_ps(right + 4 * j);
+				__m128 sum = _mm_add_ps(_mm_mul_ps(a0, _mm_shuffle_ps(column, column, 0x00)),
+					_mm_mul_ps(a1, _mm_shuffle_ps(column, column, 0x55)));
+				sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, 0xaa)));
+				sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, 0xff)));
+				_mm_storeu_ps(result + 4 * j, sum);
+			}
+		}
+	}
+
+	KERNEL_TARGET("sse2") void TransformSse2(const glm::mat4* m, int mStep, const glm::vec4* v, glm::vec4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const float* matrix = (const float*)&m[i * mStep];
+			__m128 vector = _mm_loadu_ps((const float*)&v[i]);
+			// glm's order: (m0 * v.x + m1 * v.y) + (m2 * v.z + m3 * v.w)
+			__m128 low = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(matrix), _mm_shuffle_ps(vector, vector, 0x00)),
+				_mm_mul_ps(_mm_loadu_ps(matrix + 4), _mm_shuffle_ps(vector, vector, 0x55)));
+			__m128 high = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(matrix + 8), _mm_shuffle_ps(vector, vector, 0xaa)),
+				_mm_mul_ps(_mm_loadu_ps(matrix + 12), _mm_shuffle_ps(vector, vector, 0xff)));
+			_mm_storeu_ps((float*)&out[i], _mm_add_ps(low, high));
+		}
+	}
+
+	// The quaternion kernels work on four to sixteen items at once, one per
+	// lane, and transpose four at a time into the matrices' columns.
+
+	// columns 0 to 2 of the rotation scaled by the scale, column 3 the position
+	struct ComposeColumns
+	{
+		__m128 c[4][3];
+	};
+
+	KERNEL_TARGET("sse2") void StoreComposed(ComposeColumns& columns, float* out)
+	{
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+		for (int c = 0; c < 4; c++)
+		{
+			__m128 x = columns.c[c][0], y = columns.c[c][1], z = columns.c[c][2], w = c == 3 ? one : zero;
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(out + 4 * c, x);
+			_mm_storeu_ps(out + 16 + 4 * c, y);
+			_mm_storeu_ps(out + 32 + 4 * c, z);
+			_mm_storeu_ps(out + 48 + 4 * c, w);
+		}
+	}
+
+	KERNEL_TARGET("sse2") void ComposeSse2(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+		glm::mat4* out, int count)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const glm::quat* q = rotation + i;
+			__m128 x = _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x), y = _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+			__m128 z = _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z), w = _mm_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w);
+			// glm::mat3_cast term by term
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xz = _mm_mul_ps(x, z), xy = _mm_mul_ps(x, y), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+			const __m128 one = _mm_set1_ps(1.f), two = _mm_set1_ps(2.f);
+			ComposeColumns columns;
+			columns.c[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+			columns.c[0][1] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+			columns.c[0][2] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+			columns.c[1][0] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+			columns.c[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+			columns.c[1][2] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+			columns.c[2][0] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+			columns.c[2][1] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+			columns.c[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+			if (scale)
+			{
+				const glm::vec3* s = scale + i;
+				__m128 factors[3] = { _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x),
+					_mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y), _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z) };
+				for (int c = 0; c < 3; c++)
+					for (int r = 0; r < 3; r++)
+						columns.c[c][r] = _mm_mul_ps(columns.c[c][r], factors[c]);
+			}
+			if (position)
+			{
+				const glm::vec3* p = position + i;
+				columns.c[3][0] = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+				columns.c[3][1] = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+				columns.c[3][2] = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+			}
+			else
+				columns.c[3][0] = columns.c[3][1] = columns.c[3][2] = _mm_setzero_ps();
+			StoreComposed(columns, (float*)&out[i]);
+		}
+		ComposeScalar(position ? position + i : NULL, rotation + i, scale ? scale + i : NULL, out + i, count - i);
+	}
+
+	const Kernels SSE2_KERNELS = { MultiplySse2, TransformSse2, ComposeSse2 };
+
+	// AVX2: two columns or two items per register, FMA for the sums
+
+	KERNEL_TARGET("avx2,fma") void MultiplyAvx2(const glm::mat4* a, int aStep, const glm::mat4* b, glm::mat4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			// every column of a in both halves, against columns j and j + 1 of b
+			const float* left = (const float*)&a[i * aStep];
+			__m256 a0 = _mm256_broadcast_ps((const __m128*)left), a1 = _mm256_broadcast_ps((const __m128*)(left + 4));
+			__m256 a2 = _mm256_broadcast_ps((const __m128*)(left + 8)), a3 = _mm256_broadcast_ps((const __m128*)(left + 12));
+			const float* right = (const float*)&b[i];
+			float* result = (float*)&out[i];
+			for (int j = 0; j < 4; j += 2)
+			{
+				__m256 columns = _mm256_loadu_ps(right + 4 * j);
+				__m256 sum = _mm256_mul_ps(a0, _mm256_shuffle_ps(columns, columns, 0x00));
+				sum = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(columns, columns, 0x55), sum);
+				sum = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(columns, columns, 0xaa), sum);
+				sum = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(columns, columns, 0xff), sum);
+				_mm256_storeu_ps(result + 4 * j, sum);
+			}
+		}
+	}
+
+	KERNEL_TARGET("avx2,fma") __m256 LoadColumnPair(const float* first, const float* second)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(first)), _mm_loadu_ps(second), 1);
+	}
+
+	KERNEL_TARGET("avx2,fma") void TransformAvx2(const glm::mat4* m, int mStep, const glm::vec4* v, glm::vec4* out, int count)
+	{
+		int i = 0;
+		for (; i + 2 <= count; i += 2)
+		{
+			// item i in the low half, item i + 1 in the high half
+			const float* first = (const float*)&m[i * mStep];
+			const float* second = (const float*)&m[(i + 1) * mStep];
+			__m256 vectors = _mm256_loadu_ps((const float*)&v[i]);
+			__m256 sum = _mm256_mul_ps(LoadColumnPair(first, second), _mm256_shuffle_ps(vectors, vectors, 0x00));
+			sum = _mm256_fmadd_ps(LoadColumnPair(first + 4, second + 4), _mm256_shuffle_ps(vectors, vectors, 0x55), sum);
+			sum = _mm256_fmadd_ps(LoadColumnPair(first + 8, second + 8), _mm256_shuffle_ps(vectors, vectors, 0xaa), sum);
+			sum = _mm256_fmadd_ps(LoadColumnPair(first + 12, second + 12), _mm256_shuffle_ps(vectors, vectors, 0xff), sum);
+			_mm256_storeu_ps((float*)&out[i], sum);
+		}
+		TransformSse2(m + i * mStep, mStep, v + i, out + i, count - i);
+	}
+
+	// the items' components one per lane
+	KERNEL_TARGET("avx2,fma") __m256 GatherAvx2(const float* first, int stride)
+	{
+		return _mm256_setr_ps(first[0], first[stride], first[2 * stride], first[3 * stride],
+			first[4 * stride], first[5 * stride], first[6 * stride], first[7 * stride]);
+	}
+
+	KERNEL_TARGET("avx2,fma") void ComposeAvx2(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+		glm::mat4* out, int count)
+	{
+		const int quatStride = sizeof(glm::quat) / sizeof(float), vec3Stride = sizeof(glm::vec3) / sizeof(float);
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const glm::quat* q = rotation + i;
+			__m256 x = GatherAvx2(&q->x, quatStride), y = GatherAvx2(&q->y, quatStride);
+			__m256 z = GatherAvx2(&q->z, quatStride), w = GatherAvx2(&q->w, quatStride);
+			__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+			__m256 xz = _mm256_mul_ps(x, z), xy = _mm256_mul_ps(x, y), yz = _mm256_mul_ps(y, z);
+			__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+			const __m256 one = _mm256_set1_ps(1.f), two = _mm256_set1_ps(2.f);
+			__m256 columns[4][3];
+			columns[0][0] = _mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one);
+			columns[0][1] = _mm256_mul_ps(two, _mm256_add_ps(xy, wz));
+			columns[0][2] = _mm256_mul_ps(two, _mm256_sub_ps(xz, wy));
+			columns[1][0] = _mm256_mul_ps(two, _mm256_sub_ps(xy, wz));
+			columns[1][1] = _mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one);
+			columns[1][2] = _mm256_mul_ps(two, _mm256_add_ps(yz, wx));
+			columns[2][0] = _mm256_mul_ps(two, _mm256_add_ps(xz, wy));
+			columns[2][1] = _mm256_mul_ps(two, _mm256_sub_ps(yz, wx));
+			columns[2][2] = _mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one);
+			if (scale)
+			{
+				const float* s = &scale[i].x;
+				for (int c = 0; c < 3; c++)
+				{
+					__m256 factor = GatherAvx2(s + c, vec3Stride);
+					for (int r = 0; r < 3; r++)
+						columns[c][r] = _mm256_mul_ps(columns[c][r], factor);
+				}
+			}
+			for (int r = 0; r < 3; r++)
+				columns[3][r] = position ? GatherAvx2(&position[i].x + r, vec3Stride) : _mm256_setzero_ps();
+			// the same transpose as StoreComposed() in both halves at once:
+			// item k in the low half, item k + 4 in the high half
+			float* result = (float*)&out[i];
+			for (int c = 0; c < 4; c++)
+			{
+				__m256 w = c == 3 ? one : _mm256_setzero_ps();
+				__m256 low0 = _mm256_unpacklo_ps(columns[c][0], columns[c][1]), low1 = _mm256_unpacklo_ps(columns[c][2], w);
+				__m256 high0 = _mm256_unpackhi_ps(columns[c][0], columns[c][1]), high1 = _mm256_unpackhi_ps(columns[c][2], w);
+				__m256 items[4] = { _mm256_shuffle_ps(low0, low1, 0x44), _mm256_shuffle_ps(low0, low1, 0xee),
+					_mm256_shuffle_ps(high0, high1, 0x44), _mm256_shuffle_ps(high0, high1, 0xee) };
+				for (int k = 0; k < 4; k++)
+				{
+					_mm_storeu_ps(result + 16 * k + 4 * c, _mm256_castps256_ps128(items[k]));
+					_mm_storeu_ps(result + 16 * (k + 4) + 4 * c, _mm256_extractf128_ps(items[k], 1));
+				}
+			}
+		}
+		ComposeSse2(position ? position + i : NULL, rotation + i, scale ? scale + i : NULL, out + i, count - i);
+	}
+
+	const Kernels AVX2_KERNELS = { MultiplyAvx2, TransformAvx2, ComposeAvx2 };
+
+	// AVX-512: a whole matrix or four items per register
+
+	KERNEL_TARGET("avx512f") __m512 BroadcastColumn(const float* column)
+	{
+		__m512 low = _mm512_castps128_ps512(_mm_loadu_ps(column));
+		return _mm512_shuffle_f32x4(low, low, 0x00);
+	}
+
+
+	KERNEL_TARGET("avx512f") void MultiplyAvx512(const glm::mat4* a, int aStep, const glm::mat4* b, glm::mat4* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			// every column of a in all four quarters, against all four columns of b
+			const float* left = (const float*)&a[i * aStep];
+			__m512 a0 = BroadcastColumn(left), a1 = BroadcastColumn(left + 4);
+			__m512 a2 = BroadcastColumn(left + 8), a3 = BroadcastColumn(left + 12);
+			__m512 columns = _mm512_loadu_ps((const float*)&b[i]);
+			__m512 sum = _mm512_mul_ps(a0, _mm512_permute_ps(columns, 0x00));
+			sum = _mm512_fmadd_ps(a1, _mm512_permute_ps(columns, 0x55), sum);
+			sum = _mm512_fmadd_ps(a2, _mm512_permute_ps(columns, 0xaa), sum);
+			sum = _mm512_fmadd_ps(a3, _mm512_permute_ps(columns, 0xff), sum);
+			_mm512_storeu_ps((float*)&out[i], sum);
+		}
+	}
+
+	KERNEL_TARGET("avx512f") __m512 LoadColumnQuad(const float* first, int stride)
+	{
+		__m512 columns = _mm512_castps128_ps512(_mm_loadu_ps(first));
+		columns = _mm512_insertf32x4(columns, _mm_loadu_ps(first + stride), 1);
+		columns = _mm512_insertf32x4(columns, _mm_loadu_ps(first + 2 * stride), 2);
+		return _mm512_insertf32x4(columns, _mm_loadu_ps(first + 3 * stride), 3);
+	}
+
+	KERNEL_TARGET("avx512f") void TransformAvx512(const glm::mat4* m, int mStep, const glm::vec4* v, glm::vec4* out, int count)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			// item i + k in quarter k
+			const float* first = (const float*)&m[i * mStep];
+			int stride = 16 * mStep;
+			__m512 vectors = _mm512_loadu_ps((const float*)&v[i]);
+			__m512 sum = _mm512_mul_ps(LoadColumnQuad(first, stride), _mm512_permute_ps(vectors, 0x00));
+			sum = _mm512_fmadd_ps(LoadColumnQuad(first + 4, stride), _mm512_permute_ps(vectors, 0x55), sum);
+			sum = _mm512_fmadd_ps(LoadColumnQuad(first + 8, stride), _mm512_permute_ps(vectors, 0xaa), sum);
+			sum = _mm512_fmadd_ps(LoadColumnQuad(first + 12, stride), _mm512_permute_ps(vectors, 0xff), sum);
+			_mm512_storeu_ps((float*)&out[i], sum);
+		}
+		TransformAvx2(m + i * mStep, mStep, v + i, out + i, count - i);
+	}
+
+	KERNEL_TARGET("avx512f") __m512 GatherAvx512(const float* first, int stride)
+	{
+		return _mm512_i32gather_ps(_mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+			_mm512_set1_epi32(stride)), first, 4);
+	}
+
+	KERNEL_TARGET("avx512f") void ComposeAvx512(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+		glm::mat4* out, int count)
+	{
+		const int quatStride = sizeof(glm::quat) / sizeof(float), vec3Stride = sizeof(glm::vec3) / sizeof(float);
+		int i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			const glm::quat* q = rotation + i;
+			__m512 x = GatherAvx512(&q->x, quatStride), y = GatherAvx512(&q->y, quatStride);
+			__m512 z = GatherAvx512(&q->z, quatStride), w = GatherAvx512(&q->w, quatStride);
+			__m512 xx = _mm512_mul_ps(x, x), yy = _mm512_mul_ps(y, y), zz = _mm512_mul_ps(z, z);
+			__m512 xz = _mm512_mul_ps(x, z), xy = _mm512_mul_ps(x, y), yz = _mm512_mul_ps(y, z);
+			__m512 wx = _mm512_mul_ps(w, x), wy = _mm512_mul_ps(w, y), wz = _mm512_mul_ps(w, z);
+			const __m512 one = _mm512_set1_ps(1.f), two = _mm512_set1_ps(2.f);
+			__m512 columns[4][3];
+			columns[0][0] = _mm512_fnmadd_ps(two, _mm512_add_ps(yy, zz), one);
+			columns[0][1] = _mm512_mul_ps(two, _mm512_add_ps(xy, wz));
+			columns[0][2] = _mm512_mul_ps(two, _mm512_sub_ps(xz, wy));
+			columns[1][0] = _mm512_mul_ps(two, _mm512_sub_ps(xy, wz));
+			columns[1][1] = _mm512_fnmadd_ps(two, _mm512_add_ps(xx, zz), one);
+			columns[1][2] = _mm512_mul_ps(two, _mm512_add_ps(yz, wx));
+			columns[2][0] = _mm512_mul_ps(two, _mm512_add_ps(xz, wy));
+			columns[2][1] = _mm512_mul_ps(two, _mm512_sub_ps(yz, wx));
+			columns[2][2] = _mm512_fnmadd_ps(two, _mm512_add_ps(xx, yy), one);
+			if (scale)
+			{
+				const float* s = &scale[i].x;
+				for (int c = 0; c < 3; c++)
+				{
+					__m512 factor = GatherAvx512(s + c, vec3Stride);
+					for (int r = 0; r < 3; r++)
+						columns[c][r] = _mm512_mul_ps(columns[c][r], factor);
+				}
+			}
+			for (int r = 0; r < 3; r++)
+				columns[3][r] = position ? GatherAvx512(&position[i].x + r, vec3Stride) : _mm512_setzero_ps();
+			// item k + 4 * quarter in each quarter
+			float* result = (float*)&out[i];
+			for (int c = 0; c < 4; c++)
+			{
+				__m512 w = c == 3 ? one : _mm512_setzero_ps();
+				__m512 low0 = _mm512_unpacklo_ps(columns[c][0], columns[c][1]), low1 = _mm512_unpacklo_ps(columns[c][2], w);
+				__m512 high0 = _mm512_unpackhi_ps(columns[c][0], columns[c][1]), high1 = _mm512_unpackhi_ps(columns[c][2], w);
+				__m512 items[4] = { _mm512_shuffle_ps(low0, low1, 0x44), _mm512_shuffle_ps(low0, low1, 0xee),
+					_mm512_shuffle_ps(high0, high1, 0x44), _mm512_shuffle_ps(high0, high1, 0xee) };
+				for (int k = 0; k < 4; k++)
+				{
+					_mm_storeu_ps(result + 16 * k + 4 * c, _mm512_castps512_ps128(items[k]));
+					_mm_storeu_ps(result + 16 * (k + 4) + 4 * c, _mm512_extractf32x4_ps(items[k], 1));
+					_mm_storeu_ps(result + 16 * (k + 8) + 4 * c, _mm512_extractf32x4_ps(items[k], 2));
+					_mm_storeu_ps(result + 16 * (k + 12) + 4 * c, _mm512_extractf32x4_ps(items[k], 3));
+				}
+			}
+		}
+		ComposeAvx2(position ? position + i : NULL, rotation + i, scale ? scale + i : NULL, out + i, count - i);
+	}
+
+	const Kernels AVX512_KERNELS = { MultiplyAvx512, TransformAvx512, ComposeAvx512 };
+#else
+	MathIsa DetectIsa() { return MATH_SCALAR; }
+#endif
+
+	const Kernels* KernelsFor(MathIsa isa)
+	{
+#ifdef MATH_KERNELS_X86
+		switch (isa)
+		{
+		case MATH_SSE2: return &SSE2_KERNELS;
+		case MATH_AVX2: return &AVX2_KERNELS;
+		case MATH_AVX512: return &AVX512_KERNELS;
+		default: break;
+		}
+#endif
+		return &SCALAR_KERNELS;
+	}
+
+	// the best version from the first use on; only setIsa() changes it. The
+	// static is initialised once even if several threads get here together.
+	std::atomic<MathIsa>& ActiveIsa()
+	{
+		static std::atomic<MathIsa> isa(MathKernels::getBestIsa());
+		return isa;
+	}
+
+	const Kernels& Active()
+	{
+		return *KernelsFor(ActiveIsa().load(std::memory_order_relaxed));
+	}
+}
+
+MathIsa MathKernels::getBestIsa()
+{
+	static const MathIsa best = DetectIsa();
+	return best;
+}
+
+const char* MathKernels::getIsaName(MathIsa isa)
+{
+	switch (isa)
+	{
+	case MATH_SCALAR: return "scalar";
+	case MATH_SSE2: return "sse2";
+	case MATH_AVX2: return "avx2";
+	case MATH_AVX512: return "avx512";
+	default: return "unknown";
+	}
+}
+
+bool MathKernels::setIsa(MathIsa isa)
+{
+	if (isa < 0 || isa >= MATH_ISA_COUNT || !isSupported(isa))
+		return false;
+	ActiveIsa().store(isa, std::memory_order_relaxed);
+	return true;
+}
+
+MathIsa MathKernels::getIsa()
+{
+	return ActiveIsa().load(std::memory_order_relaxed);
+}
+
+void MathKernels::multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, int count)
+{
+	Active().multiply(a, 1, b, out, count);
+}
+
+void MathKernels::multiply(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, int count)
+{
+	Active().multiply(&a, 0, b, out, count);
+}
+
+void MathKernels::transform(const glm::mat4* m, const glm::vec4* v, glm::vec4* out, int count)
+{
+	Active().transform(m, 1, v, out, count);
+}
+
+void MathKernels::transform(const glm::mat4& m, const glm::vec4* v, glm::vec4* out, int count)
+{
+	Active().transform(&m, 0, v, out, count);
+}
+
+void MathKernels::quatToMat4(const glm::quat* q, glm::mat4* out, int count)
+{
+	Active().compose(NULL, q, NULL, out, count);
+}
+
+void MathKernels::composeTRS(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+	glm::mat4* out, int count)
+{
+	Active().compose(position, rotation, scale, out, count);
+}
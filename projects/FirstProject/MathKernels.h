@@ -0,0 +1,47 @@
+#pragma once
+#ifndef MATH_KERNELS_H
+#define MATH_KERNELS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+enum MathIsa
+{
+	MATH_SCALAR,   // glm itself
+	MATH_SSE2,
+	MATH_AVX2,     // with FMA
+	MATH_AVX512,   // AVX-512F
+	MATH_ISA_COUNT
+};
+
+// Batched matrix and quaternion math with SSE2, AVX2 and AVX-512 versions;
+// the best one the CPU and the OS support is picked by CPUID on first use.
+// The results match glm to rounding: SSE2 does glm's operations in glm's
+// order, the wider versions fuse multiplies and adds. Outputs may be one of
+// the batched inputs, but not a shared one.
+class MathKernels
+{
+public:
+	static MathIsa getBestIsa();
+	static bool isSupported(MathIsa isa) { return isa <= getBestIsa(); }
+	static const char* getIsaName(MathIsa isa);
+	// the version the kernels run; false (and no change) if the CPU can't run it
+	static bool setIsa(MathIsa isa);
+	static MathIsa getIsa();
+
+	// out[i] = a[i] * b[i]
+	static void multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, int count);
+	// out[i] = a * b[i], e.g. projection-view times every model
+	static void multiply(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, int count);
+	// out[i] = m[i] * v[i]
+	static void transform(const glm::mat4* m, const glm::vec4* v, glm::vec4* out, int count);
+	// out[i] = m * v[i]
+	static void transform(const glm::mat4& m, const glm::vec4* v, glm::vec4* out, int count);
+	// out[i] = glm::mat4_cast(q[i]) of unit quaternions
+	static void quatToMat4(const glm::quat* q, glm::mat4* out, int count);
+	// out[i] = translate(position[i]) * mat4_cast(rotation[i]) * scale(scale[i])
+	static void composeTRS(const glm::vec3* position, const glm::quat* rotation, const glm::vec3* scale,
+		glm::mat4* out, int count);
+};
+
+#endif
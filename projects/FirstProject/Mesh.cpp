@@ -0,0 +1,59 @@
+#include "Mesh.h"
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <cstring>
+
+MeshData MeshFromArray(const float* data, int vertexCount)
+{
+	static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex must stay tightly packed");
+	MeshData mesh;
+	mesh.vertices.resize(vertexCount);
+	memcpy((void*)mesh.vertices.data(), data, vertexCount * sizeof(Vertex));
+	for (int i = 0; i < vertexCount; i++)
+		mesh.indices.push_back(i);
+	return mesh;
+}
+
+MeshData CreateSphere(int stacks, int slices)
+{
+	MeshData mesh;
+	const float pi = glm::pi<float>();
+	for (int i = 0; i <= stacks; i++)
+	{
+		float v = (float)i / stacks;
+		float theta = v * pi;
+		for (int j = 0; j <= slices; j++)
+		{
+			float u = (float)j / slices;
+			float phi = u * 2.f * pi;
+			Vertex vertex;
+			vertex.position = glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+			vertex.normal = vertex.position;
+			vertex.texCoords = glm::vec2(u * 4.f, v * 2.f);
+			vertex.color = vertex.normal * 0.5f + 0.5f;
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (int i = 0; i < stacks; i++)
+		for (int j = 0; j < slices; j++)
+		{
+			unsigned int a = i * (slices + 1) + j;
+			unsigned int b = a + slices + 1;
+			// counter-clockwise seen from outside
+			if (i != 0)
+			{
+				mesh.indices.push_back(a);
+				mesh.indices.push_back(a + 1);
+				mesh.indices.push_back(b);
+			}
+			if (i != stacks - 1)
+			{
+				mesh.indices.push_back(a + 1);
+				mesh.indices.push_back(b + 1);
+				mesh.indices.push_back(b);
+			}
+		}
+	return mesh;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MESH_H
+#define MESH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// same layout as the interleaved cube in main.cpp: position, normal, texture, color
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoords;
+	glm::vec3 color;
+};
+
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// per instance data of instanced draws
+struct MeshInstance
+{
+	glm::mat4 model;
+	float layer;    // texture array layer of the material
+};
+
+// non-indexed triangles given as interleaved floats in the Vertex layout
+// (11 floats per vertex, like the cube in main.cpp)
+MeshData MeshFromArray(const float* data, int vertexCount);
+
+// UV sphere of radius 1; the seam column and the pole vertices are duplicated
+// so that every vertex has a single texture coordinate
+MeshData CreateSphere(int stacks, int slices);
+
+#endif
@@ -0,0 +1,197 @@
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <map>
+#include <queue>
+#include <utility>
+#include <algorithm>
+
+namespace
+{
+	// symmetric 4x4 matrix of the sum of squared distances to planes
+	struct Quadric
+	{
+		double a[10];
+
+		Quadric()
+		{
+			for (int i = 0; i < 10; i++)
+				a[i] = 0.0;
+		}
+
+		void addPlane(const glm::vec3& n, float d)
+		{
+			a[0] += n.x * n.x; a[1] += n.x * n.y; a[2] += n.x * n.z; a[3] += n.x * d;
+			a[4] += n.y * n.y; a[5] += n.y * n.z; a[6] += n.y * d;
+			a[7] += n.z * n.z; a[8] += n.z * d;
+			a[9] += d * d;
+		}
+
+		void add(const Quadric& q)
+		{
+			for (int i = 0; i < 10; i++)
+				a[i] += q.a[i];
+		}
+
+		double evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+				+ a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+				+ a[7] * z * z + 2.0 * a[8] * z
+				+ a[9];
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int fromVersion;
+		unsigned int toVersion;
+
+		// smallest cost on top of the priority queue
+		bool operator<(const Collapse& other) const { return cost > other.cost; }
+	};
+}
+
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	size_t targetTriangles, float& error)
+{
+	size_t triangleCount = indices.size() / 3;
+	std::vector<unsigned int> triangles(indices);
+	std::vector<char> alive(triangleCount, 1);
+	std::vector<std::vector<unsigned int> > vertexTriangles(vertices.size());
+	std::vector<Quadric> quadrics(vertices.size());
+	std::vector<unsigned int> version(vertices.size(), 0);
+	std::vector<char> removed(vertices.size(), 0);
+	std::vector<char> locked(vertices.size(), 0);
+
+	// plane quadrics of the triangles
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3& p0 = vertices[triangles[t * 3]].position;
+		const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].position;
+		const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].position;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(n);
+		if (length > 0.f)
+			n /= length;
+		Quadric q;
+		q.addPlane(n, -glm::dot(n, p0));
+		for (int k = 0; k < 3; k++)
+		{
+			quadrics[triangles[t * 3 + k]].add(q);
+			vertexTriangles[triangles[t * 3 + k]].push_back((unsigned int)t);
+		}
+	}
+
+	// edges used by a single triangle are open - their vertices stay in place
+	std::map<std::pair<unsigned int, unsigned int>, int> edges;
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+			edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+	for (std::map<std::pair<unsigned int, unsigned int>, int>::iterator it = edges.begin(); it != edges.end(); ++it)
+		if (it->second == 1)
+			locked[it->first.first] = locked[it->first.second] = 1;
+
+	std::priority_queue<Collapse> queue;
+	auto push = [&](unsigned int from, unsigned int to)
+	{
+		if (locked[from])
+			return;
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		Collapse c = { std::max(q.evaluate(vertices[to].position), 0.0), from, to, version[from], version[to] };
+		queue.push(c);
+	};
+	for (std::map<std::pair<unsigned int, unsigned int>, int>::iterator it = edges.begin(); it != edges.end(); ++it)
+	{
+		push(it->first.first, it->first.second);
+		push(it->first.second, it->first.first);
+	}
+
+	double maxCost = 0.0;
+	while (triangleCount > targetTriangles && !queue.empty())
+	{
+		Collapse c = queue.top();
+		queue.pop();
+		if (removed[c.from] || removed[c.to] || version[c.from] != c.fromVersion || version[c.to] != c.toVersion)
+			continue;
+
+		// the triangles that stay must not flip when "from" moves onto "to"
+		const glm::vec3& target = vertices[c.to].position;
+		bool flips = false;
+		for (size_t i = 0; i < vertexTriangles[c.from].size() && !flips; i++)
+		{
+			unsigned int t = vertexTriangles[c.from][i];
+			unsigned int* tri = &triangles[t * 3];
+			if (!alive[t] || tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+				continue;
+			glm::vec3 p[3], q[3];
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = vertices[tri[k]].position;
+				q[k] = tri[k] == c.from ? target : p[k];
+			}
+			glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			flips = glm::dot(before, after) <= 0.f;
+		}
+		if (flips)
+			continue;
+
+		// collapse
+		for (size_t i = 0; i < vertexTriangles[c.from].size(); i++)
+		{
+			unsigned int t = vertexTriangles[c.from][i];
+			unsigned int* tri = &triangles[t * 3];
+			if (!alive[t])
+				continue;
+			if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+			{
+				alive[t] = 0;
+				triangleCount--;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+				if (tri[k] == c.from)
+					tri[k] = c.to;
+			vertexTriangles[c.to].push_back(t);
+		}
+		vertexTriangles[c.from].clear();
+		removed[c.from] = 1;
+		quadrics[c.to].add(quadrics[c.from]);
+		version[c.to]++;
+		maxCost = std::max(maxCost, c.cost);
+
+		// costs around "to" changed
+		for (size_t i = 0; i < vertexTriangles[c.to].size(); i++)
+		{
+			unsigned int t = vertexTriangles[c.to][i];
+			if (!alive[t])
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int w = triangles[t * 3 + k];
+				if (w == c.to)
+					continue;
+				push(c.to, w);
+				push(w, c.to);
+			}
+		}
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	for (size_t t = 0; t < alive.size(); t++)
+		if (alive[t])
+			for (int k = 0; k < 3; k++)
+				result.push_back(triangles[t * 3 + k]);
+	error = (float)sqrt(maxCost);
+	return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+
+#include "Mesh.h"
+
+// Quadric error metric simplification (Garland & Heckbert) by edge collapses.
+// A vertex is always collapsed onto one of its neighbours, so the result
+// indexes the same vertex array and no vertex attributes have to be
+// interpolated. Vertices on open edges, including texture seams, never move.
+//
+// Returns the new index buffer with at most targetTriangles triangles (or as
+// close as possible) and sets error to the largest distance between the
+// simplified surface and the planes of the input triangles.
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	size_t targetTriangles, float& error);
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef MODEL_TRANSFORM_H
+#define MODEL_TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct ModelTransform
+{
+	glm::vec3 position;
+	glm::vec3 rotation; // Euler's angles
+	glm::vec3 scale;
+
+	void setUniformScale(float s)
+	{
+		scale.x = s;
+		scale.y = s;
+		scale.z = s;
+	}
+
+	glm::mat4 getModelMatrix() const
+	{
+		glm::mat4 model = glm::mat4(1.0f);
+		model = glm::translate(model, position);
+		model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.f, 0.f, 0.f));
+		model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.f, 1.f, 0.f));
+		model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.f, 0.f, 1.f));
+		model = glm::scale(model, scale);
+		return model;
+	}
+
+	// the rotation of getModelMatrix(): about x, then y, then z of the object
+	glm::quat getRotation() const
+	{
+		return glm::angleAxis(glm::radians(rotation.x), glm::vec3(1.f, 0.f, 0.f))
+			* glm::angleAxis(glm::radians(rotation.y), glm::vec3(0.f, 1.f, 0.f))
+			* glm::angleAxis(glm::radians(rotation.z), glm::vec3(0.f, 0.f, 1.f));
+	}
+};
+
+// blend of two states of an object; the Euler angles are blended per component,
+// which is fine for the small difference between two simulation steps
+inline ModelTransform Interpolate(const ModelTransform& from, const ModelTransform& to, float t)
+{
+	ModelTransform result = {
+		glm::mix(from.position, to.position, t),
+		glm::mix(from.rotation, to.rotation, t),
+		glm::mix(from.scale, to.scale, t),
+	};
+	return result;
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include "MultiView.h"
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	// 0 if it can't be read or doesn't compile
+	GLuint CompileStage(GLenum type, const char* path, const std::vector<std::string>& defines)
+	{
+		std::string source;
+		std::vector<std::string> files;
+		if (!ShaderPreprocessor::process(path, defines, source, files))
+			return 0;
+		GLuint shader = glCreateShader(type);
+		const GLchar* code = source.c_str();
+		glShaderSource(shader, 1, &code, NULL);
+		glCompileShader(shader);
+		GLint success;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+			std::cout << "ERROR::MULTI_VIEW::COMPILATION_FAILED " << path << "\n" << infoLog << std::endl;
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+
+	// 0 if a stage doesn't compile or the program doesn't link
+	GLuint BuildProgram(const std::vector<std::string>& defines, bool withGeometry)
+	{
+		GLuint vertex = CompileStage(GL_VERTEX_SHADER, "shaders/multiview.vert", defines);
+		GLuint geometry = withGeometry ? CompileStage(GL_GEOMETRY_SHADER, "shaders/multiview.geom", defines) : 0;
+		GLuint fragment = CompileStage(GL_FRAGMENT_SHADER, "shaders/multiview.frag", defines);
+		GLuint program = 0;
+		if (vertex && fragment && (geometry || !withGeometry))
+		{
+			program = glCreateProgram();
+			glAttachShader(program, vertex);
+			if (geometry)
+				glAttachShader(program, geometry);
+			glAttachShader(program, fragment);
+			glLinkProgram(program);
+			GLint success;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				char infoLog[1024];
+				glGetProgramInfoLog(program, 1024, NULL, infoLog);
+				std::cout << "ERROR::MULTI_VIEW::LINKING_FAILED\n" << infoLog << std::endl;
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+		glDeleteShader(vertex);
+		glDeleteShader(geometry);
+		glDeleteShader(fragment);
+		return program;
+	}
+}
+
+MultiView::MultiView(int width, int height, int viewCount) : width(width), height(height),
+	viewCount(std::max(std::min(viewCount, MAX_VIEWS), 1)), path(MULTI_VIEW_GEOMETRY_SHADER), activeViews(0), drawCalls(0)
+{
+	glGenTextures(1, &colorArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, colorArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, this->viewCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glGenTextures(1, &depthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, this->viewCount, 0, GL_DEPTH_COMPONENT,
+		GL_UNSIGNED_INT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// attaching whole arrays makes the framebuffer layered: gl_Layer picks the layer
+	glGenFramebuffers(1, &layeredFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorArray, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::MULTI_VIEW::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	layerFBOs.resize(this->viewCount);
+	glGenFramebuffers(this->viewCount, layerFBOs.data());
+	for (int i = 0; i < this->viewCount; i++)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, layerFBOs[i]);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorArray, 0, i);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	std::vector<std::string> defines;
+	defines.push_back("MAX_VIEWS " + std::to_string(MAX_VIEWS));
+	defines.push_back("MAX_VERTICES " + std::to_string(3 * MAX_VIEWS));
+	int extension = findLayerExtension();
+	for (int p = 0; p < MULTI_VIEW_PATH_COUNT; p++)
+	{
+		std::vector<std::string> pathDefines = defines;
+		pathDefines.push_back("VERTEX_LAYER " + std::to_string(p == MULTI_VIEW_VERTEX_LAYER ? extension : 0));
+		pathDefines.push_back(std::string("GEOMETRY_LAYER ") + (p == MULTI_VIEW_GEOMETRY_SHADER ? "1" : "0"));
+		programs[p] = p == MULTI_VIEW_VERTEX_LAYER && !extension ? 0
+			: BuildProgram(pathDefines, p == MULTI_VIEW_GEOMETRY_SHADER);
+		viewsLocations[p] = programs[p] ? glGetUniformLocation(programs[p], "views") : -1;
+		modelLocations[p] = programs[p] ? glGetUniformLocation(programs[p], "model") : -1;
+	}
+	GLuint geometryProgram = programs[MULTI_VIEW_GEOMETRY_SHADER], passProgram = programs[MULTI_VIEW_PASS_PER_VIEW];
+	viewCountLocation = geometryProgram ? glGetUniformLocation(geometryProgram, "viewCount") : -1;
+	viewIndexLocation = passProgram ? glGetUniformLocation(passProgram, "viewIndex") : -1;
+	bool linked = false;
+	for (int p = 0; p < MULTI_VIEW_PATH_COUNT; p++)
+		linked = linked || programs[p] != 0;
+	if (!linked)
+		std::cout << "ERROR::MULTI_VIEW::NO_PROGRAM_LINKED" << std::endl;
+}
+
+MultiView::~MultiView()
+{
+	for (int p = 0; p < MULTI_VIEW_PATH_COUNT; p++)
+		glDeleteProgram(programs[p]);
+	glDeleteFramebuffers(1, &layeredFBO);
+	glDeleteFramebuffers((GLsizei)layerFBOs.size(), layerFBOs.data());
+	glDeleteTextures(1, &colorArray);
+	glDeleteTextures(1, &depthArray);
+}
+
+int MultiView::findLayerExtension()
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	int found = 0;
+	for (GLint i = 0; i < count; i++)
+	{
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (strcmp(name, "GL_ARB_shader_viewport_layer_array") == 0)
+			return 1;
+		if (strcmp(name, "GL_AMD_vertex_shader_layer") == 0)
+			found = 2;
+	}
+	return found;
+}
+
+void MultiView::begin(const std::vector<Camera*>& cameras, MultiViewPath path)
+{
+	// the requested path if its program linked, else the best one, else a pass per view
+	if (programs[path])
+		this->path = path;
+	else if (programs[getBestPath()])
+		this->path = getBestPath();
+	else
+		this->path = MULTI_VIEW_PASS_PER_VIEW;
+	activeViews = std::min((int)cameras.size(), viewCount);
+	for (int i = 0; i < activeViews; i++)
+		views[i] = cameras[i]->GetViewProjectionMatrix();
+	drawCalls = 0;
+
+	// a layered framebuffer clears all of its layers at once
+	glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (!programs[this->path])
+	{
+		// no passes, so nothing gets drawn with a missing program; the constructor reported it
+		activeViews = 0;
+		return;
+	}
+	glUseProgram(programs[this->path]);
+	glUniformMatrix4fv(viewsLocations[this->path], activeViews, GL_FALSE, &views[0][0][0]);
+	if (this->path == MULTI_VIEW_GEOMETRY_SHADER)
+		glUniform1i(viewCountLocation, activeViews);
+}
+
+void MultiView::beginPass(int pass)
+{
+	if (path != MULTI_VIEW_PASS_PER_VIEW)
+		return;
+	glBindFramebuffer(GL_FRAMEBUFFER, layerFBOs[pass]);
+	glUniform1i(viewIndexLocation, pass);
+}
+
+void MultiView::draw(GLuint VAO, GLsizei vertexCount, const glm::mat4& model)
+{
+	glBindVertexArray(VAO);
+	glUniformMatrix4fv(modelLocations[path], 1, GL_FALSE, &model[0][0]);
+	if (path == MULTI_VIEW_VERTEX_LAYER)
+		glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, activeViews);
+	else
+		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+	drawCalls++;
+}
+
+void MultiView::end()
+{
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void MultiView::blitToScreen(int screenWidth, int screenHeight)
+{
+	int count = activeViews > 0 ? activeViews : viewCount;
+	int columns = (int)std::ceil(std::sqrt((double)count));
+	int rows = (count + columns - 1) / columns;
+	int tileWidth = screenWidth / columns, tileHeight = screenHeight / rows;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	for (int i = 0; i < count; i++)
+	{
+		// the first view in the top left corner
+		int x = (i % columns) * tileWidth, y = screenHeight - (i / columns + 1) * tileHeight;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, layerFBOs[i]);
+		glBlitFramebuffer(0, 0, width, height, x, y, x + tileWidth, y + tileHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef MULTI_VIEW_H
+#define MULTI_VIEW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "camera.h"
+
+// must match the size of the views array the shaders are built with
+const int MAX_VIEWS = 8;
+
+enum MultiViewPath
+{
+	// one draw per object, instanced once per view; the vertex shader writes
+	// gl_Layer (ARB_shader_viewport_layer_array or AMD_vertex_shader_layer)
+	MULTI_VIEW_VERTEX_LAYER,
+	// one draw per object; a geometry shader emits every triangle once per view
+	MULTI_VIEW_GEOMETRY_SHADER,
+	// the naive way for comparison: the whole draw loop once per view
+	MULTI_VIEW_PASS_PER_VIEW,
+	MULTI_VIEW_PATH_COUNT
+};
+
+// Renders several cameras into the layers of one layered framebuffer (a color
+// and a depth texture array, a layer per view), so split-screen views,
+// mirrors, cube map faces or shadow cascades take one submission of the draw
+// loop instead of one per view:
+//
+//   multiView->begin(cameras, path);
+//   for (int pass = 0; pass < multiView->getPassCount(); pass++)
+//   {
+//       multiView->beginPass(pass);
+//       for every object: multiView->draw(VAO, vertexCount, model);
+//   }
+//   multiView->end();
+//
+// Meshes need positions at location 0 and normals at location 1.
+class MultiView
+{
+public:
+	MultiView(int width, int height, int viewCount);
+	~MultiView();
+
+	// whether the vertex shader can select the layer
+	bool isVertexLayerSupported() const { return programs[MULTI_VIEW_VERTEX_LAYER] != 0; }
+	// the fastest path the driver supports
+	MultiViewPath getBestPath() const { return isVertexLayerSupported() ? MULTI_VIEW_VERTEX_LAYER : MULTI_VIEW_GEOMETRY_SHADER; }
+
+	// binds the target, clears every layer and uploads the cameras' matrices,
+	// at most as many cameras as the target has views; a path whose program
+	// didn't link falls back to one that did, and with none there are no passes
+	void begin(const std::vector<Camera*>& cameras, MultiViewPath path);
+	int getPassCount() const { return path == MULTI_VIEW_PASS_PER_VIEW ? activeViews : 1; }
+	void beginPass(int pass);
+	// the mesh in every view of the pass
+	void draw(GLuint VAO, GLsizei vertexCount, const glm::mat4& model);
+	// back to the default framebuffer
+	void end();
+	// the layers side by side in a grid over the default framebuffer
+	void blitToScreen(int screenWidth, int screenHeight);
+
+	int getViewCount() const { return viewCount; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	GLuint getColorTexture() const { return colorArray; }
+	// draw calls issued since begin()
+	int getDrawCalls() const { return drawCalls; }
+private:
+	int width, height, viewCount;
+	GLuint colorArray, depthArray;
+	GLuint layeredFBO;              // every layer at once
+	std::vector<GLuint> layerFBOs;  // one layer each, for the pass per view and the blit
+	GLuint programs[MULTI_VIEW_PATH_COUNT]; // 0 if the path isn't supported
+	GLint viewsLocations[MULTI_VIEW_PATH_COUNT];
+	GLint modelLocations[MULTI_VIEW_PATH_COUNT];
+	GLint viewCountLocation; // of the geometry shader
+	GLint viewIndexLocation; // of the pass per view
+	MultiViewPath path;
+	int activeViews;
+	int drawCalls;
+	glm::mat4 views[MAX_VIEWS];
+
+	// the layered vertex shader needs one of these
+	static int findLayerExtension();
+};
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+// Offscreen framebuffer with a color and a depth texture. The scene is rendered
+// here so that its depth can be sampled afterwards (Hi-Z pyramid) and then
+// copied to the window.
+class RenderTarget
+{
+public:
+	RenderTarget(int width, int height);
+	~RenderTarget();
+	void resize(int width, int height);
+	// bind the framebuffer and set the viewport to its size
+	void bind();
+	// copy the color to the default framebuffer
+	void blitToScreen(int screenWidth, int screenHeight);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	GLuint getColorTexture() const { return colorTexture; }
+	GLuint getDepthTexture() const { return depthTexture; }
+private:
+	int width;
+	int height;
+	GLuint FBO;
+	GLuint colorTexture;
+	GLuint depthTexture;
+
+	void create();
+	void destroy();
+};
+
+#endif
@@ -0,0 +1,685 @@
+#include "ResourceManager.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const char* TYPE_NAMES[RESOURCE_TYPE_COUNT] = { "buffers", "vertex arrays", "textures" };
+	const unsigned int MAX_GENERATION = (1u << ResourceHandle::GENERATION_BITS) - 1;
+
+	// 64-bit FNV-1a, chain calls through seed
+	unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed = 14695981039346656037ULL)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		unsigned long long h = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			h ^= bytes[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	unsigned long long HashImage(int width, int height, int channels, const unsigned char* pixels)
+	{
+		int size[3] = { width, height, channels };
+		return HashBytes(size, sizeof(size), HashBytes(pixels, (size_t)width * height * channels));
+	}
+
+	unsigned long long HashMesh(const float* vertices, size_t floatCount, int floatsPerVertex,
+		const std::vector<VertexAttribute>& attributes)
+	{
+		// the same vertices with another layout is another vertex array over the same buffer
+		unsigned long long hash = HashBytes(vertices, floatCount * sizeof(float));
+		hash = HashBytes(&floatsPerVertex, sizeof(floatsPerVertex), hash);
+		if (!attributes.empty())
+			hash = HashBytes(attributes.data(), attributes.size() * sizeof(VertexAttribute), hash);
+		return hash;
+	}
+
+	// RGB is padded to 4 bytes by most drivers; the mip chain adds a third
+	size_t TextureBytes(int width, int height)
+	{
+		return (size_t)width * height * 4 * 4 / 3;
+	}
+
+	int MipLevels(int width, int height)
+	{
+		int levels = 1;
+		while ((width | height) >> levels)
+			levels++;
+		return levels;
+	}
+
+	ResourceHandle MakeHandle(ResourceType type, int index, unsigned int generation)
+	{
+		ResourceHandle handle = { (unsigned int)index | generation << ResourceHandle::INDEX_BITS
+			| (unsigned int)type << (ResourceHandle::INDEX_BITS + ResourceHandle::GENERATION_BITS) };
+		return handle;
+	}
+
+	void DeleteObject(ResourceType type, GLuint name)
+	{
+		if (!name)
+			return;
+		switch (type)
+		{
+		case RESOURCE_BUFFER:
+			glDeleteBuffers(1, &name);
+			break;
+		case RESOURCE_VERTEX_ARRAY:
+			glDeleteVertexArrays(1, &name);
+			break;
+		case RESOURCE_TEXTURE:
+			glDeleteTextures(1, &name);
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool LoadImageFile(const std::string& path, ImageData& image)
+	{
+		unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+		if (data && image.channels != 3 && image.channels != 4)
+		{
+			stbi_image_free(data);
+			data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 4);
+			image.channels = 4;
+		}
+		if (!data)
+		{
+			std::cout << "ERROR::RESOURCE_MANAGER::TEXTURE_LOAD_FAILED " << path << std::endl;
+			return false;
+		}
+		image.pixels.assign(data, data + (size_t)image.width * image.height * image.channels);
+		stbi_image_free(data);
+		return true;
+	}
+
+	GLuint UploadTexture(int width, int height, const unsigned char* pixels, int channels)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+		glTexImage2D(GL_TEXTURE_2D, 0, channels == 4 ? GL_RGBA8 : GL_RGB8, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+
+	void UploadMesh(const float* vertices, size_t floatCount, int floatsPerVertex, const std::vector<VertexAttribute>& attributes,
+		GLuint buffer, GLuint& VAO)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, floatCount * sizeof(float), vertices, GL_STATIC_DRAW);
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		for (size_t i = 0; i < attributes.size(); i++)
+		{
+			const VertexAttribute& a = attributes[i];
+			glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float),
+				(void*)(a.offset * sizeof(float)));
+			glEnableVertexAttribArray(a.location);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+}
+
+ResourceManager::ResourceManager() :
+	dedupHits(0), frame(1), budget(0), peakResident(0), evictions(0), mipDrops(0), reloads(0), reloadMs(0.0),
+	readFBO(0), drawFBO(0)
+{
+	for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+	{
+		pools[t].live = 0;
+		pools[t].bytes = 0;
+	}
+}
+
+ResourceManager::~ResourceManager()
+{
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		glDeleteSync(pending[i].fence);
+		for (size_t o = 0; o < pending[i].objects.size(); o++)
+			DeleteObject(pending[i].objects[o].first, pending[i].objects[o].second);
+	}
+	for (size_t o = 0; o < retiredThisFrame.size(); o++)
+		DeleteObject(retiredThisFrame[o].first, retiredThisFrame[o].second);
+	// vertex arrays first, they hold references to buffers
+	for (int t = RESOURCE_TYPE_COUNT - 1; t >= 0; t--)
+	{
+		std::vector<Slot>& slots = pools[t].slots;
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			DeleteObject((ResourceType)t, slots[i].name);
+			DeleteObject(RESOURCE_BUFFER, slots[i].buffer);
+		}
+	}
+	if (readFBO)
+	{
+		glDeleteFramebuffers(1, &readFBO);
+		glDeleteFramebuffers(1, &drawFBO);
+	}
+}
+
+const ResourceManager::Slot* ResourceManager::slotOf(ResourceHandle handle) const
+{
+	if (handle.isNull() || handle.type() >= RESOURCE_TYPE_COUNT)
+		return NULL;
+	const std::vector<Slot>& slots = pools[handle.type()].slots;
+	if (handle.index() >= (int)slots.size())
+		return NULL;
+	const Slot& slot = slots[handle.index()];
+	return slot.generation == handle.generation() && slot.refCount > 0 ? &slot : NULL;
+}
+
+ResourceManager::Slot* ResourceManager::slotOf(ResourceHandle handle)
+{
+	return const_cast<Slot*>(static_cast<const ResourceManager*>(this)->slotOf(handle));
+}
+
+ResourceHandle ResourceManager::allocate(ResourceType type, GLuint name, size_t bytes, unsigned long long hash, const std::string& key)
+{
+	Pool& pool = pools[type];
+	int index;
+	if (!pool.freeSlots.empty())
+	{
+		index = pool.freeSlots.back();
+		pool.freeSlots.pop_back();
+	}
+	else
+	{
+		index = (int)pool.slots.size();
+		if (index >= 1 << ResourceHandle::INDEX_BITS)
+		{
+			std::cout << "ERROR::RESOURCE_MANAGER::POOL_FULL " << TYPE_NAMES[type] << std::endl;
+			DeleteObject(type, name);
+			return ResourceHandle();
+		}
+		pool.slots.push_back(Slot());
+		pool.slots.back().generation = 1;
+	}
+	Slot& slot = pool.slots[index];
+	slot.name = name;
+	slot.refCount = 1;
+	slot.bytes = bytes;
+	slot.hash = hash;
+	slot.key = key;
+	slot.dependency = ResourceHandle();
+	slot.buffer = 0;
+	slot.width = slot.height = 0;
+	slot.floatsPerVertex = 0;
+	// loading isn't using, a resource nothing draws can go first
+	slot.lastUsed = frame - 1;
+	slot.droppedMips = 0;
+	slot.resident = true;
+	pool.live++;
+	pool.bytes += bytes;
+
+	ResourceHandle handle = MakeHandle(type, index, slot.generation);
+	byHash[type][hash] = handle;
+	if (!key.empty())
+		byName[type][key] = handle;
+	return handle;
+}
+
+ResourceHandle ResourceManager::reuse(ResourceType type, unsigned long long hash, const std::string& key)
+{
+	ResourceHandle handle = ResourceHandle();
+	std::map<unsigned long long, ResourceHandle>::iterator byContent = byHash[type].find(hash);
+	if (byContent != byHash[type].end())
+		handle = byContent->second;
+	else if (!key.empty())
+	{
+		std::map<std::string, ResourceHandle>::iterator named = byName[type].find(key);
+		if (named != byName[type].end())
+			handle = named->second;
+	}
+	Slot* slot = slotOf(handle);
+	if (!slot)
+		return ResourceHandle();
+	slot->refCount++;
+	dedupHits++;
+	// one more name for the same content
+	if (!key.empty() && byName[type].find(key) == byName[type].end())
+		byName[type][key] = handle;
+	return handle;
+}
+
+ResourceHandle ResourceManager::createBuffer(GLenum target, const void* data, size_t bytes, GLenum usage, const std::string& name)
+{
+	unsigned long long hash = HashBytes(&target, sizeof(target), HashBytes(data, bytes));
+	ResourceHandle loaded = reuse(RESOURCE_BUFFER, hash, name);
+	if (!loaded.isNull())
+		return loaded;
+
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, bytes, data, usage);
+	glBindBuffer(target, 0);
+	return allocate(RESOURCE_BUFFER, buffer, bytes, hash, name);
+}
+
+ResourceHandle ResourceManager::createMesh(const float* vertices, int vertexCount, int floatsPerVertex,
+	const std::vector<VertexAttribute>& attributes, const std::string& name)
+{
+	size_t floatCount = (size_t)vertexCount * floatsPerVertex;
+	unsigned long long hash = HashMesh(vertices, floatCount, floatsPerVertex, attributes);
+	ResourceHandle loaded = reuse(RESOURCE_VERTEX_ARRAY, hash, name);
+	if (!loaded.isNull())
+		return loaded;
+
+	ResourceHandle buffer = createBuffer(GL_ARRAY_BUFFER, vertices, floatCount * sizeof(float));
+	GLuint VAO;
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, get(buffer));
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const VertexAttribute& a = attributes[i];
+		glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float),
+			(void*)(a.offset * sizeof(float)));
+		glEnableVertexAttribArray(a.location);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	ResourceHandle mesh = allocate(RESOURCE_VERTEX_ARRAY, VAO, 0, hash, name);
+	Slot* slot = slotOf(mesh);
+	if (slot)
+		slot->dependency = buffer;
+	else
+		release(buffer);
+	return mesh;
+}
+
+ResourceHandle ResourceManager::createTexture(int width, int height, const unsigned char* pixels, int channels,
+	const std::string& name)
+{
+	unsigned long long hash = HashImage(width, height, channels, pixels);
+	ResourceHandle loaded = reuse(RESOURCE_TEXTURE, hash, name);
+	if (!loaded.isNull())
+		return loaded;
+
+	GLuint texture = UploadTexture(width, height, pixels, channels);
+	ResourceHandle handle = allocate(RESOURCE_TEXTURE, texture, TextureBytes(width, height), hash, name);
+	Slot* slot = slotOf(handle);
+	if (slot)
+	{
+		slot->width = width;
+		slot->height = height;
+	}
+	return handle;
+}
+
+ResourceHandle ResourceManager::loadTexture(const std::string& path)
+{
+	std::string file = path;
+	return createTexture(path, [file](ImageData& image) { return LoadImageFile(file, image); });
+}
+
+ResourceHandle ResourceManager::createTexture(const std::string& name, const TextureSource& source)
+{
+	// by the name before running the source
+	ResourceHandle loaded = find(RESOURCE_TEXTURE, name);
+	if (!loaded.isNull())
+		return loaded;
+	ImageData image;
+	if (!source(image))
+		return ResourceHandle();
+	ResourceHandle handle = createTexture(image.width, image.height, image.pixels.data(), image.channels, name);
+	Slot* slot = slotOf(handle);
+	// a new texture, not one with the same pixels
+	if (slot && slot->refCount == 1)
+		slot->textureSource = source;
+	return handle;
+}
+
+ResourceHandle ResourceManager::createMesh(const std::string& name, int floatsPerVertex,
+	const std::vector<VertexAttribute>& attributes, const MeshSource& source)
+{
+	ResourceHandle loaded = find(RESOURCE_VERTEX_ARRAY, name);
+	if (!loaded.isNull())
+		return loaded;
+	std::vector<float> vertices;
+	if (!source(vertices))
+		return ResourceHandle();
+	unsigned long long hash = HashMesh(vertices.data(), vertices.size(), floatsPerVertex, attributes);
+	loaded = reuse(RESOURCE_VERTEX_ARRAY, hash, name);
+	if (!loaded.isNull())
+		return loaded;
+
+	// owns its buffer, so evicting it frees both
+	GLuint buffer, VAO;
+	glGenBuffers(1, &buffer);
+	UploadMesh(vertices.data(), vertices.size(), floatsPerVertex, attributes, buffer, VAO);
+	ResourceHandle handle = allocate(RESOURCE_VERTEX_ARRAY, VAO, vertices.size() * sizeof(float), hash, name);
+	Slot* slot = slotOf(handle);
+	if (slot)
+	{
+		slot->buffer = buffer;
+		slot->floatsPerVertex = floatsPerVertex;
+		slot->attributes = attributes;
+		slot->meshSource = source;
+	}
+	else
+		glDeleteBuffers(1, &buffer);
+	return handle;
+}
+
+ResourceHandle ResourceManager::find(ResourceType type, const std::string& name)
+{
+	std::map<std::string, ResourceHandle>::iterator it = byName[type].find(name);
+	if (it == byName[type].end())
+		return ResourceHandle();
+	Slot* slot = slotOf(it->second);
+	if (!slot)
+		return ResourceHandle();
+	slot->refCount++;
+	dedupHits++;
+	return it->second;
+}
+
+void ResourceManager::addRef(ResourceHandle handle)
+{
+	Slot* slot = slotOf(handle);
+	if (slot)
+		slot->refCount++;
+}
+
+void ResourceManager::release(ResourceHandle handle)
+{
+	Slot* slot = slotOf(handle);
+	if (!slot || --slot->refCount > 0)
+		return;
+	// nothing finds it any more, the GL object goes once the GPU is done with it
+	ResourceType type = handle.type();
+	byHash[type].erase(slot->hash);
+	for (std::map<std::string, ResourceHandle>::iterator it = byName[type].begin(); it != byName[type].end(); )
+		if (it->second == handle)
+			it = byName[type].erase(it);
+		else
+			++it;
+	Pool& pool = pools[type];
+	pool.live--;
+	pool.bytes -= slot->bytes;
+	releasedThisFrame.push_back(handle);
+}
+
+GLuint ResourceManager::get(ResourceHandle handle) const
+{
+	const Slot* slot = slotOf(handle);
+	return slot ? slot->name : 0;
+}
+
+GLuint ResourceManager::use(ResourceHandle handle)
+{
+	Slot* slot = slotOf(handle);
+	if (!slot)
+		return 0;
+	slot->lastUsed = frame;
+	bool evictable = slot->textureSource || slot->meshSource;
+	if (evictable && (!slot->resident || slot->droppedMips > 0))
+	{
+		Clock::time_point start = Clock::now();
+		if (slot->resident)
+			unload(handle.type(), *slot);
+		load(handle.type(), *slot);
+		reloads++;
+		reloadMs += MsSince(start);
+	}
+	return slot->name;
+}
+
+size_t ResourceManager::getBytes(ResourceHandle handle) const
+{
+	const Slot* slot = slotOf(handle);
+	return slot ? slot->bytes : 0;
+}
+
+int ResourceManager::getRefCount(ResourceHandle handle) const
+{
+	const Slot* slot = slotOf(handle);
+	return slot ? slot->refCount : 0;
+}
+
+void ResourceManager::retire(ResourceType type, GLuint name)
+{
+	if (name)
+		retiredThisFrame.push_back(std::make_pair(type, name));
+}
+
+bool ResourceManager::load(ResourceType type, Slot& slot)
+{
+	if (type == RESOURCE_TEXTURE)
+	{
+		ImageData image;
+		if (!slot.textureSource(image))
+			return false;
+		slot.name = UploadTexture(image.width, image.height, image.pixels.data(), image.channels);
+		slot.width = image.width;
+		slot.height = image.height;
+		slot.bytes = TextureBytes(image.width, image.height);
+	}
+	else
+	{
+		std::vector<float> vertices;
+		if (!slot.meshSource(vertices))
+			return false;
+		glGenBuffers(1, &slot.buffer);
+		UploadMesh(vertices.data(), vertices.size(), slot.floatsPerVertex, slot.attributes, slot.buffer, slot.name);
+		slot.bytes = vertices.size() * sizeof(float);
+	}
+	slot.resident = true;
+	slot.droppedMips = 0;
+	pools[type].bytes += slot.bytes;
+	return true;
+}
+
+void ResourceManager::unload(ResourceType type, Slot& slot)
+{
+	retire(type, slot.name);
+	retire(RESOURCE_BUFFER, slot.buffer);
+	slot.name = 0;
+	slot.buffer = 0;
+	pools[type].bytes -= slot.bytes;
+	slot.bytes = 0;
+	slot.resident = false;
+	slot.droppedMips = 0;
+}
+
+bool ResourceManager::dropTopMip(Slot& slot)
+{
+	int levels = MipLevels(slot.width, slot.height);
+	if (levels <= 1)
+		return false;
+	if (!readFBO)
+	{
+		glGenFramebuffers(1, &readFBO);
+		glGenFramebuffers(1, &drawFBO);
+	}
+	GLint readBinding, drawBinding;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readBinding);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawBinding);
+
+	// level i + 1 of the old texture becomes level i of the new one, on the GPU
+	int width = std::max(slot.width >> 1, 1), height = std::max(slot.height >> 1, 1);
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (int level = 0; level < levels - 1; level++)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(width >> level, 1), std::max(height >> level, 1), 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 2);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	for (int level = 0; level < levels - 1; level++)
+	{
+		int w = std::max(width >> level, 1), h = std::max(height >> level, 1);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot.name, level + 1);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+		glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readBinding);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawBinding);
+
+	retire(RESOURCE_TEXTURE, slot.name);
+	pools[RESOURCE_TEXTURE].bytes -= slot.bytes;
+	slot.name = texture;
+	slot.width = width;
+	slot.height = height;
+	slot.bytes = TextureBytes(width, height);
+	pools[RESOURCE_TEXTURE].bytes += slot.bytes;
+	slot.droppedMips++;
+	mipDrops++;
+	return true;
+}
+
+void ResourceManager::trim()
+{
+	size_t resident = getResidentBytes();
+	if (budget == 0 || resident <= budget)
+		return;
+	// what this frame used stays, the rest goes least recently used first
+	std::vector<std::pair<unsigned int, ResourceHandle> > candidates;
+	for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+		for (size_t i = 0; i < pools[t].slots.size(); i++)
+		{
+			const Slot& slot = pools[t].slots[i];
+			if (slot.refCount > 0 && slot.resident && slot.lastUsed != frame && (slot.textureSource || slot.meshSource))
+				candidates.push_back(std::make_pair(slot.lastUsed, MakeHandle((ResourceType)t, (int)i, slot.generation)));
+		}
+	std::sort(candidates.begin(), candidates.end(),
+		[](const std::pair<unsigned int, ResourceHandle>& a, const std::pair<unsigned int, ResourceHandle>& b)
+	{
+		return a.first < b.first;
+	});
+
+	// the top mips of the textures first, a quarter of the memory each keeps them usable
+	for (size_t i = 0; i < candidates.size() && resident > budget; i++)
+	{
+		Slot* slot = slotOf(candidates[i].second);
+		if (candidates[i].second.type() != RESOURCE_TEXTURE || slot->droppedMips >= MAX_DROPPED_MIPS)
+			continue;
+		size_t before = slot->bytes;
+		if (dropTopMip(*slot))
+			resident -= before - slot->bytes;
+	}
+	for (size_t i = 0; i < candidates.size() && resident > budget; i++)
+	{
+		Slot* slot = slotOf(candidates[i].second);
+		resident -= slot->bytes;
+		unload(candidates[i].second.type(), *slot);
+		evictions++;
+	}
+}
+
+void ResourceManager::destroy(ResourceType type, int index)
+{
+	Slot& slot = pools[type].slots[index];
+	DeleteObject(type, slot.name);
+	DeleteObject(RESOURCE_BUFFER, slot.buffer);
+	slot.name = 0;
+	slot.buffer = 0;
+	slot.key.clear();
+	slot.textureSource = TextureSource();
+	slot.meshSource = MeshSource();
+	slot.attributes.clear();
+	slot.generation = slot.generation == MAX_GENERATION ? 1 : slot.generation + 1;
+	pools[type].freeSlots.push_back(index);
+	// a vertex array lets go of its buffer
+	if (!slot.dependency.isNull())
+	{
+		ResourceHandle dependency = slot.dependency;
+		slot.dependency = ResourceHandle();
+		release(dependency);
+	}
+}
+
+void ResourceManager::endFrame()
+{
+	peakResident = std::max(peakResident, getResidentBytes());
+	trim();
+	frame++;
+
+	if (!releasedThisFrame.empty() || !retiredThisFrame.empty())
+	{
+		PendingBatch batch;
+		batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		batch.handles.swap(releasedThisFrame);
+		batch.objects.swap(retiredThisFrame);
+		pending.push_back(batch);
+	}
+	// fences signal in order, stop at the first one that hasn't
+	size_t done = 0;
+	while (done < pending.size())
+	{
+		GLenum status = glClientWaitSync(pending[done].fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(pending[done].fence);
+		for (size_t i = 0; i < pending[done].handles.size(); i++)
+			destroy(pending[done].handles[i].type(), pending[done].handles[i].index());
+		for (size_t i = 0; i < pending[done].objects.size(); i++)
+			DeleteObject(pending[done].objects[i].first, pending[done].objects[i].second);
+		done++;
+	}
+	pending.erase(pending.begin(), pending.begin() + done);
+}
+
+size_t ResourceManager::getResidentBytes() const
+{
+	size_t bytes = 0;
+	for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+		bytes += pools[t].bytes;
+	return bytes;
+}
+
+int ResourceManager::getPendingCount() const
+{
+	int count = (int)releasedThisFrame.size();
+	for (size_t i = 0; i < pending.size(); i++)
+		count += (int)pending[i].handles.size();
+	return count;
+}
+
+void ResourceManager::printReport(std::ostream& out) const
+{
+	out << "Resources: " << getPendingCount() << " waiting for the GPU, " << dedupHits << " loads deduplicated" << std::endl;
+	out << std::left << std::setw(24) << "type" << std::right << std::setw(12) << "live"
+		<< std::setw(12) << "pool" << std::setw(12) << "VRAM KB" << std::endl;
+	for (int t = 0; t < RESOURCE_TYPE_COUNT; t++)
+		out << std::left << std::setw(24) << TYPE_NAMES[t] << std::right << std::setw(12) << pools[t].live
+			<< std::setw(12) << pools[t].slots.size() << std::setw(12) << pools[t].bytes / 1024 << std::endl;
+	if (budget > 0 || evictions > 0)
+		out << "Budget " << budget / 1024 << " KB, peak " << peakResident / 1024 << " KB, " << evictions << " evictions, "
+			<< mipDrops << " mip drops, " << reloads << " reloads in " << reloadMs << "ms" << std::endl;
+}
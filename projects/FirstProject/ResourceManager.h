@@ -0,0 +1,206 @@
+#pragma once
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum ResourceType
+{
+	RESOURCE_BUFFER,
+	RESOURCE_VERTEX_ARRAY,
+	RESOURCE_TEXTURE,
+	RESOURCE_TYPE_COUNT
+};
+
+// 32 bits: slot index (20), generation of the slot (10), type (2). The
+// generation changes when the slot is freed, so a handle of a destroyed
+// resource never reaches the resource that reuses its slot. 0 is no resource.
+struct ResourceHandle
+{
+	unsigned int value;
+
+	static const int INDEX_BITS = 20;
+	static const int GENERATION_BITS = 10;
+
+	int index() const { return (int)(value & ((1u << INDEX_BITS) - 1)); }
+	unsigned int generation() const { return (value >> INDEX_BITS) & ((1u << GENERATION_BITS) - 1); }
+	ResourceType type() const { return (ResourceType)(value >> (INDEX_BITS + GENERATION_BITS)); }
+	bool isNull() const { return value == 0; }
+	bool operator==(const ResourceHandle& other) const { return value == other.value; }
+	bool operator!=(const ResourceHandle& other) const { return value != other.value; }
+};
+
+// a float attribute of an interleaved vertex
+struct VertexAttribute
+{
+	GLuint location;
+	GLint components;
+	int offset;       // in floats
+};
+
+struct ImageData
+{
+	int width;
+	int height;
+	int channels;  // 3 or 4
+	std::vector<unsigned char> pixels;
+};
+
+// produce the contents of an evictable resource again, e.g. from its file;
+// false if they can't be had
+typedef std::function<bool(ImageData& image)> TextureSource;
+typedef std::function<bool(std::vector<float>& vertices)> MeshSource;
+
+// Owner of GL buffers, vertex arrays and textures. Each type lives in a pool
+// of slots that are reused through a free list; the caller only holds handles.
+//
+// Resources are reference counted: every create or load returns a reference,
+// release() drops one. Loading what is already loaded, by name or by content,
+// returns the loaded resource with one more reference, so the same image or
+// vertex data never exists twice. A resource released for the last time is
+// deleted only after the GPU has finished the frames that may still use it:
+// endFrame() puts a fence behind them and deletes what earlier fences cover.
+//
+// Resources created from a source can also be evicted while they are
+// referenced. With a VRAM budget set, endFrame() makes room when the resident
+// resources exceed it, the least recently used first: textures lose their top
+// mip levels, then whole resources are dropped. use() records the frame and
+// brings an evicted or reduced resource back from its source, so callers that
+// get the GL name through use() every frame never notice.
+class ResourceManager
+{
+public:
+	ResourceManager();
+	// deletes whatever is left; the context must be current
+	~ResourceManager();
+
+	// deduplicated by content; name, if given, also finds it by name
+	ResourceHandle createBuffer(GLenum target, const void* data, size_t bytes, GLenum usage = GL_STATIC_DRAW,
+		const std::string& name = "");
+	// a vertex array over a new (or shared) buffer of the vertices
+	ResourceHandle createMesh(const float* vertices, int vertexCount, int floatsPerVertex,
+		const std::vector<VertexAttribute>& attributes, const std::string& name = "");
+	// RGB or RGBA pixels, mipmapped, deduplicated by content
+	ResourceHandle createTexture(int width, int height, const unsigned char* pixels, int channels,
+		const std::string& name = "");
+	// an image file, evictable; the path is its name
+	ResourceHandle loadTexture(const std::string& path);
+	// evictable; loaded right away, deduplicated by name and content
+	ResourceHandle createTexture(const std::string& name, const TextureSource& source);
+	ResourceHandle createMesh(const std::string& name, int floatsPerVertex, const std::vector<VertexAttribute>& attributes,
+		const MeshSource& source);
+	// a loaded resource with one more reference; null if nothing has the name
+	ResourceHandle find(ResourceType type, const std::string& name);
+
+	void addRef(ResourceHandle handle);
+	void release(ResourceHandle handle);
+	bool isAlive(ResourceHandle handle) const { return slotOf(handle) != NULL; }
+	// the GL name, 0 for a dead handle or an evicted resource
+	GLuint get(ResourceHandle handle) const;
+	// the GL name for drawing this frame; reloads the resource in full if it was evicted or reduced
+	GLuint use(ResourceHandle handle);
+	// estimated GPU memory of the resource
+	size_t getBytes(ResourceHandle handle) const;
+	int getRefCount(ResourceHandle handle) const;
+
+	// once per frame, after the frame's commands were submitted
+	void endFrame();
+	// bytes the resident resources may take, 0 for no limit
+	void setBudget(size_t bytes) { budget = bytes; }
+	size_t getBudget() const { return budget; }
+	size_t getResidentBytes() const;
+	size_t getPeakResidentBytes() const { return peakResident; }
+
+	int getLiveCount(ResourceType type) const { return pools[type].live; }
+	int getPoolSize(ResourceType type) const { return (int)pools[type].slots.size(); }
+	size_t getVRAM(ResourceType type) const { return pools[type].bytes; }
+	// released, waiting for the GPU
+	int getPendingCount() const;
+	// creates and loads that found a loaded resource
+	int getDedupHits() const { return dedupHits; }
+	int getEvictionCount() const { return evictions; }
+	int getMipDropCount() const { return mipDrops; }
+	int getReloadCount() const { return reloads; }
+	// time spent loading evicted resources again
+	double getReloadMs() const { return reloadMs; }
+	void printReport(std::ostream& out) const;
+private:
+	struct Slot
+	{
+		GLuint name;
+		unsigned int generation;
+		int refCount;          // 0 for a free or pending slot
+		size_t bytes;
+		unsigned long long hash;
+		std::string key;       // name, empty if none
+		ResourceHandle dependency; // a vertex array's buffer
+		// evictable resources
+		TextureSource textureSource;
+		MeshSource meshSource;
+		GLuint buffer;         // owned by an evictable mesh, counted in its bytes
+		int width, height;     // of the texture's level 0 as it is now
+		int floatsPerVertex;
+		std::vector<VertexAttribute> attributes;
+		unsigned int lastUsed; // frame
+		int droppedMips;       // top levels a texture is missing
+		bool resident;
+	};
+
+	struct Pool
+	{
+		std::vector<Slot> slots;
+		std::vector<int> freeSlots;
+		int live;
+		size_t bytes;
+	};
+
+	// the slots released and the GL objects replaced in one frame, deleted
+	// once the fence is signaled
+	struct PendingBatch
+	{
+		GLsync fence;
+		std::vector<ResourceHandle> handles;
+		std::vector<std::pair<ResourceType, GLuint> > objects;
+	};
+
+	static const int MAX_DROPPED_MIPS = 2;
+
+	Pool pools[RESOURCE_TYPE_COUNT];
+	std::map<std::string, ResourceHandle> byName[RESOURCE_TYPE_COUNT];
+	std::map<unsigned long long, ResourceHandle> byHash[RESOURCE_TYPE_COUNT];
+	std::vector<ResourceHandle> releasedThisFrame;
+	std::vector<std::pair<ResourceType, GLuint> > retiredThisFrame;
+	std::vector<PendingBatch> pending;
+	int dedupHits;
+	unsigned int frame;
+	size_t budget;
+	size_t peakResident;
+	int evictions, mipDrops, reloads;
+	double reloadMs;
+	GLuint readFBO, drawFBO; // for copying mip levels
+
+	const Slot* slotOf(ResourceHandle handle) const;
+	Slot* slotOf(ResourceHandle handle);
+	ResourceHandle allocate(ResourceType type, GLuint name, size_t bytes, unsigned long long hash, const std::string& key);
+	// a loaded resource with the hash (or else the name), with one more reference
+	ResourceHandle reuse(ResourceType type, unsigned long long hash, const std::string& key);
+	void destroy(ResourceType type, int index);
+	// the GL object goes once the GPU is done with it
+	void retire(ResourceType type, GLuint name);
+	// (re)creates the GL objects of an evictable resource from its source, in full
+	bool load(ResourceType type, Slot& slot);
+	// retires the GL objects, the slot stays
+	void unload(ResourceType type, Slot& slot);
+	// replaces the texture with a copy without its top level; false if it has one level
+	bool dropTopMip(Slot& slot);
+	// evicts until the resident resources fit in the budget
+	void trim();
+};
+
+#endif
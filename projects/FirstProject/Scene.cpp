@@ -0,0 +1,503 @@
+#include "Scene.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const unsigned int BINARY_MAGIC = 0x424E4353; // "SCNB"
+	const unsigned int BINARY_VERSION = 1;
+
+	// start of a binary scene; the offsets are from the start of the file
+	struct BinaryHeader
+	{
+		unsigned int magic;
+		unsigned int version;
+		unsigned long long size;
+		unsigned long long textures, meshes, animations, objects, strings;
+		unsigned int textureCount, meshCount, animationCount, objectCount;
+	};
+
+	unsigned long long Align(unsigned long long offset)
+	{
+		return (offset + 7) & ~7ULL;
+	}
+
+	// the parsers stop at the end of the line, strtof alone would read on into the next one
+	void SkipBlanks(const char*& p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+	}
+
+	bool ParseWord(const char*& p, const char* end, std::string& word)
+	{
+		SkipBlanks(p, end);
+		const char* start = p;
+		while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+			p++;
+		word.assign(start, p);
+		return p > start;
+	}
+
+	bool ParseFloats(const char*& p, const char* end, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SkipBlanks(p, end);
+			if (p >= end)
+				return false;
+			char* next;
+			values[i] = strtof(p, &next);
+			if (next == p)
+				return false;
+			p = next;
+		}
+		return true;
+	}
+
+	bool ParseInt(const char*& p, const char* end, int& value)
+	{
+		SkipBlanks(p, end);
+		if (p >= end)
+			return false;
+		char* next;
+		value = (int)strtol(p, &next, 10);
+		if (next == p)
+			return false;
+		p = next;
+		return true;
+	}
+}
+
+Scene::Scene() : image(NULL), loadMs(0.0)
+{
+	useVectors();
+}
+
+Scene::~Scene()
+{
+	delete[] image;
+}
+
+void Scene::clear()
+{
+	textures.clear();
+	meshes.clear();
+	animations.clear();
+	objects.clear();
+	strings.clear();
+	delete[] image;
+	image = NULL;
+	useVectors();
+}
+
+void Scene::useVectors()
+{
+	textureArray = textures.data();
+	meshArray = meshes.data();
+	animationArray = animations.data();
+	objectArray = objects.data();
+	textureCount = (int)textures.size();
+	meshCount = (int)meshes.size();
+	animationCount = (int)animations.size();
+	objectCount = (int)objects.size();
+}
+
+void Scene::makeEditable()
+{
+	if (!image)
+		return;
+	std::vector<SceneTexture> loadedTextures(textureArray, textureArray + textureCount);
+	std::vector<SceneMesh> loadedMeshes(meshArray, meshArray + meshCount);
+	animations.assign(animationArray, animationArray + animationCount);
+	objects.assign(objectArray, objectArray + objectCount);
+	// the strings point into the image
+	strings.clear();
+	for (size_t i = 0; i < loadedTextures.size(); i++)
+		loadedTextures[i].path.text = addString(loadedTextures[i].path.text);
+	for (size_t i = 0; i < loadedMeshes.size(); i++)
+		loadedMeshes[i].name.text = addString(loadedMeshes[i].name.text);
+	textures.swap(loadedTextures);
+	meshes.swap(loadedMeshes);
+	delete[] image;
+	image = NULL;
+	useVectors();
+}
+
+const char* Scene::addString(const std::string& text)
+{
+	strings.push_back(text);
+	return strings.back().c_str();
+}
+
+int Scene::addTexture(const std::string& path, const glm::vec3& tint)
+{
+	makeEditable();
+	SceneTexture texture;
+	texture.path.text = addString(path);
+	texture.tint = tint;
+	texture.padding = 0.f;
+	textures.push_back(texture);
+	useVectors();
+	return textureCount - 1;
+}
+
+int Scene::addMesh(const std::string& name)
+{
+	makeEditable();
+	SceneMesh mesh;
+	mesh.name.text = addString(name);
+	meshes.push_back(mesh);
+	useVectors();
+	return meshCount - 1;
+}
+
+int Scene::addAnimation(const SceneAnimation& animation)
+{
+	makeEditable();
+	animations.push_back(animation);
+	useVectors();
+	return animationCount - 1;
+}
+
+int Scene::addObject(const SceneObject& object)
+{
+	makeEditable();
+	objects.push_back(object);
+	useVectors();
+	return objectCount - 1;
+}
+
+bool Scene::load(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+		return false;
+	}
+	unsigned int magic = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.close();
+	return magic == BINARY_MAGIC ? loadBinary(path) : loadText(path);
+}
+
+bool Scene::loadText(const std::string& path)
+{
+	Clock::time_point start = Clock::now();
+	clear();
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+		return false;
+	}
+	file.seekg(0, std::ios::end);
+	std::string content((size_t)file.tellg(), '\0');
+	file.seekg(0, std::ios::beg);
+	file.read(&content[0], content.size());
+	file.close();
+
+	const char* p = content.c_str();
+	const char* fileEnd = p + content.size();
+	std::string keyword, word;
+	int lineNumber = 0;
+	while (p < fileEnd)
+	{
+		lineNumber++;
+		const char* end = (const char*)memchr(p, '\n', fileEnd - p);
+		if (!end)
+			end = fileEnd;
+		const char* comment = (const char*)memchr(p, '#', end - p);
+		const char* lineEnd = comment ? comment : end;
+
+		bool ok = true;
+		if (ParseWord(p, lineEnd, keyword))
+		{
+			if (keyword == "texture")
+			{
+				float tint[3];
+				ok = ParseWord(p, lineEnd, word) && ParseFloats(p, lineEnd, tint, 3);
+				if (ok)
+				{
+					SceneTexture texture;
+					texture.path.text = addString(word);
+					texture.tint = glm::vec3(tint[0], tint[1], tint[2]);
+					texture.padding = 0.f;
+					textures.push_back(texture);
+				}
+			}
+			else if (keyword == "mesh")
+			{
+				ok = ParseWord(p, lineEnd, word);
+				if (ok)
+				{
+					SceneMesh mesh;
+					mesh.name.text = addString(word);
+					meshes.push_back(mesh);
+				}
+			}
+			else if (keyword == "animation")
+			{
+				float values[6];
+				ok = ParseFloats(p, lineEnd, values, 6);
+				if (ok)
+				{
+					SceneAnimation animation = {
+						glm::vec3(values[0], values[1], values[2]), values[3], values[4], values[5]
+					};
+					animations.push_back(animation);
+				}
+			}
+			else if (keyword == "object")
+			{
+				SceneObject object;
+				float values[9];
+				ok = ParseInt(p, lineEnd, object.mesh) && ParseInt(p, lineEnd, object.texture)
+					&& ParseFloats(p, lineEnd, values, 9) && ParseInt(p, lineEnd, object.animation);
+				// what an object refers to has to be listed before it
+				ok = ok && object.mesh >= 0 && object.mesh < (int)meshes.size()
+					&& object.texture >= 0 && object.texture < (int)textures.size()
+					&& object.animation >= -1 && object.animation < (int)animations.size();
+				if (ok)
+				{
+					object.position = glm::vec3(values[0], values[1], values[2]);
+					object.rotation = glm::vec3(values[3], values[4], values[5]);
+					object.scale = glm::vec3(values[6], values[7], values[8]);
+					objects.push_back(object);
+				}
+			}
+			else
+				ok = false;
+		}
+		if (!ok)
+		{
+			std::cout << "ERROR::SCENE::PARSE_ERROR " << path << ":" << lineNumber << std::endl;
+			clear();
+			return false;
+		}
+		p = end + 1;
+	}
+	useVectors();
+	loadMs = MsSince(start);
+	return true;
+}
+
+bool Scene::saveText(const std::string& path) const
+{
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_WRITTEN " << path << std::endl;
+		return false;
+	}
+	// enough digits to read back the same floats
+	file.precision(9);
+	for (int i = 0; i < textureCount; i++)
+	{
+		const SceneTexture& t = textureArray[i];
+		file << "texture " << t.path.text << " " << t.tint.x << " " << t.tint.y << " " << t.tint.z << "\n";
+	}
+	for (int i = 0; i < meshCount; i++)
+		file << "mesh " << meshArray[i].name.text << "\n";
+	for (int i = 0; i < animationCount; i++)
+	{
+		const SceneAnimation& a = animationArray[i];
+		file << "animation " << a.spin.x << " " << a.spin.y << " " << a.spin.z << " "
+			<< a.orbitRadius << " " << a.orbitSpeed << " " << a.orbitPhase << "\n";
+	}
+	for (int i = 0; i < objectCount; i++)
+	{
+		const SceneObject& o = objectArray[i];
+		file << "object " << o.mesh << " " << o.texture << " "
+			<< o.position.x << " " << o.position.y << " " << o.position.z << " "
+			<< o.rotation.x << " " << o.rotation.y << " " << o.rotation.z << " "
+			<< o.scale.x << " " << o.scale.y << " " << o.scale.z << " " << o.animation << "\n";
+	}
+	return file.good();
+}
+
+bool Scene::loadBinary(const std::string& path)
+{
+	Clock::time_point start = Clock::now();
+	clear();
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+		return false;
+	}
+	file.seekg(0, std::ios::end);
+	unsigned long long size = (unsigned long long)file.tellg();
+	file.seekg(0, std::ios::beg);
+	if (size < sizeof(BinaryHeader))
+	{
+		std::cout << "ERROR::SCENE::TRUNCATED " << path << std::endl;
+		return false;
+	}
+	image = new unsigned long long[(size + 7) / 8];
+	file.read((char*)image, size);
+	if (!file)
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+		clear();
+		return false;
+	}
+
+	char* base = (char*)image;
+	const BinaryHeader& header = *(const BinaryHeader*)base;
+	bool ok = header.magic == BINARY_MAGIC && header.version == BINARY_VERSION && header.size == size
+		&& header.textures + header.textureCount * sizeof(SceneTexture) <= size
+		&& header.meshes + header.meshCount * sizeof(SceneMesh) <= size
+		&& header.animations + header.animationCount * sizeof(SceneAnimation) <= size
+		&& header.objects + (unsigned long long)header.objectCount * sizeof(SceneObject) <= size
+		&& header.strings <= size && size > 0 && base[size - 1] == '\0';
+	if (!ok)
+	{
+		std::cout << "ERROR::SCENE::UNKNOWN_FORMAT " << path << std::endl;
+		clear();
+		return false;
+	}
+
+	SceneTexture* loadedTextures = (SceneTexture*)(base + header.textures);
+	SceneMesh* loadedMeshes = (SceneMesh*)(base + header.meshes);
+	textureArray = loadedTextures;
+	meshArray = loadedMeshes;
+	animationArray = (const SceneAnimation*)(base + header.animations);
+	objectArray = (const SceneObject*)(base + header.objects);
+	textureCount = header.textureCount;
+	meshCount = header.meshCount;
+	animationCount = header.animationCount;
+	objectCount = header.objectCount;
+
+	// the fix-up: string offsets become pointers; the string block ends with a '\0'
+	for (int i = 0; i < textureCount; i++)
+	{
+		if (loadedTextures[i].path.offset < header.strings || loadedTextures[i].path.offset >= size)
+			ok = false;
+		loadedTextures[i].path.text = ok ? base + loadedTextures[i].path.offset : "";
+	}
+	for (int i = 0; i < meshCount; i++)
+	{
+		if (loadedMeshes[i].name.offset < header.strings || loadedMeshes[i].name.offset >= size)
+			ok = false;
+		loadedMeshes[i].name.text = ok ? base + loadedMeshes[i].name.offset : "";
+	}
+	if (!ok || !validate(path))
+	{
+		if (ok)
+			std::cout << "ERROR::SCENE::UNKNOWN_FORMAT " << path << std::endl;
+		clear();
+		return false;
+	}
+	loadMs = MsSince(start);
+	return true;
+}
+
+bool Scene::validate(const std::string& path) const
+{
+	for (int i = 0; i < objectCount; i++)
+	{
+		const SceneObject& o = objectArray[i];
+		if (o.mesh < 0 || o.mesh >= meshCount || o.texture < 0 || o.texture >= textureCount
+			|| o.animation < -1 || o.animation >= animationCount)
+		{
+			std::cout << "ERROR::SCENE::BAD_OBJECT " << path << " object " << i << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Scene::saveBinary(const std::string& path) const
+{
+	BinaryHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BINARY_MAGIC;
+	header.version = BINARY_VERSION;
+	header.textureCount = textureCount;
+	header.meshCount = meshCount;
+	header.animationCount = animationCount;
+	header.objectCount = objectCount;
+	header.textures = Align(sizeof(header));
+	header.meshes = Align(header.textures + textureCount * sizeof(SceneTexture));
+	header.animations = Align(header.meshes + meshCount * sizeof(SceneMesh));
+	header.objects = Align(header.animations + animationCount * sizeof(SceneAnimation));
+	header.strings = Align(header.objects + (unsigned long long)objectCount * sizeof(SceneObject));
+
+	// the string block, with the offsets of the strings in the file
+	std::string block;
+	std::vector<SceneTexture> savedTextures(textureArray, textureArray + textureCount);
+	std::vector<SceneMesh> savedMeshes(meshArray, meshArray + meshCount);
+	for (size_t i = 0; i < savedTextures.size(); i++)
+	{
+		const char* text = savedTextures[i].path.text;
+		savedTextures[i].path.offset = header.strings + block.size();
+		block.append(text, strlen(text) + 1);
+	}
+	for (size_t i = 0; i < savedMeshes.size(); i++)
+	{
+		const char* text = savedMeshes[i].name.text;
+		savedMeshes[i].name.offset = header.strings + block.size();
+		block.append(text, strlen(text) + 1);
+	}
+	if (block.empty())
+		block.push_back('\0');
+	header.size = header.strings + block.size();
+
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::SCENE::FILE_NOT_WRITTEN " << path << std::endl;
+		return false;
+	}
+	const char zeros[8] = { 0 };
+	file.write((const char*)&header, sizeof(header));
+	file.write(zeros, header.textures - sizeof(header));
+	file.write((const char*)savedTextures.data(), textureCount * sizeof(SceneTexture));
+	file.write(zeros, header.meshes - (header.textures + textureCount * sizeof(SceneTexture)));
+	file.write((const char*)savedMeshes.data(), meshCount * sizeof(SceneMesh));
+	file.write(zeros, header.animations - (header.meshes + meshCount * sizeof(SceneMesh)));
+	file.write((const char*)animationArray, animationCount * sizeof(SceneAnimation));
+	file.write(zeros, header.objects - (header.animations + animationCount * sizeof(SceneAnimation)));
+	file.write((const char*)objectArray, (std::streamsize)objectCount * sizeof(SceneObject));
+	file.write(zeros, header.strings - (header.objects + (unsigned long long)objectCount * sizeof(SceneObject)));
+	file.write(block.data(), block.size());
+	return file.good();
+}
+
+ModelTransform Scene::transformAt(int object, double t) const
+{
+	const SceneObject& o = objectArray[object];
+	ModelTransform transform = { o.position, o.rotation, o.scale };
+	if (o.animation < 0)
+		return transform;
+	return animate(transform, animationArray[o.animation], t);
+}
+
+ModelTransform Scene::animate(const ModelTransform& base, const SceneAnimation& animation, double t)
+{
+	ModelTransform transform = base;
+	transform.rotation.x += (float)(animation.spin.x * t);
+	transform.rotation.y += (float)(animation.spin.y * t);
+	transform.rotation.z += (float)(animation.spin.z * t);
+	if (animation.orbitRadius != 0.f)
+	{
+		double angle = animation.orbitSpeed * t + animation.orbitPhase;
+		transform.position.x += animation.orbitRadius * (float)cos(angle);
+		transform.position.y += animation.orbitRadius * (float)sin(angle);
+	}
+	return transform;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+
+#include "ModelTransform.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// A string of a scene. In a binary file it holds the offset of the text from
+// the start of the file, which becomes the pointer when the file is loaded.
+union SceneString
+{
+	unsigned long long offset;
+	const char* text;
+};
+
+struct SceneTexture
+{
+	SceneString path;  // image file
+	glm::vec3 tint;    // multiplies the colors of the image
+	float padding;
+};
+
+struct SceneMesh
+{
+	SceneString name;  // a mesh the application knows, e.g. "cube"
+};
+
+// Spin around the object's own axes plus an orbit in the XY plane around its position
+struct SceneAnimation
+{
+	glm::vec3 spin;     // degrees per second around x, y, z
+	float orbitRadius;
+	float orbitSpeed;   // radians per second
+	float orbitPhase;   // radians
+};
+
+struct SceneObject
+{
+	glm::vec3 position;
+	glm::vec3 rotation; // Euler's angles at t = 0
+	glm::vec3 scale;
+	int mesh;
+	int texture;
+	int animation;      // -1 for a static object
+};
+
+// Meshes, textures, animations and objects of a scene, loaded from a file.
+//
+// The text form is for writing scenes by hand; one item per line, '#' starts a comment:
+//   texture <image path> <tint r g b>
+//   mesh <name>
+//   animation <spin x y z> <orbit radius> <orbit speed> <orbit phase>
+//   object <mesh> <texture> <position x y z> <rotation x y z> <scale x y z> <animation or -1>
+// Meshes, textures and animations are referred to by their index in the file.
+//
+// The binary form is the memory image of the arrays: it is loaded with a single
+// read, then only the strings are fixed up from offsets to pointers. The objects
+// contain no pointers, so they are used where they were read, whatever their count.
+class Scene
+{
+public:
+	Scene();
+	~Scene();
+
+	// text or binary, told apart by the first bytes of the file
+	bool load(const std::string& path);
+	bool loadText(const std::string& path);
+	bool loadBinary(const std::string& path);
+	bool saveText(const std::string& path) const;
+	bool saveBinary(const std::string& path) const;
+	void clear();
+
+	// building a scene in code; each returns the index of the new item
+	int addTexture(const std::string& path, const glm::vec3& tint);
+	int addMesh(const std::string& name);
+	int addAnimation(const SceneAnimation& animation);
+	int addObject(const SceneObject& object);
+
+	int getTextureCount() const { return textureCount; }
+	const SceneTexture& getTexture(int i) const { return textureArray[i]; }
+	int getMeshCount() const { return meshCount; }
+	const SceneMesh& getMesh(int i) const { return meshArray[i]; }
+	int getAnimationCount() const { return animationCount; }
+	const SceneAnimation& getAnimation(int i) const { return animationArray[i]; }
+	int getObjectCount() const { return objectCount; }
+	const SceneObject& getObject(int i) const { return objectArray[i]; }
+	// time of the last load, reading the file included
+	double getLoadMs() const { return loadMs; }
+	bool isBinary() const { return image != NULL; }
+
+	// the object at t seconds of its animation
+	ModelTransform transformAt(int object, double t) const;
+	// a transform at t seconds of the animation, base being where it is at t = 0
+	static ModelTransform animate(const ModelTransform& base, const SceneAnimation& animation, double t);
+private:
+	// scenes loaded from text or built in code live in these
+	std::vector<SceneTexture> textures;
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneAnimation> animations;
+	std::vector<SceneObject> objects;
+	std::deque<std::string> strings; // never moves its elements, so the pointers stay valid
+	// a loaded binary file, 8 byte aligned
+	unsigned long long* image;
+
+	// what the getters read: the vectors above or the binary image
+	const SceneTexture* textureArray;
+	const SceneMesh* meshArray;
+	const SceneAnimation* animationArray;
+	const SceneObject* objectArray;
+	int textureCount, meshCount, animationCount, objectCount;
+	double loadMs;
+
+	const char* addString(const std::string& text);
+	// points the arrays at the vectors
+	void useVectors();
+	// copies a binary image into the vectors, before it is edited
+	void makeEditable();
+	bool validate(const std::string& path) const;
+};
+
+#endif
@@ -1,71 +1,92 @@
 #include "Shader.h"
+#include "ShaderPreprocessor.h"
 #include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+Shader::Shader(const char* vertexPath, const char* fragmentPath) :
+	vertexPath(vertexPath), fragmentPath(fragmentPath)
 {
-	// 1. retrieve the vertex/fragment source code from filePath
 	std::string vertexCode;
 	std::string fragmentCode;
+	readSources(vertexPath, fragmentPath, vertexCode, fragmentCode, defines, &sourceFiles);
+	bool linked;
+	ID = compileProgram(vertexCode, fragmentCode, linked);
+}
 
-	//std::string vTempString;
-	//std::string fTempString;
-
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-
-	// ,  ifstream    
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+Shader::Shader(const char* vertexPath, const char* fragmentPath, unsigned int program,
+	const std::vector<std::string>& defines, const std::vector<std::string>& sourceFiles) :
+	ID(program), vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines), sourceFiles(sourceFiles)
+{
+}
 
-	try
-	{
-		// open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		//    
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure& e)
+bool Shader::readSources(const char* vertexPath, const char* fragmentPath, std::string& vertexCode, std::string& fragmentCode,
+	const std::vector<std::string>& defines, std::vector<std::string>* files)
+{
+	// 1. retrieve the vertex/fragment source code from filePath, with the includes expanded
+	std::vector<std::string> vertexFiles, fragmentFiles;
+	if (!ShaderPreprocessor::process(vertexPath, defines, vertexCode, vertexFiles)
+		|| !ShaderPreprocessor::process(fragmentPath, defines, fragmentCode, fragmentFiles))
+		return false;
+	if (files)
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << e.what() << std::endl;
+		*files = vertexFiles;
+		files->insert(files->end(), fragmentFiles.begin(), fragmentFiles.end());
 	}
+	return true;
+}
+
+unsigned int Shader::compileProgram(const std::string& vertexCode, const std::string& fragmentCode, bool& linked,
+	const std::vector<std::string>& feedbackVaryings)
+{
+	unsigned int vertex, fragment;
+	unsigned int program = startProgram(vertexCode, fragmentCode, vertex, fragment, feedbackVaryings);
+	linked = finishProgram(program, vertex, fragment);
+	return program;
+}
+
+unsigned int Shader::startProgram(const std::string& vertexCode, const std::string& fragmentCode,
+	unsigned int& vertex, unsigned int& fragment, const std::vector<std::string>& feedbackVaryings)
+{
 	const GLchar* vShaderCode = vertexCode.c_str();
 	const GLchar* fShaderCode = fragmentCode.c_str();
 
 	// 2.  
-	GLuint vertex, fragment;
-
 	//  
 	vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vShaderCode, NULL);
 	glCompileShader(vertex);
-	//    -  
-	checkCompileErrors(vertex, "VERTEX");
 	// fragment Shader
 	fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fShaderCode, NULL);
 	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
 	// shader Program
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	// the captured outputs are part of the link
+	if (!feedbackVaryings.empty())
+	{
+		std::vector<const GLchar*> names(feedbackVaryings.size());
+		for (size_t i = 0; i < feedbackVaryings.size(); i++)
+			names[i] = feedbackVaryings[i].c_str();
+		glTransformFeedbackVaryings(program, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+	glLinkProgram(program);
+	return program;
+}
+
+bool Shader::finishProgram(unsigned int program, unsigned int vertex, unsigned int fragment)
+{
+	//    -  
+	checkCompileErrors(vertex, "VERTEX");
+	checkCompileErrors(fragment, "FRAGMENT");
+	bool linked = checkCompileErrors(program, "PROGRAM");
 	// delete the shaders as they're linked into our program now and no longer necessary
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
+	return linked;
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
 	int success;
 	char infoLog[1024];
@@ -87,6 +108,7 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
 			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 		}
 	}
+	return success != 0;
 }
 
 Shader::~Shader()
@@ -100,33 +122,44 @@ void Shader::use()
 {
 	glUseProgram(ID);
 }
+// the varyings take effect on the next link; the shaders are still attached
+// to the program (deleting them only flags them), so just link it again
+// ------------------------------------------------------------------------
+void Shader::setTransformFeedbackVaryings(const char** varyings, int count)
+{
+	feedbackVaryings.assign(varyings, varyings + count);
+	glTransformFeedbackVaryings(ID, count, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(ID);
+	checkCompileErrors(ID, "PROGRAM");
+}
+
 // utility uniform functions
 // ------------------------------------------------------------------------
-void Shader::setBool(const std::string& name, bool value) const
+void Shader::setBool(const char* name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	glUniform1i(glGetUniformLocation(ID, name), (int)value);
 }
 // ------------------------------------------------------------------------
-void Shader::setInt(const std::string& name, int value) const
+void Shader::setInt(const char* name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1i(glGetUniformLocation(ID, name), value);
 }
 // ------------------------------------------------------------------------
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::setFloat(const char* name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+	glUniform1f(glGetUniformLocation(ID, name), value);
 }
 
-void Shader::setMatrix4f(const std::string& name, glm::mat4& m) const
+void Shader::setMatrix4f(const char* name, glm::mat4& m) const
 {
-	unsigned int transformLoc = glGetUniformLocation(ID, name.c_str());
+	unsigned int transformLoc = glGetUniformLocation(ID, name);
 	glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(m));
 }
-void Shader::setVec3(const std::string& name, glm::vec3& vec) const
+void Shader::setVec3(const char* name, glm::vec3& vec) const
 {
-	glUniform3f(glGetUniformLocation(ID, name.c_str()), vec[0], vec[1], vec[2]);
+	glUniform3f(glGetUniformLocation(ID, name), vec[0], vec[1], vec[2]);
 }
-void Shader::setVec4(const std::string& name, glm::vec4& vec) const
+void Shader::setVec4(const char* name, glm::vec4& vec) const
 {
-	glUniform4f(glGetUniformLocation(ID, name.c_str()), vec[0], vec[1], vec[2], vec[3]);
+	glUniform4f(glGetUniformLocation(ID, name), vec[0], vec[1], vec[2], vec[3]);
 }
\ No newline at end of file
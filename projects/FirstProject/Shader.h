@@ -9,6 +9,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 class Shader
 {
@@ -18,20 +19,66 @@ public:
 
 	// constructor reads and builds the shader
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// takes ownership of a program that was built elsewhere from these files
+	Shader(const char* vertexPath, const char* fragmentPath, unsigned int program,
+		const std::vector<std::string>& defines = std::vector<std::string>(),
+		const std::vector<std::string>& sourceFiles = std::vector<std::string>());
 	~Shader();
 	// use/activate the shader
 	void use();
-	// utility uniform functions
-	void setBool(const std::string& name, bool value) const;
-	void setInt(const std::string& name, int value) const;
-	void setFloat(const std::string& name, float value) const;
-	void setVec3(const std::string& name, glm::vec3 &vec) const;
-	void setVec4(const std::string& name, glm::vec4 &vec) const;
-	void setMatrix4f(const std::string& name, glm::mat4 &m) const;
+	// capture vertex shader outputs with transform feedback (relinks the program)
+	void setTransformFeedbackVaryings(const char** varyings, int count);
+	// the vertex outputs the program captures, kept so a rebuild links it the same way
+	const std::vector<std::string>& getFeedbackVaryings() const { return feedbackVaryings; }
+	void setFeedbackVaryings(const std::vector<std::string>& varyings) { feedbackVaryings = varyings; }
+
+	// the files the program was built from
+	const std::string& getVertexPath() const { return vertexPath; }
+	const std::string& getFragmentPath() const { return fragmentPath; }
+	// the permutation the program was built with
+	const std::vector<std::string>& getDefines() const { return defines; }
+	// both files and everything they include
+	const std::vector<std::string>& getSourceFiles() const { return sourceFiles; }
+	void setSourceFiles(const std::vector<std::string>& files) { sourceFiles = files; }
+	// read both files through the preprocessor; false if one of them can't be read
+	static bool readSources(const char* vertexPath, const char* fragmentPath, std::string& vertexCode, std::string& fragmentCode,
+		const std::vector<std::string>& defines = std::vector<std::string>(), std::vector<std::string>* files = NULL);
+	// compile and link a new program in the current context; the program is
+	// returned even if it failed to link, linked tells which
+	static unsigned int compileProgram(const std::string& vertexCode, const std::string& fragmentCode, bool& linked,
+		const std::vector<std::string>& feedbackVaryings = std::vector<std::string>());
+	// the same in two halves: start issues the compiles and the link without
+	// asking for any status, so the driver is free to work on them in the
+	// background; finish reports the errors and deletes the shaders
+	static unsigned int startProgram(const std::string& vertexCode, const std::string& fragmentCode,
+		unsigned int& vertex, unsigned int& fragment,
+		const std::vector<std::string>& feedbackVaryings = std::vector<std::string>());
+	static bool finishProgram(unsigned int program, unsigned int vertex, unsigned int fragment);
+
+	// utility uniform functions; string literals take the const char* versions,
+	// which don't build a std::string on every call
+	void setBool(const char* name, bool value) const;
+	void setInt(const char* name, int value) const;
+	void setFloat(const char* name, float value) const;
+	void setVec3(const char* name, glm::vec3 &vec) const;
+	void setVec4(const char* name, glm::vec4 &vec) const;
+	void setMatrix4f(const char* name, glm::mat4 &m) const;
+	void setBool(const std::string& name, bool value) const { setBool(name.c_str(), value); }
+	void setInt(const std::string& name, int value) const { setInt(name.c_str(), value); }
+	void setFloat(const std::string& name, float value) const { setFloat(name.c_str(), value); }
+	void setVec3(const std::string& name, glm::vec3 &vec) const { setVec3(name.c_str(), vec); }
+	void setVec4(const std::string& name, glm::vec4 &vec) const { setVec4(name.c_str(), vec); }
+	void setMatrix4f(const std::string& name, glm::mat4 &m) const { setMatrix4f(name.c_str(), m); }
 private:
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::vector<std::string> defines;
+	std::vector<std::string> sourceFiles;
+	std::vector<std::string> feedbackVaryings;
+
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(unsigned int shader, std::string type);
+	static bool checkCompileErrors(unsigned int shader, std::string type);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "ShaderManager.h"
+#include "ShaderPreprocessor.h"
+
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	// not part of the generated loader, both extensions share the entry point and the enum
+	typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+	const GLenum COMPLETION_STATUS = 0x91B1;
+
+	bool IsSampler(GLenum type)
+	{
+		// the unsigned vectors sit in the middle of the sampler enums
+		if (type >= GL_UNSIGNED_INT_VEC2 && type <= GL_UNSIGNED_INT_VEC4)
+			return false;
+		return (type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW)
+			|| (type >= GL_SAMPLER_1D_ARRAY && type <= GL_UNSIGNED_INT_SAMPLER_BUFFER)
+			|| (type >= GL_SAMPLER_2D_MULTISAMPLE && type <= GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY);
+	}
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+ShaderManager::ShaderManager(bool parallel) :
+	parallel(parallel), parallelExtension(false), cacheHits(0), unreadSources(0), startupMs(0.0), waitMs(0.0), warmupMs(0.0)
+{
+	if (!parallel)
+		return;
+
+	MaxShaderCompilerThreadsProc maxThreads = NULL;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+	if (maxThreads)
+	{
+		// as many threads as the driver wants to use
+		maxThreads(0xFFFFFFFF);
+		parallelExtension = true;
+	}
+}
+
+ShaderManager::~ShaderManager()
+{
+	for (size_t i = 0; i < programs.size(); i++)
+		delete programs[i];
+}
+
+Shader* ShaderManager::load(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines,
+	const std::vector<std::string>& feedbackVaryings)
+{
+	std::string vertexCode, fragmentCode;
+	std::vector<std::string> files;
+	if (!Shader::readSources(vertexPath, fragmentPath, vertexCode, fragmentCode, defines, &files))
+	{
+		std::cout << "ERROR::SHADER_MANAGER::SOURCES_NOT_READ " << vertexPath << " " << fragmentPath << std::endl;
+		unreadSources++;
+		return NULL;
+	}
+	// a separator, so moving text from one stage to the other changes the hash
+	unsigned long long key = ShaderPreprocessor::hash(fragmentCode,
+		ShaderPreprocessor::hash(std::string(1, '\0'), ShaderPreprocessor::hash(vertexCode)));
+	for (size_t i = 0; i < feedbackVaryings.size(); i++)
+		key = ShaderPreprocessor::hash(feedbackVaryings[i], ShaderPreprocessor::hash(std::string(1, '\0'), key));
+	std::map<unsigned long long, Shader*>::iterator it = cache.find(key);
+	if (it != cache.end())
+	{
+		cacheHits++;
+		return it->second;
+	}
+
+	Clock::time_point compileStart = Clock::now();
+	Shader* shader;
+	if (!parallel)
+	{
+		bool linked;
+		GLuint id = Shader::compileProgram(vertexCode, fragmentCode, linked, feedbackVaryings);
+		shader = new Shader(vertexPath, fragmentPath, id, defines, files);
+	}
+	else
+	{
+		PendingProgram program;
+		GLuint id = Shader::startProgram(vertexCode, fragmentCode, program.vertex, program.fragment, feedbackVaryings);
+		shader = new Shader(vertexPath, fragmentPath, id, defines, files);
+		program.shader = shader;
+		program.done = false;
+		pending.push_back(program);
+	}
+	startupMs += MsSince(compileStart);
+	shader->setFeedbackVaryings(feedbackVaryings);
+	cache[key] = shader;
+	programs.push_back(shader);
+	return shader;
+}
+
+bool ShaderManager::finish()
+{
+	Clock::time_point waitStart = Clock::now();
+	size_t remaining = pending.size();
+	while (remaining > 0)
+	{
+		for (size_t i = 0; i < pending.size(); i++)
+		{
+			PendingProgram& program = pending[i];
+			if (program.done)
+				continue;
+			// without the extension any status query waits for the compile, so just take them in order
+			GLint complete = GL_TRUE;
+			if (parallelExtension)
+				glGetProgramiv(program.shader->ID, COMPLETION_STATUS, &complete);
+			if (!complete)
+				continue;
+			if (!Shader::finishProgram(program.shader->ID, program.vertex, program.fragment))
+				std::cout << "ERROR::SHADER_MANAGER::PROGRAM_NOT_LINKED " << program.shader->getVertexPath()
+					<< " " << program.shader->getFragmentPath() << std::endl;
+			program.done = true;
+			remaining--;
+		}
+		if (remaining > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	pending.clear();
+	waitMs = MsSince(waitStart);
+
+	Clock::time_point warmupStart = Clock::now();
+	warmUp();
+	warmupMs = MsSince(warmupStart);
+	startupMs += waitMs + warmupMs;
+	return unreadSources == 0;
+}
+
+void ShaderManager::warmUp()
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	GLuint FBO, color, depth, VAO;
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1, 1);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glViewport(0, 0, 1, 1);
+	// no attributes enabled, the vertex shaders read constants
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		GLuint program = programs[i]->ID;
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+			continue;
+		glUseProgram(program);
+
+		// samplers of different types can't share a unit, give each one its own
+		// for the draw and put the values the program had back afterwards
+		std::vector<GLint> locations, units;
+		GLint uniformCount = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+		for (GLint u = 0; u < uniformCount; u++)
+		{
+			char name[256];
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(program, u, sizeof(name), NULL, &size, &type, name);
+			GLint location = glGetUniformLocation(program, name);
+			if (!IsSampler(type) || location < 0)
+				continue;
+			GLint unit = 0;
+			glGetUniformiv(program, location, &unit);
+			locations.push_back(location);
+			units.push_back(unit);
+			glUniform1i(location, (GLint)locations.size() - 1);
+		}
+
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		for (size_t s = 0; s < locations.size(); s++)
+			glUniform1i(locations[s], units[s]);
+	}
+	// count the driver's work on the draws as startup time
+	glFinish();
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "Shader.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+// Builds every program of the startup in one batch. load() only issues the
+// compiles and the link, so the driver can work on all of them at once
+// (with GL_KHR_parallel_shader_compile on its own threads); finish() polls
+// until they are done, reports the errors and draws once with each program,
+// so the first real frame doesn't hit a compile inside the driver.
+// Programs are cached by the hash of their expanded sources: loading the same
+// permutation twice returns the same Shader. The manager owns the shaders.
+class ShaderManager
+{
+public:
+	// parallel = false builds every program right away, like new Shader()
+	ShaderManager(bool parallel = true);
+	virtual ~ShaderManager();
+	// defines select the permutation ("NAME" or "NAME value"), feedbackVaryings
+	// are the vertex outputs captured with transform feedback;
+	// the program can't be used before finish(); NULL if the sources can't be read
+	Shader* load(const char* vertexPath, const char* fragmentPath,
+		const std::vector<std::string>& defines = std::vector<std::string>(),
+		const std::vector<std::string>& feedbackVaryings = std::vector<std::string>());
+	// false if a load() couldn't read its sources
+	bool finish();
+
+	bool isParallel() const { return parallel; }
+	// the driver compiles on its own threads
+	bool hasParallelExtension() const { return parallelExtension; }
+	int getProgramCount() const { return (int)programs.size(); }
+	const std::vector<Shader*>& getPrograms() const { return programs; }
+	// loads that found their permutation already built
+	int getCacheHits() const { return cacheHits; }
+	// spent compiling, linking and waiting for the programs, the warm-up
+	// included; the work the application does between the loads isn't
+	double getStartupMs() const { return startupMs; }
+	// the part of it spent waiting for the driver in finish()
+	double getWaitMs() const { return waitMs; }
+	double getWarmupMs() const { return warmupMs; }
+private:
+	typedef std::chrono::steady_clock Clock;
+	struct PendingProgram
+	{
+		Shader* shader;
+		GLuint vertex;
+		GLuint fragment;
+		bool done;
+	};
+
+	bool parallel;
+	bool parallelExtension;
+	std::vector<PendingProgram> pending;
+	std::vector<Shader*> programs;
+	std::map<unsigned long long, Shader*> cache; // by the hash of both expanded sources and the varyings
+	int cacheHits;
+	int unreadSources;
+	double startupMs;
+	double waitMs;
+	double warmupMs;
+
+	// one tiny draw per program into a 1x1 framebuffer
+	void warmUp();
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	std::string Directory(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// #include "name" -> name
+	bool ParseInclude(const std::string& line, std::string& name)
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+			return false;
+		size_t open = line.find('"', start + 8);
+		size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+		if (close == std::string::npos)
+			return false;
+		name = line.substr(open + 1, close - open - 1);
+		return true;
+	}
+
+	bool Expand(const std::string& path, std::string& source, std::vector<std::string>& files)
+	{
+		std::ifstream file(path.c_str());
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+			return false;
+		}
+		int index = (int)files.size();
+		files.push_back(path);
+		std::string directory = Directory(path);
+
+		std::string line, include;
+		int lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+			if (!ParseInclude(line, include))
+			{
+				source += line;
+				source += '\n';
+				continue;
+			}
+			std::string includePath = directory + include;
+			if (std::find(files.begin(), files.end(), includePath) != files.end())
+			{
+				// keep the line count of this file
+				source += '\n';
+				continue;
+			}
+			source += "#line 1 " + std::to_string(files.size()) + "\n";
+			if (!Expand(includePath, source, files))
+				return false;
+			source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+		}
+		return true;
+	}
+}
+
+bool ShaderPreprocessor::process(const std::string& path, const std::vector<std::string>& defines,
+	std::string& source, std::vector<std::string>& files)
+{
+	source.clear();
+	files.clear();
+	if (!Expand(path, source, files))
+		return false;
+	if (defines.empty())
+		return true;
+
+	std::string block;
+	for (size_t i = 0; i < defines.size(); i++)
+		block += "#define " + defines[i] + "\n";
+
+	// #version has to stay the first directive
+	size_t version = source.find("#version");
+	if (version == std::string::npos)
+	{
+		source = block + "#line 1 0\n" + source;
+		return true;
+	}
+	size_t lineEnd = source.find('\n', version);
+	lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+	int nextLine = (int)std::count(source.begin(), source.begin() + lineEnd, '\n') + 1;
+	source.insert(lineEnd, block + "#line " + std::to_string(nextLine) + " 0\n");
+	return true;
+}
+
+unsigned long long ShaderPreprocessor::hash(const std::string& text, unsigned long long seed)
+{
+	unsigned long long h = seed;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		h ^= (unsigned char)text[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
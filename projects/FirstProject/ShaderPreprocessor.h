@@ -0,0 +1,25 @@
+#pragma once
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+
+// Expands a GLSL file before it goes to the driver:
+//  - #include "file" is replaced by the file, relative to the including one;
+//    every file is included once, so cycles and repeats are harmless
+//  - the defines of a permutation ("NAME" or "NAME value") are inserted
+//    right after #version
+//  - #line directives keep the line numbers of errors; the source string
+//    number is the index of the file in the list process() returns
+class ShaderPreprocessor
+{
+public:
+	// files receives the path itself and every file it included
+	static bool process(const std::string& path, const std::vector<std::string>& defines,
+		std::string& source, std::vector<std::string>& files);
+	// 64-bit FNV-1a, chain calls through seed to hash several strings
+	static unsigned long long hash(const std::string& text, unsigned long long seed = 14695981039346656037ULL);
+};
+
+#endif
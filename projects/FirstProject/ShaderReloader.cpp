@@ -0,0 +1,210 @@
+#include "ShaderReloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	std::string FileName(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+}
+
+ShaderReloader::ShaderReloader(GLFWwindow* window, const std::string& directory) :
+	directory(directory), running(true), inotifyFd(-1), lastFailed(false), lastCompileMs(0.0),
+	reloadCount(0), lastReloadMs(0.0)
+{
+	// an invisible 1x1 window just for its context, sharing objects with the main one
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (context == NULL)
+	{
+		std::cout << "ERROR::SHADER_RELOADER::CONTEXT_NOT_CREATED" << std::endl;
+		return;
+	}
+
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK);
+	// editors either rewrite the file or move a new one over it
+	if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		std::cout << "ERROR::SHADER_RELOADER::INOTIFY_FAILED " << directory << std::endl;
+#endif
+
+	worker = std::thread(&ShaderReloader::run, this);
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	running = false;
+	if (worker.joinable())
+		worker.join();
+#ifdef __linux__
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+	// programs that never got swapped in; the caller's context is current
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		glDeleteSync(pending[i].fence);
+		glDeleteProgram(pending[i].program);
+	}
+	if (context)
+		glfwDestroyWindow(context);
+}
+
+void ShaderReloader::watch(Shader* shader)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	// cached permutations come back as the same Shader
+	if (std::find(shaders.begin(), shaders.end(), shader) == shaders.end())
+		shaders.push_back(shader);
+}
+
+void ShaderReloader::run()
+{
+	glfwMakeContextCurrent(context);
+	while (running)
+	{
+		std::vector<std::string> changed = waitForChanges(100);
+		if (changed.empty())
+			continue;
+		double changeTime = glfwGetTime();
+
+		std::vector<Shader*> affected;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < shaders.size(); i++)
+			{
+				// an edited include rebuilds every program that uses it
+				const std::vector<std::string>& files = shaders[i]->getSourceFiles();
+				for (size_t f = 0; f < files.size(); f++)
+					if (std::find(changed.begin(), changed.end(), FileName(files[f])) != changed.end())
+					{
+						affected.push_back(shaders[i]);
+						break;
+					}
+			}
+		}
+		for (size_t i = 0; i < affected.size(); i++)
+			rebuild(affected[i], changeTime);
+	}
+	glfwMakeContextCurrent(NULL);
+}
+
+void ShaderReloader::rebuild(Shader* shader, double changeTime)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::string vertexCode, fragmentCode;
+	std::vector<std::string> files;
+	if (!Shader::readSources(shader->getVertexPath().c_str(), shader->getFragmentPath().c_str(), vertexCode, fragmentCode,
+		shader->getDefines(), &files))
+	{
+		lastFailed = true;
+		return;
+	}
+	bool linked;
+	GLuint program = Shader::compileProgram(vertexCode, fragmentCode, linked, shader->getFeedbackVaryings());
+	if (!linked)
+	{
+		std::cout << "ERROR::SHADER_RELOADER::KEEPING_OLD_PROGRAM " << shader->getFragmentPath() << std::endl;
+		glDeleteProgram(program);
+		lastFailed = true;
+		return;
+	}
+	// the render thread may only use the program once this context is done with it
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	lastCompileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastFailed = false;
+	PendingProgram ready = { shader, program, fence, changeTime, files };
+	pending.push_back(ready);
+}
+
+void ShaderReloader::applyPending()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < pending.size(); )
+	{
+		PendingProgram& ready = pending[i];
+		GLenum status = glClientWaitSync(ready.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			i++;
+			continue;
+		}
+		glDeleteSync(ready.fence);
+		GLuint old = ready.shader->ID;
+		ready.shader->ID = ready.program;
+		// the edit may have added or removed includes
+		ready.shader->setSourceFiles(ready.files);
+		glDeleteProgram(old);
+		reloadCount++;
+		lastReloadMs = (glfwGetTime() - ready.changeTime) * 1000.0;
+		pending.erase(pending.begin() + i);
+	}
+}
+
+std::vector<std::string> ShaderReloader::waitForChanges(int timeoutMs)
+{
+	std::vector<std::string> changed;
+#ifdef __linux__
+	if (inotifyFd < 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		return changed;
+	}
+	pollfd fd = { inotifyFd, POLLIN, 0 };
+	if (poll(&fd, 1, timeoutMs) <= 0)
+		return changed;
+	// an editor saving a file can produce several events, collect them all
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+	ssize_t length;
+	while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* p = buffer; p < buffer + length; )
+		{
+			inotify_event* event = (inotify_event*)p;
+			if (event->len > 0 && std::find(changed.begin(), changed.end(), event->name) == changed.end())
+				changed.push_back(event->name);
+			p += sizeof(inotify_event) + event->len;
+		}
+	}
+#else
+	// no inotify: compare the modification times of the watched files
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+	std::vector<std::string> paths;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < shaders.size(); i++)
+		{
+			const std::vector<std::string>& files = shaders[i]->getSourceFiles();
+			paths.insert(paths.end(), files.begin(), files.end());
+		}
+	}
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		struct stat info;
+		if (stat(paths[i].c_str(), &info) != 0)
+			continue;
+		std::map<std::string, time_t>::iterator it = fileTimes.find(paths[i]);
+		if (it != fileTimes.end() && it->second != info.st_mtime)
+			changed.push_back(FileName(paths[i]));
+		fileTimes[paths[i]] = info.st_mtime;
+	}
+#endif
+	return changed;
+}
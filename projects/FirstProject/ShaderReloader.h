@@ -0,0 +1,74 @@
+#pragma once
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Shader.h"
+
+// Watches the shader directory and rebuilds the programs whose sources
+// changed. Compiling and linking happen on a background thread with its own
+// context that shares objects with the window, so the render thread never
+// waits for the compiler. A new program replaces the old one at the start of
+// a frame, and only if it linked; after an error the old program stays.
+// Changes are detected with inotify on Linux and by polling the file times
+// elsewhere.
+class ShaderReloader
+{
+public:
+	// must be called on the main thread, it creates a hidden window for the context
+	ShaderReloader(GLFWwindow* window, const std::string& directory);
+	~ShaderReloader();
+
+	void watch(Shader* shader);
+	// call on the render thread before drawing: swaps in the programs that are ready
+	void applyPending();
+
+	int getReloadCount() const { return reloadCount; }
+	bool lastReloadFailed() const { return lastFailed; }
+	// from the file change to the program being used, in milliseconds
+	double getLastReloadMs() const { return lastReloadMs; }
+	double getLastCompileMs() const { return lastCompileMs; }
+private:
+	struct PendingProgram
+	{
+		Shader* shader;
+		GLuint program;
+		GLsync fence;       // the link finished on the GPU side as well
+		double changeTime;  // glfwGetTime() when the change was noticed
+		std::vector<std::string> files; // sources and includes of the new program
+	};
+
+	std::string directory;
+	GLFWwindow* context;
+	std::thread worker;
+	std::atomic<bool> running;
+	int inotifyFd;
+
+	std::mutex mutex;
+	std::vector<Shader*> shaders;
+	std::vector<PendingProgram> pending;
+	std::atomic<bool> lastFailed;
+	std::atomic<double> lastCompileMs;
+	std::map<std::string, time_t> fileTimes; // for polling without inotify
+
+	// only touched by the render thread
+	int reloadCount;
+	double lastReloadMs;
+
+	void run();
+	// names of the files changed since the last call, waits up to timeoutMs for one
+	std::vector<std::string> waitForChanges(int timeoutMs);
+	void rebuild(Shader* shader, double changeTime);
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+
+ShaderVariants::ShaderVariants(ShaderManager& manager, const char* vertexPath, const char* fragmentPath)
+{
+	for (unsigned int features = 0; features <= FEATURE_MASK; features++)
+	{
+		unsigned int key = normalize(features);
+		if (key != features)
+		{
+			// normalize() only clears bits, the smaller key is already built
+			variants[features] = variants[key];
+			continue;
+		}
+		variants[features] = manager.load(vertexPath, fragmentPath, definesFor(features, false));
+		shaders.push_back(variants[features]);
+	}
+	for (int instanced = 0; instanced < 2; instanced++)
+	{
+		branching[instanced] = manager.load(vertexPath, fragmentPath, definesFor(instanced ? INSTANCED : 0, true));
+		if (std::find(shaders.begin(), shaders.end(), branching[instanced]) == shaders.end())
+			shaders.push_back(branching[instanced]);
+	}
+}
+
+Shader* ShaderVariants::get(unsigned int features, bool uniformBranches)
+{
+	if (uniformBranches)
+		return branching[(features & INSTANCED) ? 1 : 0];
+	return variants[features & FEATURE_MASK];
+}
+
+Shader* ShaderVariants::use(unsigned int features, bool uniformBranches)
+{
+	Shader* shader = get(features, uniformBranches);
+	shader->use();
+	if (uniformBranches)
+	{
+		shader->setBool("wireframeMode", (features & WIREFRAME) != 0);
+		shader->setBool("texturedMode", (features & TEXTURED) != 0);
+		shader->setBool("litMode", (features & LIT) != 0);
+	}
+	return shader;
+}
+
+unsigned int ShaderVariants::normalize(unsigned int features)
+{
+	features &= FEATURE_MASK;
+	if (features & WIREFRAME)
+		features &= ~(TEXTURED | LIT);
+	return features;
+}
+
+std::vector<std::string> ShaderVariants::definesFor(unsigned int features, bool uniformBranches)
+{
+	// every flag is always defined, so the shaders can use #if without #ifdef
+	std::vector<std::string> defines;
+	defines.push_back(std::string("WIREFRAME ") + ((features & WIREFRAME) ? "1" : "0"));
+	defines.push_back(std::string("TEXTURED ") + ((features & TEXTURED) ? "1" : "0"));
+	defines.push_back(std::string("LIT ") + ((features & LIT) ? "1" : "0"));
+	defines.push_back(std::string("INSTANCED ") + ((features & INSTANCED) ? "1" : "0"));
+	defines.push_back(std::string("UNIFORM_BRANCHES ") + (uniformBranches ? "1" : "0"));
+	return defines;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "Shader.h"
+#include "ShaderManager.h"
+
+#include <vector>
+
+// The permutations of one vertex/fragment pair, specialized by feature flags.
+// Each flag becomes a "#define NAME 0|1" and the shader tests it with #if or
+// constant conditions, so a variant contains only the code of its features.
+// For comparison there is also one program per vertex layout that keeps the
+// branches and reads the flags from uniforms instead.
+class ShaderVariants
+{
+public:
+	enum Feature
+	{
+		WIREFRAME = 1, // vertex colors only, textures and lighting are dropped
+		TEXTURED = 2,
+		LIT = 4,       // diffuse light with shadows
+		INSTANCED = 8, // per instance model matrix and layer (attributes 4..8)
+		FEATURE_MASK = 15
+	};
+
+	// builds every variant through the manager, so they compile in one batch
+	ShaderVariants(ShaderManager& manager, const char* vertexPath, const char* fragmentPath);
+
+	Shader* get(unsigned int features, bool uniformBranches = false);
+	// activates the variant; the branching program also gets the flags as uniforms
+	Shader* use(unsigned int features, bool uniformBranches = false);
+	// every distinct program, for the reloader
+	const std::vector<Shader*>& getShaders() const { return shaders; }
+
+	// features that change nothing are cleared, so they share a variant
+	static unsigned int normalize(unsigned int features);
+	static std::vector<std::string> definesFor(unsigned int features, bool uniformBranches);
+private:
+	Shader* variants[FEATURE_MASK + 1];
+	Shader* branching[2]; // without and with INSTANCED
+	std::vector<Shader*> shaders;
+};
+
+#endif
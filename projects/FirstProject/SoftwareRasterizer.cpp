@@ -0,0 +1,398 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTER_SSE2
+#endif
+
+namespace
+{
+	// clip space position followed by the attributes
+	const int CLIP_FLOATS = 12;
+
+	double MsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	unsigned int PackColor(float r, float g, float b, float a)
+	{
+		unsigned int R = (unsigned int)(std::min(std::max(r, 0.f), 1.f) * 255.f + 0.5f);
+		unsigned int G = (unsigned int)(std::min(std::max(g, 0.f), 1.f) * 255.f + 0.5f);
+		unsigned int B = (unsigned int)(std::min(std::max(b, 0.f), 1.f) * 255.f + 0.5f);
+		unsigned int A = (unsigned int)(std::min(std::max(a, 0.f), 1.f) * 255.f + 0.5f);
+		// bytes in memory: R, G, B, A
+		return R | (G << 8) | (B << 16) | (A << 24);
+	}
+
+	// 1/16 pixel, so shared edges evaluate the same from both triangles
+	double Snap(double v)
+	{
+		return floor(v * 16.0 + 0.5) / 16.0;
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, int threads) :
+	lighting(true), width(0), height(0), stride(0), tilesX(0), tilesY(0), lightDir(0.f, -1.f, 0.f), lightColor(1.f),
+	clearColor(0), triangleCount(0), setupMs(0.0), rasterMs(0.0), pool(threads)
+{
+	triangles.resize(pool.getThreadCount());
+	clip.resize(pool.getThreadCount());
+	resize(width, height);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+void SoftwareRasterizer::resize(int newWidth, int newHeight)
+{
+	newWidth = std::max(newWidth, 1);
+	newHeight = std::max(newHeight, 1);
+	if (newWidth == width && newHeight == height)
+		return;
+	width = newWidth;
+	height = newHeight;
+	// whole groups of 4 pixels per row for the SIMD loops
+	stride = (width + 3) & ~3;
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	colorBuffer.assign(stride * height, 0);
+	depthBuffer.assign(stride * height, 1.f);
+	bins.assign(triangles.size() * tilesX * tilesY, std::vector<int>());
+}
+
+int SoftwareRasterizer::addTexture(int textureWidth, int textureHeight, const unsigned char* pixels, int channels)
+{
+	Texture texture;
+	texture.width = textureWidth;
+	texture.height = textureHeight;
+	texture.texels.resize(textureWidth * textureHeight);
+	for (int i = 0; i < textureWidth * textureHeight; i++)
+	{
+		const unsigned char* p = pixels + i * channels;
+		unsigned int alpha = channels == 4 ? p[3] : 255;
+		texture.texels[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (alpha << 24);
+	}
+	textures.push_back(texture);
+	return (int)textures.size() - 1;
+}
+
+void SoftwareRasterizer::begin(const glm::mat4& pv, const glm::vec3& lightDir, const glm::vec3& lightColor,
+	const glm::vec4& clearColor)
+{
+	this->pv = pv;
+	this->lightDir = glm::normalize(lightDir);
+	this->lightColor = lightColor;
+	this->clearColor = PackColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+	commands.clear();
+}
+
+void SoftwareRasterizer::draw(const MeshData* mesh, const glm::mat4& model, int texture)
+{
+	DrawCommand command = { mesh, model, texture < (int)textures.size() ? texture : -1 };
+	commands.push_back(command);
+}
+
+void SoftwareRasterizer::end()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.run([this](int thread) { setupDraws(thread); });
+	triangleCount = 0;
+	for (size_t i = 0; i < triangles.size(); i++)
+		triangleCount += (int)triangles[i].size();
+	setupMs = MsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	pool.parallelFor(tilesX * tilesY, [this](int tile, int) { rasterizeTile(tile); });
+	rasterMs = MsSince(start);
+}
+
+void SoftwareRasterizer::setupDraws(int thread)
+{
+	int threadCount = (int)triangles.size();
+	std::vector<Triangle>& output = triangles[thread];
+	output.clear();
+	for (int tile = 0; tile < tilesX * tilesY; tile++)
+		bins[thread * tilesX * tilesY + tile].clear();
+
+	size_t first = commands.size() * thread / threadCount;
+	size_t last = commands.size() * (thread + 1) / threadCount;
+	std::vector<float>& clip = this->clip[thread];
+	for (size_t c = first; c < last; c++)
+	{
+		const DrawCommand& command = commands[c];
+		const std::vector<Vertex>& vertices = command.mesh->vertices;
+		const std::vector<unsigned int>& indices = command.mesh->indices;
+
+		// vertex stage: like basic.vert, the normal goes through mat3(model)
+		glm::mat4 pvm = pv * command.model;
+		glm::mat3 normalMatrix(command.model);
+		clip.resize(vertices.size() * CLIP_FLOATS);
+		for (size_t v = 0; v < vertices.size(); v++)
+		{
+			float* out = &clip[v * CLIP_FLOATS];
+			glm::vec4 position = pvm * glm::vec4(vertices[v].position, 1.f);
+			glm::vec3 normal = normalMatrix * vertices[v].normal;
+			out[0] = position.x; out[1] = position.y; out[2] = position.z; out[3] = position.w;
+			out[4] = vertices[v].texCoords.x; out[5] = vertices[v].texCoords.y;
+			out[6] = normal.x; out[7] = normal.y; out[8] = normal.z;
+			out[9] = vertices[v].color.r; out[10] = vertices[v].color.g; out[11] = vertices[v].color.b;
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const float* in[3] = { &clip[indices[i] * CLIP_FLOATS], &clip[indices[i + 1] * CLIP_FLOATS],
+				&clip[indices[i + 2] * CLIP_FLOATS] };
+			// distance to the near plane z = -w, inside when >= 0
+			float d[3];
+			int inside = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				d[k] = in[k][2] + in[k][3];
+				inside += d[k] >= 0.f ? 1 : 0;
+			}
+			if (inside == 0)
+				continue;
+			if (inside == 3)
+			{
+				setupTriangle(thread, in[0], in[1], in[2], command.texture);
+				continue;
+			}
+
+			// Sutherland-Hodgman against the near plane gives 3 or 4 vertices
+			float polygon[4][CLIP_FLOATS];
+			int count = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				int next = (k + 1) % 3;
+				if (d[k] >= 0.f)
+					std::copy(in[k], in[k] + CLIP_FLOATS, polygon[count++]);
+				if ((d[k] >= 0.f) != (d[next] >= 0.f))
+				{
+					float t = d[k] / (d[k] - d[next]);
+					for (int f = 0; f < CLIP_FLOATS; f++)
+						polygon[count][f] = in[k][f] + (in[next][f] - in[k][f]) * t;
+					count++;
+				}
+			}
+			for (int k = 1; k + 1 < count; k++)
+				setupTriangle(thread, polygon[0], polygon[k], polygon[k + 1], command.texture);
+		}
+	}
+
+	// binning: the triangle goes to every tile its bounding box touches
+	for (size_t t = 0; t < output.size(); t++)
+	{
+		const Triangle& triangle = output[t];
+		int tileX0 = triangle.minX / TILE_SIZE, tileX1 = triangle.maxX / TILE_SIZE;
+		int tileY0 = triangle.minY / TILE_SIZE, tileY1 = triangle.maxY / TILE_SIZE;
+		for (int ty = tileY0; ty <= tileY1; ty++)
+			for (int tx = tileX0; tx <= tileX1; tx++)
+				bins[thread * tilesX * tilesY + ty * tilesX + tx].push_back((int)t);
+	}
+}
+
+void SoftwareRasterizer::setupTriangle(int thread, const float* clip0, const float* clip1, const float* clip2, int texture)
+{
+	const float* clip[3] = { clip0, clip1, clip2 };
+	Triangle triangle;
+	double x[3], y[3];
+	for (int k = 0; k < 3; k++)
+	{
+		float invW = 1.f / clip[k][3];
+		// window coordinates, y up like the GL viewport
+		x[k] = Snap((clip[k][0] * invW * 0.5f + 0.5f) * width);
+		y[k] = Snap((clip[k][1] * invW * 0.5f + 0.5f) * height);
+		triangle.z[k] = clip[k][2] * invW * 0.5f + 0.5f;
+		triangle.invW[k] = invW;
+		for (int a = 0; a < ATTRIBUTE_COUNT; a++)
+			triangle.attributes[k][a] = clip[k][4 + a] * invW;
+	}
+
+	// counter-clockwise is the front, like glFrontFace(GL_CCW) with back face culling
+	double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0))
+		return;
+
+	double minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+	double minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+	// pixel centers are at +0.5; clamp before converting, the vertices can be far off screen
+	triangle.minX = (int)std::max(ceil(minX - 0.5), 0.0);
+	triangle.maxX = (int)std::min(floor(maxX - 0.5), width - 1.0);
+	triangle.minY = (int)std::max(ceil(minY - 0.5), 0.0);
+	triangle.maxY = (int)std::min(floor(maxY - 0.5), height - 1.0);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	// the weight of vertex k comes from the edge opposite to it. With the
+	// snapped coordinates these products are exact in doubles, so an edge
+	// shared by two triangles gives exactly opposite values: no gaps, no
+	// pixels drawn twice
+	triangle.invArea = (float)(1.0 / area);
+	for (int k = 0; k < 3; k++)
+	{
+		int a = (k + 1) % 3, b = (k + 2) % 3;
+		triangle.edgeA[k] = y[a] - y[b];
+		triangle.edgeB[k] = x[b] - x[a];
+		triangle.edgeC[k] = (y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a];
+		// left edges have the inside to the right, top edges are horizontal with the inside below
+		triangle.topLeft[k] = triangle.edgeA[k] > 0.0 || (triangle.edgeA[k] == 0.0 && triangle.edgeB[k] < 0.0);
+	}
+
+	// depth is linear in window space
+	for (int p = 0; p < 3; p++)
+		triangle.depthPlane[p] = 0.f;
+	for (int k = 0; k < 3; k++)
+	{
+		triangle.depthPlane[0] += (float)(triangle.edgeA[k] / area) * triangle.z[k];
+		triangle.depthPlane[1] += (float)(triangle.edgeB[k] / area) * triangle.z[k];
+		triangle.depthPlane[2] += (float)(triangle.edgeC[k] / area) * triangle.z[k];
+	}
+	triangle.texture = texture;
+	triangles[thread].push_back(triangle);
+}
+
+void SoftwareRasterizer::rasterizeTile(int tile)
+{
+	int tileX0 = (tile % tilesX) * TILE_SIZE, tileY0 = (tile / tilesX) * TILE_SIZE;
+	int tileX1 = std::min(tileX0 + TILE_SIZE, width) - 1, tileY1 = std::min(tileY0 + TILE_SIZE, height) - 1;
+
+	// the tile is cleared by the thread that owns it
+	for (int y = tileY0; y <= tileY1; y++)
+	{
+		std::fill(colorBuffer.begin() + y * stride + tileX0, colorBuffer.begin() + y * stride + tileX1 + 1, clearColor);
+		std::fill(depthBuffer.begin() + y * stride + tileX0, depthBuffer.begin() + y * stride + tileX1 + 1, 1.f);
+	}
+
+	// threads set up the draws in order, so walking their bins in order keeps the draw order
+	for (size_t thread = 0; thread < triangles.size(); thread++)
+	{
+		const std::vector<int>& bin = bins[thread * tilesX * tilesY + tile];
+		for (size_t b = 0; b < bin.size(); b++)
+		{
+			const Triangle& triangle = triangles[thread][bin[b]];
+			int x0 = std::max(triangle.minX, tileX0) & ~3; // tiles start at multiples of 4
+			int x1 = std::min(triangle.maxX, tileX1);
+			int y0 = std::max(triangle.minY, tileY0);
+			int y1 = std::min(triangle.maxY, tileY1);
+			float zA = triangle.depthPlane[0], zB = triangle.depthPlane[1], zC = triangle.depthPlane[2];
+
+#ifdef RASTER_SSE2
+			// the edge functions in doubles, two pixels per register
+			const __m128d zero = _mm_setzero_pd();
+			const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			const __m128 lastX = _mm_set1_ps((float)x1 + 0.5f);
+			const __m128 invArea = _mm_set1_ps(triangle.invArea);
+			const __m128 depthA = _mm_set1_ps(zA);
+			__m128d edgeA[3], topLeft[3];
+			for (int k = 0; k < 3; k++)
+			{
+				edgeA[k] = _mm_set1_pd(triangle.edgeA[k]);
+				topLeft[k] = _mm_castsi128_pd(_mm_set1_epi32(triangle.topLeft[k] ? -1 : 0));
+			}
+#endif
+			for (int y = y0; y <= y1; y++)
+			{
+				double py = y + 0.5;
+				double row[3];
+				for (int k = 0; k < 3; k++)
+					row[k] = triangle.edgeB[k] * py + triangle.edgeC[k];
+				float rowZ = zB * (float)py + zC;
+				unsigned int* color = &colorBuffer[y * stride];
+				float* depth = &depthBuffer[y * stride];
+
+				for (int x = x0; x <= x1; x += 4)
+				{
+					float weights[3][4];
+					float z[4];
+					int mask;
+#ifdef RASTER_SSE2
+					__m128d pxLow = _mm_set_pd(x + 1.5, x + 0.5);
+					__m128d pxHigh = _mm_set_pd(x + 3.5, x + 2.5);
+					__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+					mask = _mm_movemask_ps(_mm_cmple_ps(px, lastX));
+					for (int k = 0; k < 3; k++)
+					{
+						__m128d rowK = _mm_set1_pd(row[k]);
+						__m128d low = _mm_add_pd(_mm_mul_pd(edgeA[k], pxLow), rowK);
+						__m128d high = _mm_add_pd(_mm_mul_pd(edgeA[k], pxHigh), rowK);
+						// w > 0, or w == 0 on a top-left edge
+						__m128d coveredLow = _mm_or_pd(_mm_cmpgt_pd(low, zero), _mm_and_pd(_mm_cmpeq_pd(low, zero), topLeft[k]));
+						__m128d coveredHigh = _mm_or_pd(_mm_cmpgt_pd(high, zero), _mm_and_pd(_mm_cmpeq_pd(high, zero), topLeft[k]));
+						mask &= _mm_movemask_pd(coveredLow) | (_mm_movemask_pd(coveredHigh) << 2);
+						__m128 w = _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+						_mm_storeu_ps(weights[k], _mm_mul_ps(w, invArea));
+					}
+					if (mask == 0)
+						continue;
+					__m128 pixelZ = _mm_add_ps(_mm_mul_ps(depthA, px), _mm_set1_ps(rowZ));
+					mask &= _mm_movemask_ps(_mm_cmplt_ps(pixelZ, _mm_loadu_ps(depth + x)));
+					_mm_storeu_ps(z, pixelZ);
+#else
+					mask = 0;
+					for (int lane = 0; lane < 4; lane++)
+					{
+						double px = x + lane + 0.5;
+						bool inside = x + lane <= x1;
+						for (int k = 0; k < 3; k++)
+						{
+							double w = triangle.edgeA[k] * px + row[k];
+							weights[k][lane] = (float)w * triangle.invArea;
+							inside = inside && (w > 0.0 || (w == 0.0 && triangle.topLeft[k]));
+						}
+						z[lane] = zA * (float)px + rowZ;
+						if (inside && z[lane] < depth[x + lane])
+							mask |= 1 << lane;
+					}
+#endif
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (!(mask & (1 << lane)))
+							continue;
+						depth[x + lane] = z[lane];
+						color[x + lane] = shade(triangle, weights[0][lane], weights[1][lane], weights[2][lane]);
+					}
+				}
+			}
+		}
+	}
+}
+
+// basic.frag without the shadow lookup
+unsigned int SoftwareRasterizer::shade(const Triangle& triangle, float b0, float b1, float b2) const
+{
+	float invW = b0 * triangle.invW[0] + b1 * triangle.invW[1] + b2 * triangle.invW[2];
+	float w = 1.f / invW;
+	float attributes[ATTRIBUTE_COUNT];
+	for (int a = 0; a < ATTRIBUTE_COUNT; a++)
+		attributes[a] = (b0 * triangle.attributes[0][a] + b1 * triangle.attributes[1][a] + b2 * triangle.attributes[2][a]) * w;
+
+	// without a texture the vertex color is the albedo
+	float r = attributes[5], g = attributes[6], b = attributes[7], alpha = 1.f;
+	if (triangle.texture >= 0)
+	{
+		// nearest texel, repeating
+		const Texture& texture = textures[triangle.texture];
+		float u = attributes[0] - floor(attributes[0]);
+		float v = attributes[1] - floor(attributes[1]);
+		int tx = std::min((int)(u * texture.width), texture.width - 1);
+		int ty = std::min((int)(v * texture.height), texture.height - 1);
+		unsigned int texel = texture.texels[ty * texture.width + tx];
+		r = (texel & 0xFF) / 255.f;
+		g = ((texel >> 8) & 0xFF) / 255.f;
+		b = ((texel >> 16) & 0xFF) / 255.f;
+		alpha = (texel >> 24) / 255.f;
+	}
+
+	if (!lighting)
+		return PackColor(r * lightColor.r, g * lightColor.g, b * lightColor.b, alpha);
+	glm::vec3 normal = glm::normalize(glm::vec3(attributes[2], attributes[3], attributes[4]));
+	float diffuse = std::max(glm::dot(normal, -lightDir), 0.f);
+	glm::vec3 light = 0.15f * lightColor + diffuse * lightColor;
+	return PackColor(r * light.r, g * light.g, b * light.b, alpha);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// CPU renderer for machines without a GPU. It draws the same meshes with the
+// lighting of basic.frag (without shadows) into a color buffer; it needs no
+// GL context, main.cpp's --software mode runs without a window.
+//
+// A frame goes through three stages, each spread over a pool of threads:
+//  - vertices are transformed, triangles clipped against the near plane,
+//    culled and set up in screen space; every thread takes a contiguous range
+//    of draws, so the order of the draws is kept
+//  - the triangles are binned into 64x64 pixel tiles by their bounding box
+//  - the tiles are rasterized independently: edge functions and the depth
+//    test are evaluated for 4 pixels at a time (SSE2 when available), the
+//    covered pixels are shaded with perspective correct attributes
+class SoftwareRasterizer
+{
+public:
+	bool lighting; // false - albedo times the light color, like basic.frag without LIT
+
+	// threads = 0 uses every hardware thread
+	SoftwareRasterizer(int width, int height, int threads = 0);
+	~SoftwareRasterizer();
+	void resize(int width, int height);
+	// RGB or RGBA pixels; returns the index to draw with
+	int addTexture(int width, int height, const unsigned char* pixels, int channels);
+
+	// starts collecting the draws of a frame
+	void begin(const glm::mat4& pv, const glm::vec3& lightDir, const glm::vec3& lightColor, const glm::vec4& clearColor);
+	// the mesh has to stay alive until end(); texture -1 draws vertex colors
+	void draw(const MeshData* mesh, const glm::mat4& model, int texture);
+	// renders everything drawn since begin()
+	void end();
+
+	// RGBA8, the bottom row first like glTexImage2D expects; rows are getStride() pixels apart
+	const unsigned int* getColorBuffer() const { return colorBuffer.data(); }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getStride() const { return stride; }
+	int getThreadCount() const { return pool.getThreadCount(); }
+	// triangles left after clipping and culling in the last frame
+	int getTriangleCount() const { return triangleCount; }
+	double getSetupMs() const { return setupMs; }
+	double getRasterMs() const { return rasterMs; }
+private:
+	static const int TILE_SIZE = 64;
+	static const int ATTRIBUTE_COUNT = 8; // texCoords, normal, color
+
+	struct DrawCommand
+	{
+		const MeshData* mesh;
+		glm::mat4 model;
+		int texture;
+	};
+	struct Texture
+	{
+		int width;
+		int height;
+		std::vector<unsigned int> texels;
+	};
+	// a triangle ready for rasterization
+	struct Triangle
+	{
+		// edge function opposite to vertex i at pixel (x, y) = edgeA[i] * x + edgeB[i] * y + edgeC[i];
+		// times invArea it is the barycentric weight of vertex i
+		double edgeA[3], edgeB[3], edgeC[3];
+		float invArea;
+		bool topLeft[3];  // the fill rule: pixels exactly on these edges belong to the triangle
+		float z[3];       // window depth, 0..1
+		float depthPlane[3]; // depth at (x, y) = depthPlane[0] * x + depthPlane[1] * y + depthPlane[2]
+		float invW[3];
+		float attributes[3][ATTRIBUTE_COUNT]; // divided by w
+		int minX, minY, maxX, maxY;
+		int texture;
+	};
+
+	int width, height, stride;
+	int tilesX, tilesY;
+	std::vector<unsigned int> colorBuffer;
+	std::vector<float> depthBuffer;
+	std::vector<Texture> textures;
+
+	glm::mat4 pv;
+	glm::vec3 lightDir, lightColor;
+	unsigned int clearColor;
+	std::vector<DrawCommand> commands;
+	std::vector<std::vector<Triangle> > triangles;  // per thread
+	std::vector<std::vector<float> > clip;          // per thread: the transformed vertices of a draw
+	std::vector<std::vector<int> > bins;            // per thread and tile: indices into its triangles
+	int triangleCount;
+	double setupMs, rasterMs;
+
+	// the thread calling end() works as thread 0
+	ThreadPool pool;
+
+	void setupDraws(int thread);
+	void setupTriangle(int thread, const float* clip0, const float* clip1, const float* clip2, int texture);
+	void rasterizeTile(int tile);
+	unsigned int shade(const Triangle& triangle, float b0, float b1, float b2) const;
+};
+
+#endif
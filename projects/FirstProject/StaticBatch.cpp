@@ -0,0 +1,166 @@
+#include "StaticBatch.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <tuple>
+
+namespace
+{
+	// the instance layer is baked into the vertices
+	struct BatchVertex
+	{
+		Vertex vertex;
+		float layer;
+	};
+
+	// geometry of one chunk, built on a worker thread
+	struct ChunkData
+	{
+		GLuint texture;
+		std::vector<int> instances;
+		std::vector<BatchVertex> vertices;
+		std::vector<unsigned int> indices;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	void BuildChunk(const MeshData& mesh, const std::vector<StaticInstance>& instances, ChunkData& chunk)
+	{
+		chunk.vertices.reserve(chunk.instances.size() * mesh.vertices.size());
+		chunk.indices.reserve(chunk.instances.size() * mesh.indices.size());
+		chunk.boundsMin = glm::vec3(1e30f);
+		chunk.boundsMax = glm::vec3(-1e30f);
+		for (size_t i = 0; i < chunk.instances.size(); i++)
+		{
+			const glm::mat4& model = instances[chunk.instances[i]].model;
+			float layer = instances[chunk.instances[i]].layer;
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+			unsigned int base = (unsigned int)chunk.vertices.size();
+			for (size_t v = 0; v < mesh.vertices.size(); v++)
+			{
+				BatchVertex vertex = { mesh.vertices[v], layer };
+				vertex.vertex.position = glm::vec3(model * glm::vec4(vertex.vertex.position, 1.f));
+				vertex.vertex.normal = glm::normalize(normalMatrix * vertex.vertex.normal);
+				chunk.boundsMin = glm::min(chunk.boundsMin, vertex.vertex.position);
+				chunk.boundsMax = glm::max(chunk.boundsMax, vertex.vertex.position);
+				chunk.vertices.push_back(vertex);
+			}
+			for (size_t k = 0; k < mesh.indices.size(); k++)
+				chunk.indices.push_back(base + mesh.indices[k]);
+		}
+	}
+}
+
+StaticBatch::StaticBatch(const MeshData& mesh, const std::vector<StaticInstance>& instances, float chunkSize, int threads) :
+	visibleVersion(0)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// bucket the instances by material and grid cell
+	std::map<std::tuple<GLuint, int, int, int>, size_t> cells;
+	std::vector<ChunkData> data;
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		glm::vec3 cell = glm::floor(glm::vec3(instances[i].model[3]) / chunkSize);
+		std::tuple<GLuint, int, int, int> key(instances[i].texture, (int)cell.x, (int)cell.y, (int)cell.z);
+		std::map<std::tuple<GLuint, int, int, int>, size_t>::iterator it = cells.find(key);
+		if (it == cells.end())
+		{
+			it = cells.insert(std::make_pair(key, data.size())).first;
+			data.push_back(ChunkData());
+			data.back().texture = instances[i].texture;
+		}
+		data[it->second].instances.push_back((int)i);
+	}
+
+	// transform the chunks in parallel
+	ThreadPool pool(threads);
+	pool.parallelFor((int)data.size(), [&](int c, int)
+	{
+		BuildChunk(mesh, instances, data[c]);
+	});
+
+	// upload
+	for (size_t c = 0; c < data.size(); c++)
+	{
+		StaticChunk chunk;
+		chunk.center = (data[c].boundsMin + data[c].boundsMax) * 0.5f;
+		chunk.extent = (data[c].boundsMax - data[c].boundsMin) * 0.5f;
+		chunk.texture = data[c].texture;
+		chunk.indexCount = (GLsizei)data[c].indices.size();
+
+		glGenVertexArrays(1, &chunk.VAO);
+		glGenBuffers(1, &chunk.VBO);
+		glGenBuffers(1, &chunk.EBO);
+		glBindVertexArray(chunk.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+		glBufferData(GL_ARRAY_BUFFER, data[c].vertices.size() * sizeof(BatchVertex), data[c].vertices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(Vertex, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(Vertex, texCoords));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(Vertex, color));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, layer));
+		glEnableVertexAttribArray(4);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, data[c].indices.size() * sizeof(unsigned int), data[c].indices.data(), GL_STATIC_DRAW);
+		glBindVertexArray(0);
+		chunks.push_back(chunk);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+StaticBatch::~StaticBatch()
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		glDeleteVertexArrays(1, &chunks[i].VAO);
+		glDeleteBuffers(1, &chunks[i].VBO);
+		glDeleteBuffers(1, &chunks[i].EBO);
+	}
+}
+
+int StaticBatch::draw(Camera& camera)
+{
+	return drawChunks(camera, true);
+}
+
+int StaticBatch::drawDepth(Camera& camera)
+{
+	return drawChunks(camera, false);
+}
+
+int StaticBatch::drawChunks(Camera& camera, bool bindTextures)
+{
+	if (camera.GetVersion() != visibleVersion)
+	{
+		const Frustum& frustum = camera.GetFrustum();
+		visible.clear();
+		for (size_t i = 0; i < chunks.size(); i++)
+			if (frustum.intersectsBox(chunks[i].center, chunks[i].extent))
+				visible.push_back((int)i);
+		visibleVersion = camera.GetVersion();
+	}
+
+	int drawCalls = 0;
+	for (size_t i = 0; i < visible.size(); i++)
+	{
+		const StaticChunk& chunk = chunks[visible[i]];
+		if (bindTextures)
+			glBindTexture(GL_TEXTURE_2D_ARRAY, chunk.texture);
+		glBindVertexArray(chunk.VAO);
+		glDrawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT, 0);
+		drawCalls++;
+	}
+	glBindVertexArray(0);
+	return drawCalls;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Mesh.h"
+#include "camera.h"
+
+// an object that never moves
+struct StaticInstance
+{
+	glm::mat4 model;
+	GLuint texture; // texture array of the material: instances of different arrays never share a chunk
+	float layer;    // layer in that array, stored per vertex
+};
+
+struct StaticChunk
+{
+	glm::vec3 center;   // world space bounds
+	glm::vec3 extent;
+	GLuint texture;
+	GLuint VAO;
+	GLuint VBO;
+	GLuint EBO;
+	GLsizei indexCount;
+};
+
+// Static geometry merged at load time: the instances are transformed into
+// world space and concatenated into one vertex/index buffer per material and
+// grid cell, so every chunk is a single draw call and can still be culled.
+// The transformation runs on worker threads; only the upload is on the GL thread.
+class StaticBatch
+{
+public:
+	// chunkSize - edge of the grid cells in world units; threads = 0 uses all cores
+	StaticBatch(const MeshData& mesh, const std::vector<StaticInstance>& instances, float chunkSize, int threads = 0);
+	~StaticBatch();
+
+	// draw the chunks in the camera's frustum with the shader in use, whose
+	// model matrix must be identity; returns the number of draw calls. The
+	// chunks never move, so the culling result is kept until the camera changes.
+	int draw(Camera& camera);
+	// same, without binding textures, for depth-only passes
+	int drawDepth(Camera& camera);
+
+	int getChunkCount() const { return (int)chunks.size(); }
+	double getBuildMs() const { return buildMs; }
+private:
+	std::vector<StaticChunk> chunks;
+	double buildMs;
+	std::vector<int> visible;    // the chunks in the frustum of the camera version
+	unsigned int visibleVersion; // 0 for none
+
+	int drawChunks(Camera& camera, bool bindTextures);
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "TextureArray.h"
+
+#include <algorithm>
+#include <iostream>
+
+TextureArray::TextureArray(int width, int height, GLenum internalFormat, int capacity) :
+	width(width), height(height), internalFormat(internalFormat), capacity(std::max(capacity, 1)),
+	used(0), version(0)
+{
+	glGenFramebuffers(1, &readFBO);
+	glGenFramebuffers(1, &drawFBO);
+	texture = createStorage(this->capacity);
+}
+
+TextureArray::~TextureArray()
+{
+	glDeleteTextures(1, &texture);
+	glDeleteFramebuffers(1, &readFBO);
+	glDeleteFramebuffers(1, &drawFBO);
+}
+
+GLuint TextureArray::createStorage(int layers)
+{
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return tex;
+}
+
+void TextureArray::copyLayer(GLuint src, int srcLayer, GLuint dst, int dstLayer)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, src, 0, srcLayer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dst, 0, dstLayer);
+	if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::TEXTURE_ARRAY::FORMAT_NOT_RENDERABLE" << std::endl;
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void TextureArray::reallocate(int newCapacity)
+{
+	GLint readBinding, drawBinding;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readBinding);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawBinding);
+
+	GLuint newTexture = createStorage(newCapacity);
+	for (int layer = 0; layer < (int)idOf.size(); layer++)
+		if (idOf[layer] >= 0)
+			copyLayer(texture, layer, newTexture, layer);
+	glDeleteTextures(1, &texture);
+	texture = newTexture;
+	capacity = newCapacity;
+	version++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readBinding);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawBinding);
+}
+
+int TextureArray::add(const unsigned char* pixels, GLenum format)
+{
+	// the first hole, or a new layer at the end
+	int layer = (int)(std::find(idOf.begin(), idOf.end(), -1) - idOf.begin());
+	if (layer == (int)idOf.size())
+	{
+		if (layer == capacity)
+			reallocate(capacity * 2);
+		idOf.push_back(-1);
+	}
+
+	int id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else
+	{
+		id = (int)layerOf.size();
+		layerOf.push_back(-1);
+	}
+	layerOf[id] = layer;
+	idOf[layer] = id;
+	used++;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return id;
+}
+
+void TextureArray::remove(int id)
+{
+	int layer = layerOf[id];
+	if (layer < 0)
+		return;
+	idOf[layer] = -1;
+	layerOf[id] = -1;
+	freeIds.push_back(id);
+	used--;
+	// holes at the end are not layers anymore
+	while (!idOf.empty() && idOf.back() == -1)
+		idOf.pop_back();
+}
+
+bool TextureArray::defragment()
+{
+	GLint readBinding, drawBinding;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readBinding);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawBinding);
+
+	// fill the lowest hole with the highest layer until the layers are dense
+	bool moved = false;
+	int hole = 0;
+	while (true)
+	{
+		while (hole < (int)idOf.size() && idOf[hole] != -1)
+			hole++;
+		if (hole >= (int)idOf.size())
+			break;
+		int last = (int)idOf.size() - 1;
+		int id = idOf[last];
+		copyLayer(texture, last, texture, hole);
+		idOf[hole] = id;
+		layerOf[id] = hole;
+		idOf.pop_back();
+		while (!idOf.empty() && idOf.back() == -1)
+			idOf.pop_back();
+		moved = true;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readBinding);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawBinding);
+
+	if (moved)
+		version++;
+	// give the memory back when less than a quarter is used
+	if (capacity > 4 && used * 4 < capacity)
+		reallocate(std::max(used * 2, 4));
+	return moved;
+}
+
+TextureArrayManager::TextureArrayManager()
+{
+}
+
+TextureArrayManager::~TextureArrayManager()
+{
+	for (size_t i = 0; i < arrays.size(); i++)
+		delete arrays[i];
+}
+
+TextureSlot TextureArrayManager::add(int width, int height, const unsigned char* pixels, GLenum format, GLenum internalFormat)
+{
+	TextureSlot slot;
+	slot.array = -1;
+	for (size_t i = 0; i < arrays.size(); i++)
+		if (arrays[i]->getWidth() == width && arrays[i]->getHeight() == height
+			&& arrays[i]->getInternalFormat() == internalFormat)
+			slot.array = (int)i;
+	if (slot.array < 0)
+	{
+		slot.array = (int)arrays.size();
+		arrays.push_back(new TextureArray(width, height, internalFormat));
+	}
+	slot.id = arrays[slot.array]->add(pixels, format);
+	return slot;
+}
+
+void TextureArrayManager::remove(const TextureSlot& slot)
+{
+	arrays[slot.array]->remove(slot.id);
+}
+
+bool TextureArrayManager::defragment()
+{
+	bool moved = false;
+	for (size_t i = 0; i < arrays.size(); i++)
+		moved = arrays[i]->defragment() || moved;
+	return moved;
+}
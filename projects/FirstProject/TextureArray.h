@@ -0,0 +1,87 @@
+#pragma once
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Textures of one size and format stored as layers of a GL_TEXTURE_2D_ARRAY,
+// so draws that use different textures can share one binding and pick the
+// texture with a layer index. Textures are referred to by ids that survive
+// the layers moving around on growth and defragmentation.
+class TextureArray
+{
+public:
+	TextureArray(int width, int height, GLenum internalFormat, int capacity = 4);
+	~TextureArray();
+
+	// upload a texture of the array size; format is GL_RGB or GL_RGBA
+	// returns its id
+	int add(const unsigned char* pixels, GLenum format);
+	// free the layer of the texture; the hole is reused by add() or closed by defragment()
+	void remove(int id);
+	// move the last layers into the holes and shrink the storage if it is mostly empty;
+	// returns true if any layer moved, layers of the ids have to be fetched again then
+	bool defragment();
+
+	// current layer of the texture
+	int getLayer(int id) const { return layerOf[id]; }
+	// layers up to the last used one, holes included
+	int getLayerCount() const { return (int)idOf.size(); }
+	int getUsedLayers() const { return used; }
+	int getCapacity() const { return capacity; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	GLenum getInternalFormat() const { return internalFormat; }
+	GLuint getTexture() const { return texture; }
+	// changes every time layers move or the storage is reallocated (new texture name)
+	int getVersion() const { return version; }
+private:
+	int width;
+	int height;
+	GLenum internalFormat;
+	int capacity;
+	int used;
+	int version;
+	GLuint texture;
+	GLuint readFBO;
+	GLuint drawFBO;
+
+	std::vector<int> layerOf;   // id -> layer, -1 when removed
+	std::vector<int> idOf;      // layer -> id, -1 for a hole
+	std::vector<int> freeIds;
+
+	GLuint createStorage(int layers);
+	// copy level 0 of a layer with the framebuffer blit, no glCopyImageSubData in GL 3.3
+	void copyLayer(GLuint src, int srcLayer, GLuint dst, int dstLayer);
+	void reallocate(int newCapacity);
+};
+
+struct TextureSlot
+{
+	int array;  // index in TextureArrayManager
+	int id;     // id in that array
+};
+
+// Sorts textures into arrays by size and format
+class TextureArrayManager
+{
+public:
+	TextureArrayManager();
+	~TextureArrayManager();
+
+	TextureSlot add(int width, int height, const unsigned char* pixels, GLenum format, GLenum internalFormat = GL_RGBA8);
+	void remove(const TextureSlot& slot);
+	// defragment every array; returns true if any layer moved
+	bool defragment();
+
+	int getArrayCount() const { return (int)arrays.size(); }
+	TextureArray* getArray(int i) { return arrays[i]; }
+	GLuint getTexture(const TextureSlot& slot) const { return arrays[slot.array]->getTexture(); }
+	float getLayer(const TextureSlot& slot) const { return (float)arrays[slot.array]->getLayer(slot.id); }
+private:
+	std::vector<TextureArray*> arrays;
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include "TextureStreamer.h"
+
+#include "stb_image.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	// 2x2 box filter; an odd last row or column is averaged with itself
+	void Downsample(const std::vector<unsigned char>& source, int& width, int& height, std::vector<unsigned char>& target)
+	{
+		int targetWidth = std::max(width / 2, 1), targetHeight = std::max(height / 2, 1);
+		target.resize((size_t)targetWidth * targetHeight * 4);
+		for (int y = 0; y < targetHeight; y++)
+		{
+			int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c]
+						+ source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+					target[((size_t)y * targetWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		width = targetWidth;
+		height = targetHeight;
+	}
+}
+
+TextureStreamer::TextureStreamer() : uploadBudget(4 * 1024 * 1024), nextTexture(0), uploadedBytes(0),
+	uploads(0), decodes(0), drops(0), stopping(false)
+{
+	worker = std::thread(&TextureStreamer::workerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+	for (size_t i = 0; i < textures.size(); i++)
+		glDeleteTextures(1, &textures[i].name);
+}
+
+int TextureStreamer::add(const std::string& path)
+{
+	int width, height, channels;
+	if (!stbi_info(path.c_str(), &width, &height, &channels))
+	{
+		std::cout << "ERROR::TEXTURE_STREAMER::NOT_AN_IMAGE " << path << std::endl;
+		return -1;
+	}
+	Texture texture;
+	texture.path = path;
+	texture.width = width;
+	texture.height = height;
+	texture.levels = 1;
+	while ((std::max(width, height) >> texture.levels) > 0)
+		texture.levels++;
+	// nothing is resident until the worker has decoded the coarsest level; a
+	// grey 1x1 stands in for it
+	texture.resident = texture.levels;
+	texture.requested = texture.levels - 1;
+	texture.needed = texture.levels - 1;
+	texture.loading = -1;
+	texture.unneededFrames = 0;
+	texture.failed = false;
+	texture.staged.resize(texture.levels);
+
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	glGenTextures(1, &texture.name);
+	glBindTexture(GL_TEXTURE_2D, texture.name);
+	glTexImage2D(GL_TEXTURE_2D, texture.levels - 1, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	textures.push_back(texture);
+	return (int)textures.size() - 1;
+}
+
+int TextureStreamer::requiredLevel(int texture, Camera& camera, const glm::vec3& center, float radius, int viewportHeight,
+	float repeats) const
+{
+	const Texture& t = textures[texture];
+	float depth = glm::dot(center - camera.Position, camera.Front);
+	if (depth < -radius)
+		return -1;
+	// closer than the near plane it can't get any bigger
+	depth = std::max(depth, camera.zNear);
+	// projection[1][1] is 1 / tan(fov / 2): the diameter in NDC is 2r * [1][1] / depth, the viewport is 2 NDC high
+	const glm::mat4& projection = camera.GetProjectionMatrix();
+	float pixels = radius * projection[1][1] * viewportHeight / depth;
+	float texels = std::max(t.width, t.height) * repeats;
+	if (pixels >= texels)
+		return 0;
+	int level = (int)std::floor(std::log2(texels / std::max(pixels, 1e-6f)));
+	return std::min(level, t.levels - 1);
+}
+
+void TextureStreamer::request(int texture, int level)
+{
+	Texture& t = textures[texture];
+	t.requested = std::min(t.requested, std::max(level, 0));
+}
+
+void TextureStreamer::update()
+{
+	// what the worker has finished since the last update
+	std::vector<Result> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(results);
+	}
+	for (size_t i = 0; i < finished.size(); i++)
+	{
+		Result& result = finished[i];
+		Texture& t = textures[result.texture];
+		t.loading = -1;
+		if (result.levels.empty())
+		{
+			std::cout << "ERROR::TEXTURE_STREAMER::LOAD_FAILED " << t.path << std::endl;
+			t.failed = true;
+			continue;
+		}
+		decodes++;
+		for (size_t l = 0; l < result.levels.size(); l++)
+		{
+			int level = result.finest + (int)l;
+			if (level < t.resident && t.staged[level].empty())
+				t.staged[level].swap(result.levels[l]);
+		}
+	}
+
+	int maxLevels = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		Texture& t = textures[i];
+		t.needed = t.requested;
+		t.requested = t.levels - 1;
+		maxLevels = std::max(maxLevels, t.levels);
+	}
+
+	// the coarsest levels of all textures first, then the next finer ones, until the budget is used
+	int count = (int)textures.size();
+	size_t sent = 0;
+	bool full = false;
+	for (int level = maxLevels - 1; level >= 0 && !full; level--)
+		for (int n = 0; n < count; n++)
+		{
+			int index = (nextTexture + n) % count;
+			Texture& t = textures[index];
+			if (t.resident - 1 != level || level < t.needed || t.staged[level].empty())
+				continue;
+			size_t bytes = levelBytes(t, level);
+			if (sent > 0 && sent + bytes > uploadBudget)
+			{
+				// the next update starts where this one stopped
+				nextTexture = index;
+				full = true;
+				break;
+			}
+			upload(t, level, t.staged[level].data());
+			std::vector<unsigned char>().swap(t.staged[level]);
+			sent += bytes;
+		}
+
+	for (int i = 0; i < count; i++)
+	{
+		Texture& t = textures[i];
+		if (t.needed > t.resident)
+		{
+			if (++t.unneededFrames >= DROP_DELAY)
+				dropTo(t, t.needed);
+			continue;
+		}
+		t.unneededFrames = 0;
+		if (t.failed || t.loading >= 0 || t.needed >= t.resident)
+			continue;
+		// the coarsest missing level that isn't decoded yet; one level finer than
+		// needed comes along, so an approaching object doesn't decode the file again right away
+		int coarsest = -1;
+		for (int level = t.resident - 1; level >= t.needed && coarsest < 0; level--)
+			if (t.staged[level].empty())
+				coarsest = level;
+		if (coarsest < 0)
+			continue;
+		Job job = { i, t.path, std::max(t.needed - 1, 0), coarsest };
+		t.loading = job.finest;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+		wake.notify_one();
+	}
+}
+
+void TextureStreamer::upload(Texture& texture, int level, const unsigned char* pixels)
+{
+	glBindTexture(GL_TEXTURE_2D, texture.name);
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelWidth(texture, level), levelHeight(texture, level), 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.resident = level;
+	uploads++;
+	uploadedBytes += levelBytes(texture, level);
+}
+
+void TextureStreamer::dropTo(Texture& texture, int level)
+{
+	glBindTexture(GL_TEXTURE_2D, texture.name);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	// a level redefined as empty gives its memory back
+	for (int l = texture.resident; l < level; l++)
+		glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	for (int l = 0; l < level - 1; l++)
+		std::vector<unsigned char>().swap(texture.staged[l]);
+	texture.resident = level;
+	texture.unneededFrames = 0;
+	drops++;
+}
+
+void TextureStreamer::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [&]() { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+		Job job = jobs.front();
+		jobs.pop_front();
+		lock.unlock();
+
+		Result result;
+		result.texture = job.texture;
+		result.finest = job.finest;
+		int width, height, channels;
+		unsigned char* data = stbi_load(job.path.c_str(), &width, &height, &channels, 4);
+		if (data)
+		{
+			std::vector<unsigned char> level(data, data + (size_t)width * height * 4), next;
+			stbi_image_free(data);
+			for (int l = 0; l <= job.coarsest; l++)
+			{
+				if (l >= job.finest)
+					result.levels.push_back(level);
+				if (l < job.coarsest)
+				{
+					Downsample(level, width, height, next);
+					level.swap(next);
+				}
+			}
+		}
+
+		lock.lock();
+		results.push_back(result);
+	}
+}
+
+StreamingStats TextureStreamer::getStats() const
+{
+	StreamingStats stats = {};
+	stats.textures = (int)textures.size();
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		const Texture& t = textures[i];
+		stats.residentLevels += t.levels - t.resident;
+		stats.requestedLevels += t.levels - t.needed;
+		stats.missingLevels += std::max(t.resident - t.needed, 0);
+		stats.excessLevels += std::max(t.needed - t.resident, 0);
+		for (int level = 0; level < t.levels; level++)
+		{
+			size_t bytes = levelBytes(t, level);
+			stats.fullBytes += bytes;
+			if (level >= t.resident)
+				stats.residentBytes += bytes;
+			if (level >= t.needed)
+				stats.requestedBytes += bytes;
+		}
+	}
+	stats.uploadedBytes = uploadedBytes;
+	stats.uploads = uploads;
+	stats.decodes = decodes;
+	stats.drops = drops;
+	return stats;
+}
+
+void TextureStreamer::printReport(std::ostream& out) const
+{
+	StreamingStats stats = getStats();
+	int allLevels = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+		allLevels += textures[i].levels;
+	const double MB = 1024.0 * 1024.0;
+	out << "Streaming: " << stats.textures << " textures, " << stats.decodes << " decodes, " << stats.uploads
+		<< " level uploads of " << stats.uploadedBytes / MB << " MB, " << stats.drops << " drops" << std::endl;
+	out << std::left << std::setw(24) << "mips" << std::right << std::setw(12) << "levels" << std::setw(12) << "MB" << std::endl;
+	out << std::left << std::setw(24) << "resident" << std::right << std::setw(12) << stats.residentLevels
+		<< std::setw(12) << stats.residentBytes / MB << std::endl;
+	out << std::left << std::setw(24) << "requested" << std::right << std::setw(12) << stats.requestedLevels
+		<< std::setw(12) << stats.requestedBytes / MB << std::endl;
+	out << std::left << std::setw(24) << "all" << std::right << std::setw(12) << allLevels << std::setw(12) << stats.fullBytes / MB << std::endl;
+	out << stats.missingLevels << " levels requested but not resident, " << stats.excessLevels
+		<< " resident but not requested" << std::endl;
+}
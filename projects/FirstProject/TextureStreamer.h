@@ -0,0 +1,134 @@
+#pragma once
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// levels summed over all textures; "requested" is what the last frame asked for
+struct StreamingStats
+{
+	int textures;
+	int residentLevels;
+	int requestedLevels;
+	int missingLevels;   // requested but not resident yet
+	int excessLevels;    // resident but no longer requested
+	size_t residentBytes;
+	size_t requestedBytes;
+	size_t fullBytes;    // every texture with all of its levels
+	long long uploadedBytes;
+	int uploads;
+	int decodes;
+	int drops;
+};
+
+// Textures that get only the mip levels the objects using them need on screen.
+// A texture starts as its 1x1 level. Every frame the renderer requests, per
+// object, the finest level its projected size can show (requiredLevel()); the
+// levels between what is resident and what was requested are decoded and
+// downsampled on a worker thread and uploaded in update(), coarsest first and
+// a few per frame, so an object sharpens over a couple of frames instead of
+// stalling the one it appeared in. Levels no longer requested for a while are
+// freed again.
+//
+// The levels below the finest resident one are simply left undefined, the
+// texture's base level points at the finest resident level.
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	// stops the worker and deletes the textures; the context must be current
+	~TextureStreamer();
+
+	// reads only the size from the file; -1 if it isn't an image
+	int add(const std::string& path);
+	GLuint get(int texture) const { return textures[texture].name; }
+	int getLevelCount(int texture) const { return textures[texture].levels; }
+	// the finest level on the GPU
+	int getResidentLevel(int texture) const { return textures[texture].resident; }
+
+	// the finest level worth having for an object with the given bounding
+	// sphere: the texture's texels across the object (repeats times its size)
+	// against the pixels the sphere covers in the camera's projection; -1 if
+	// the object is behind the camera
+	int requiredLevel(int texture, Camera& camera, const glm::vec3& center, float radius, int viewportHeight,
+		float repeats = 1.f) const;
+	// the frame needs the texture at the level or finer
+	void request(int texture, int level);
+	// once per frame on the GL thread, after the requests: uploads decoded
+	// levels, queues decodes for what is missing and frees what wasn't needed
+	void update();
+
+	// bytes uploaded per update; one level always goes, however big
+	void setUploadBudget(size_t bytes) { uploadBudget = bytes; }
+	size_t getUploadBudget() const { return uploadBudget; }
+	StreamingStats getStats() const;
+	void printReport(std::ostream& out) const;
+private:
+	struct Texture
+	{
+		std::string path;
+		GLuint name;
+		int width, height, levels;
+		int resident;      // finest level uploaded
+		int requested;     // finest level asked for since the last update
+		int needed;        // what the last update saw requested
+		int loading;       // finest level the worker is decoding, -1 if none
+		int unneededFrames; // updates in a row that needed less than is resident
+		bool failed;
+		std::vector<std::vector<unsigned char> > staged; // decoded RGBA levels waiting for upload
+	};
+
+	// decode the file and keep levels [finest, coarsest]
+	struct Job
+	{
+		int texture;
+		std::string path;
+		int finest, coarsest;
+	};
+
+	struct Result
+	{
+		int texture;
+		int finest;
+		std::vector<std::vector<unsigned char> > levels; // finest first; empty if the file couldn't be read
+	};
+
+	// unneeded detail is kept this many updates, so it doesn't flicker in and out
+	static const int DROP_DELAY = 60;
+
+	std::vector<Texture> textures;
+	size_t uploadBudget;
+	int nextTexture;   // where the uploads start, so every texture gets its turn
+	long long uploadedBytes;
+	int uploads, decodes, drops;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	bool stopping;
+
+	void workerLoop();
+	// the sizes of a level
+	int levelWidth(const Texture& texture, int level) const { return std::max(texture.width >> level, 1); }
+	int levelHeight(const Texture& texture, int level) const { return std::max(texture.height >> level, 1); }
+	size_t levelBytes(const Texture& texture, int level) const { return (size_t)levelWidth(texture, level) * levelHeight(texture, level) * 4; }
+	void upload(Texture& texture, int level, const unsigned char* pixels);
+	// frees the levels finer than the level
+	void dropTo(Texture& texture, int level);
+};
+
+#endif
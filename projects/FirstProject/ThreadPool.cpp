@@ -0,0 +1,78 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) : job(NULL), generation(0), busy(0), stopping(false), nextItem(0)
+{
+	if (threads <= 0)
+		threads = std::max((int)std::thread::hardware_concurrency(), 1);
+	for (int i = 1; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::workerLoop(int thread)
+{
+	int seen = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [&]() { return stopping || generation != seen; });
+		if (stopping)
+			return;
+		seen = generation;
+		const std::function<void(int)>* work = job;
+		lock.unlock();
+		(*work)(thread);
+		lock.lock();
+		if (--busy == 0)
+			done.notify_one();
+	}
+}
+
+void ThreadPool::run(const std::function<void(int)>& work)
+{
+	if (workers.empty())
+	{
+		work(0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &work;
+		busy = (int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	work(0);
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&]() { return busy == 0; });
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& work)
+{
+	if (count <= 0)
+		return;
+	if (count == 1 || workers.empty())
+	{
+		for (int i = 0; i < count; i++)
+			work(i, 0);
+		return;
+	}
+	nextItem = 0;
+	run([&](int thread)
+	{
+		for (int i = nextItem++; i < count; i = nextItem++)
+			work(i, thread);
+	});
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads that run one job at a time on every thread, the calling
+// thread included (as thread 0). The workers sleep between jobs.
+class ThreadPool
+{
+public:
+	// threads = 0 uses every hardware thread
+	ThreadPool(int threads = 0);
+	~ThreadPool();
+	int getThreadCount() const { return (int)workers.size() + 1; }
+
+	// runs work(thread) on every thread and waits for all of them
+	void run(const std::function<void(int)>& work);
+	// work(item, thread) for every item in [0, count); the threads take the items one by one
+	void parallelFor(int count, const std::function<void(int, int)>& work);
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const std::function<void(int)>* job;
+	int generation;
+	int busy;
+	bool stopping;
+	std::atomic<int> nextItem;
+
+	void workerLoop(int thread);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+// Hands values from a producer thread to a consumer thread without copying:
+// one slot is written, one is read and the third holds the newest published
+// value. Neither side ever touches the slot the other one works on.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : writeSlot(0), readySlot(1), readSlot(2), fresh(false), closed(false) {}
+
+	// producer: the slot to fill
+	T& writeBuffer() { return slots[writeSlot]; }
+
+	// producer: make the written slot the newest one; an unread older value is dropped
+	void publish()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(writeSlot, readySlot);
+		fresh = true;
+		changed.notify_all();
+	}
+
+	// producer: wait until the consumer took the last published value
+	void waitUntilTaken()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this]() { return !fresh || closed; });
+	}
+
+	// consumer: wait for a value newer than the one in readBuffer() and take it;
+	// returns false once the buffer is closed
+	bool acquire()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this]() { return fresh || closed; });
+		if (!fresh)
+			return false;
+		std::swap(readSlot, readySlot);
+		fresh = false;
+		changed.notify_all();
+		return true;
+	}
+
+	// consumer: the slot taken by the last acquire()
+	T& readBuffer() { return slots[readSlot]; }
+
+	// wake both sides up for shutdown
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		changed.notify_all();
+	}
+
+private:
+	T slots[3];
+	int writeSlot;
+	int readySlot;
+	int readSlot;
+	bool fresh;
+	bool closed;
+	std::mutex mutex;
+	std::condition_variable changed;
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "World.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+	size_t AlignUp(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// byte size of a chunk with the given rows; fills in the column offsets
+	size_t Layout(const std::vector<int>& components, int rows, std::vector<size_t>& offsets)
+	{
+		size_t offset = rows * sizeof(Entity);
+		offsets.resize(components.size());
+		for (size_t i = 0; i < components.size(); i++)
+		{
+			offset = AlignUp(offset, ComponentTypes::alignment(components[i]));
+			offsets[i] = offset;
+			offset += rows * ComponentTypes::size(components[i]);
+		}
+		return offset;
+	}
+
+	// a record of a command buffer
+	struct Command
+	{
+		unsigned char op;
+		Entity entity;
+		int component;
+		unsigned int size;
+	};
+}
+
+int ComponentTypes::add(size_t size, size_t alignment)
+{
+	static std::mutex mutex;
+	static int count = 0;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (count >= MAX_COMPONENTS)
+	{
+		// the masks have no bit left; the type shares the last id rather than writing past the tables
+		std::cout << "ERROR::WORLD::TOO_MANY_COMPONENT_TYPES" << std::endl;
+		return MAX_COMPONENTS - 1;
+	}
+	sizes()[count] = size;
+	alignments()[count] = alignment;
+	return count++;
+}
+
+size_t* ComponentTypes::sizes()
+{
+	static size_t values[MAX_COMPONENTS];
+	return values;
+}
+
+size_t* ComponentTypes::alignments()
+{
+	static size_t values[MAX_COMPONENTS];
+	return values;
+}
+
+Entity CommandBuffer::create()
+{
+	Entity placeholder = { createdCount++, PENDING };
+	record(CREATE, placeholder, -1, NULL, 0);
+	return placeholder;
+}
+
+void CommandBuffer::destroy(Entity entity)
+{
+	record(DESTROY, entity, -1, NULL, 0);
+}
+
+void CommandBuffer::clear()
+{
+	stream.clear();
+	createdCount = 0;
+}
+
+void CommandBuffer::record(Op op, Entity entity, int component, const void* value, size_t size)
+{
+	Command command = { (unsigned char)op, entity, component, (unsigned int)size };
+	const unsigned char* bytes = (const unsigned char*)&command;
+	stream.insert(stream.end(), bytes, bytes + sizeof(command));
+	if (size)
+		stream.insert(stream.end(), (const unsigned char*)value, (const unsigned char*)value + size);
+}
+
+World::World() : entityCount(0)
+{
+	empty = archetypeFor(0);
+}
+
+World::~World()
+{
+	for (std::map<ComponentMask, Archetype*>::iterator it = archetypes.begin(); it != archetypes.end(); ++it)
+	{
+		for (size_t c = 0; c < it->second->chunks.size(); c++)
+			delete[] it->second->chunks[c].data;
+		delete[] it->second->spare;
+		delete it->second;
+	}
+	for (size_t i = 0; i < queries.size(); i++)
+		delete queries[i];
+}
+
+Archetype* World::archetypeFor(ComponentMask mask)
+{
+	std::map<ComponentMask, Archetype*>::iterator it = archetypes.find(mask);
+	if (it != archetypes.end())
+		return it->second;
+
+	Archetype* archetype = new Archetype();
+	archetype->mask = mask;
+	for (int i = 0; i < ComponentTypes::MAX_COMPONENTS; i++)
+	{
+		archetype->column[i] = -1;
+		archetype->addEdge[i] = NULL;
+		archetype->removeEdge[i] = NULL;
+		if (mask & (1ULL << i))
+		{
+			archetype->column[i] = (int)archetype->components.size();
+			archetype->components.push_back(i);
+		}
+	}
+	// as many rows as fit, a single row if even that doesn't
+	size_t rowBytes = sizeof(Entity);
+	for (size_t i = 0; i < archetype->components.size(); i++)
+		rowBytes += ComponentTypes::size(archetype->components[i]);
+	int capacity = std::max((int)(CHUNK_BYTES / rowBytes), 1);
+	while (capacity > 1 && Layout(archetype->components, capacity, archetype->offsets) > CHUNK_BYTES)
+		capacity--;
+	archetype->capacity = capacity;
+	archetype->chunkBytes = Layout(archetype->components, capacity, archetype->offsets);
+	archetype->entityCount = 0;
+	archetype->spare = NULL;
+	archetypes[mask] = archetype;
+
+	for (size_t i = 0; i < queries.size(); i++)
+		if ((mask & queries[i]->include) == queries[i]->include && (mask & queries[i]->exclude) == 0)
+			queries[i]->archetypes.push_back(archetype);
+	return archetype;
+}
+
+Archetype* World::withComponent(Archetype* from, int component)
+{
+	if (!from->addEdge[component])
+		from->addEdge[component] = archetypeFor(from->mask | (1ULL << component));
+	return from->addEdge[component];
+}
+
+Archetype* World::withoutComponent(Archetype* from, int component)
+{
+	if (!from->removeEdge[component])
+		from->removeEdge[component] = archetypeFor(from->mask & ~(1ULL << component));
+	return from->removeEdge[component];
+}
+
+Query& World::query(ComponentMask include, ComponentMask exclude)
+{
+	for (size_t i = 0; i < queries.size(); i++)
+		if (queries[i]->include == include && queries[i]->exclude == exclude)
+			return *queries[i];
+	Query* query = new Query();
+	query->include = include;
+	query->exclude = exclude;
+	for (std::map<ComponentMask, Archetype*>::iterator it = archetypes.begin(); it != archetypes.end(); ++it)
+		if ((it->first & include) == include && (it->first & exclude) == 0)
+			query->archetypes.push_back(it->second);
+	queries.push_back(query);
+	return *query;
+}
+
+int World::count(const Query& query) const
+{
+	int result = 0;
+	for (size_t i = 0; i < query.archetypes.size(); i++)
+		result += query.archetypes[i]->entityCount;
+	return result;
+}
+
+void World::parallelForEachChunk(const Query& query, ThreadPool& pool, const std::function<void(ChunkView&, int)>& work)
+{
+	std::vector<ChunkView>& chunks = parallelChunks;
+	chunks.clear();
+	for (size_t a = 0; a < query.archetypes.size(); a++)
+	{
+		const Archetype* archetype = query.archetypes[a];
+		for (size_t c = 0; c < archetype->chunks.size(); c++)
+			chunks.push_back(ChunkView(archetype, &archetype->chunks[c]));
+	}
+	pool.parallelFor((int)chunks.size(), [&](int i, int thread)
+	{
+		work(chunks[i], thread);
+	});
+}
+
+void World::appendRow(Archetype* archetype, Entity entity, int& chunk, int& row)
+{
+	if (archetype->chunks.empty() || archetype->chunks.back().count == archetype->capacity)
+	{
+		Chunk fresh = { archetype->spare ? archetype->spare : new unsigned char[archetype->chunkBytes], 0 };
+		archetype->spare = NULL;
+		archetype->chunks.push_back(fresh);
+	}
+	chunk = (int)archetype->chunks.size() - 1;
+	Chunk& target = archetype->chunks.back();
+	row = target.count++;
+	((Entity*)target.data)[row] = entity;
+	for (size_t i = 0; i < archetype->components.size(); i++)
+	{
+		size_t size = ComponentTypes::size(archetype->components[i]);
+		memset(target.data + archetype->offsets[i] + row * size, 0, size);
+	}
+	archetype->entityCount++;
+}
+
+void World::removeRow(Archetype* archetype, int chunk, int row)
+{
+	Chunk& last = archetype->chunks.back();
+	int lastRow = last.count - 1;
+	Chunk& hole = archetype->chunks[chunk];
+	if (&hole != &last || row != lastRow)
+	{
+		Entity moved = ((Entity*)last.data)[lastRow];
+		((Entity*)hole.data)[row] = moved;
+		for (size_t i = 0; i < archetype->components.size(); i++)
+		{
+			size_t size = ComponentTypes::size(archetype->components[i]);
+			memcpy(hole.data + archetype->offsets[i] + row * size, last.data + archetype->offsets[i] + lastRow * size, size);
+		}
+		records[moved.index].chunk = chunk;
+		records[moved.index].row = row;
+	}
+	last.count--;
+	archetype->entityCount--;
+	// the emptied chunk is kept as the spare, so adding and removing around a
+	// chunk boundary doesn't allocate every time
+	if (last.count == 0)
+	{
+		delete[] archetype->spare;
+		archetype->spare = last.data;
+		archetype->chunks.pop_back();
+	}
+}
+
+Entity World::allocate(Archetype* archetype)
+{
+	unsigned int index;
+	if (!freeIndices.empty())
+	{
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		index = (unsigned int)records.size();
+		Record record = { NULL, 0, 0, 0 };
+		records.push_back(record);
+	}
+	Entity entity = { index, records[index].generation };
+	Record& record = records[index];
+	record.archetype = archetype;
+	appendRow(archetype, entity, record.chunk, record.row);
+	entityCount++;
+	return entity;
+}
+
+Entity World::create()
+{
+	return allocate(empty);
+}
+
+Entity World::create(ComponentMask components)
+{
+	return allocate(archetypeFor(components));
+}
+
+bool World::isAlive(Entity entity) const
+{
+	return entity.index < records.size() && records[entity.index].generation == entity.generation
+		&& records[entity.index].archetype != NULL;
+}
+
+void World::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+		return;
+	Record& record = records[entity.index];
+	removeRow(record.archetype, record.chunk, record.row);
+	record.archetype = NULL;
+	record.generation++;
+	freeIndices.push_back(entity.index);
+	entityCount--;
+}
+
+void World::moveEntity(Entity entity, Archetype* to)
+{
+	Record& record = records[entity.index];
+	Archetype* from = record.archetype;
+	if (from == to)
+		return;
+	int chunk, row;
+	appendRow(to, entity, chunk, row);
+	// the components both archetypes have
+	const Chunk& source = from->chunks[record.chunk];
+	Chunk& target = to->chunks[chunk];
+	for (size_t i = 0; i < to->components.size(); i++)
+	{
+		int component = to->components[i];
+		int column = from->column[component];
+		if (column < 0)
+			continue;
+		size_t size = ComponentTypes::size(component);
+		memcpy(target.data + to->offsets[i] + row * size, source.data + from->offsets[column] + record.row * size, size);
+	}
+	removeRow(from, record.chunk, record.row);
+	record.archetype = to;
+	record.chunk = chunk;
+	record.row = row;
+}
+
+void World::addComponent(Entity entity, int component, const void* value)
+{
+	if (!isAlive(entity))
+		return;
+	moveEntity(entity, withComponent(records[entity.index].archetype, component));
+	memcpy(getComponent(entity, component), value, ComponentTypes::size(component));
+}
+
+void World::removeComponent(Entity entity, int component)
+{
+	if (!isAlive(entity))
+		return;
+	moveEntity(entity, withoutComponent(records[entity.index].archetype, component));
+}
+
+void* World::getComponent(Entity entity, int component)
+{
+	if (!isAlive(entity))
+		return NULL;
+	const Record& record = records[entity.index];
+	int column = record.archetype->column[component];
+	if (column < 0)
+		return NULL;
+	return record.archetype->chunks[record.chunk].data + record.archetype->offsets[column]
+		+ record.row * ComponentTypes::size(component);
+}
+
+void World::apply(CommandBuffer& commands)
+{
+	std::vector<Entity> created(commands.createdCount);
+	size_t position = 0;
+	while (position < commands.stream.size())
+	{
+		Command command;
+		memcpy(&command, &commands.stream[position], sizeof(command));
+		position += sizeof(command);
+		// a command without a payload may end the stream, there's no byte to point at then
+		const unsigned char* value = command.size > 0 ? &commands.stream[position] : NULL;
+		position += command.size;
+
+		Entity entity = command.entity;
+		if (entity.generation == CommandBuffer::PENDING && command.op != CommandBuffer::CREATE)
+			entity = created[entity.index];
+		switch (command.op)
+		{
+		case CommandBuffer::CREATE:
+			created[entity.index] = create();
+			break;
+		case CommandBuffer::DESTROY:
+			destroy(entity);
+			break;
+		case CommandBuffer::ADD:
+			addComponent(entity, command.component, value);
+			break;
+		case CommandBuffer::REMOVE:
+			removeComponent(entity, command.component);
+			break;
+		}
+	}
+	commands.clear();
+}
@@ -0,0 +1,261 @@
+#pragma once
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct Entity
+{
+	unsigned int index;
+	unsigned int generation;
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+typedef unsigned long long ComponentMask;
+
+// Ids of the component types, given out on the first use of a type, which may
+// happen on any thread (inside parallelForEachChunk, say). Components are plain
+// data: they are moved between chunks with memcpy and never destructed.
+class ComponentTypes
+{
+public:
+	static const int MAX_COMPONENTS = 64; // one bit of a ComponentMask each
+
+	template <typename T>
+	static int id()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "components are moved with memcpy");
+		static const int typeId = add(sizeof(T), alignof(T));
+		return typeId;
+	}
+	template <typename T>
+	static ComponentMask mask() { return 1ULL << id<T>(); }
+	static size_t size(int id) { return sizes()[id]; }
+	static size_t alignment(int id) { return alignments()[id]; }
+private:
+	// serialized; the tables have a fixed size, so the entries of the types
+	// already registered stay put while another thread adds one
+	static int add(size_t size, size_t alignment);
+	static size_t* sizes();
+	static size_t* alignments();
+};
+
+// all the given component types
+template <typename... T>
+ComponentMask MaskOf()
+{
+	ComponentMask masks[] = { 0ULL, ComponentTypes::mask<T>()... };
+	ComponentMask result = 0;
+	for (size_t i = 0; i < sizeof(masks) / sizeof(masks[0]); i++)
+		result |= masks[i];
+	return result;
+}
+
+// A fixed size block of memory holding the entities of one archetype: the
+// entity handles, then one contiguous array per component
+struct Chunk
+{
+	unsigned char* data;
+	int count;
+};
+
+// Every entity with exactly the same set of components lives in the chunks of
+// one archetype. Only the last chunk is partly filled and none is empty:
+// removing an entity moves the last one of the archetype into its place.
+struct Archetype
+{
+	ComponentMask mask;
+	std::vector<int> components;                             // ids, ascending
+	int column[ComponentTypes::MAX_COMPONENTS];              // index in components, -1 if missing
+	std::vector<size_t> offsets;                             // of each column in a chunk
+	int capacity;                                            // entities per chunk
+	size_t chunkBytes;
+	std::vector<Chunk> chunks;
+	int entityCount;
+	unsigned char* spare;                                    // an emptied chunk, NULL if none
+	// archetypes with one component more or less, filled in on first use
+	Archetype* addEdge[ComponentTypes::MAX_COMPONENTS];
+	Archetype* removeEdge[ComponentTypes::MAX_COMPONENTS];
+};
+
+// The entities of one chunk, as arrays
+class ChunkView
+{
+public:
+	ChunkView(const Archetype* archetype, const Chunk* chunk) : archetype(archetype), chunk(chunk) {}
+	int size() const { return chunk->count; }
+	const Entity* entities() const { return (const Entity*)chunk->data; }
+	// NULL if the archetype has no such component
+	template <typename T>
+	T* get() const
+	{
+		int c = archetype->column[ComponentTypes::id<T>()];
+		return c < 0 ? NULL : (T*)(chunk->data + archetype->offsets[c]);
+	}
+private:
+	const Archetype* archetype;
+	const Chunk* chunk;
+};
+
+// The archetypes having all of the included and none of the excluded
+// components. The world keeps it up to date as archetypes appear, so running
+// a query never searches the archetypes.
+struct Query
+{
+	ComponentMask include;
+	ComponentMask exclude;
+	std::vector<Archetype*> archetypes;
+};
+
+// Structural changes recorded while the world is being iterated (possibly on
+// several threads, one buffer each) and applied afterwards in order
+class CommandBuffer
+{
+public:
+	CommandBuffer() : createdCount(0) {}
+	// a placeholder that later commands of this buffer can refer to
+	Entity create();
+	void destroy(Entity entity);
+	template <typename T>
+	void add(Entity entity, const T& value) { record(ADD, entity, ComponentTypes::id<T>(), &value, sizeof(T)); }
+	template <typename T>
+	void remove(Entity entity) { record(REMOVE, entity, ComponentTypes::id<T>(), NULL, 0); }
+	bool empty() const { return stream.empty(); }
+	void clear();
+private:
+	friend class World;
+	enum Op { CREATE, DESTROY, ADD, REMOVE };
+	static const unsigned int PENDING = 0xFFFFFFFF; // generation of a placeholder
+
+	std::vector<unsigned char> stream;
+	unsigned int createdCount;
+
+	void record(Op op, Entity entity, int component, const void* value, size_t size);
+};
+
+// Archetype based entity component system. Entities are handles with a
+// generation, so a stale handle of a destroyed entity is recognized; their
+// components live in 16 KB chunks per archetype, which systems walk as
+// plain arrays, on one thread or on a pool of threads chunk by chunk.
+//
+// Adding or removing a component moves the entity to another archetype, so
+// it must not happen while its archetype is iterated - record it in a
+// CommandBuffer and apply() it after the iteration.
+class World
+{
+public:
+	static const size_t CHUNK_BYTES = 16 * 1024;
+
+	World();
+	~World();
+
+	Entity create();
+	// an entity with the given components, zero filled; cheaper than adding them one by one
+	Entity create(ComponentMask components);
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+	int getEntityCount() const { return entityCount; }
+	int getArchetypeCount() const { return (int)archetypes.size(); }
+
+	template <typename T>
+	void add(Entity entity, const T& value) { addComponent(entity, ComponentTypes::id<T>(), &value); }
+	template <typename T>
+	void remove(Entity entity) { removeComponent(entity, ComponentTypes::id<T>()); }
+	// NULL if the entity has no such component
+	template <typename T>
+	T* get(Entity entity) { return (T*)getComponent(entity, ComponentTypes::id<T>()); }
+	template <typename T>
+	bool has(Entity entity) { return get<T>(entity) != NULL; }
+
+	// cached; the reference stays valid for the life of the world
+	Query& query(ComponentMask include, ComponentMask exclude = 0);
+	// entities the query matches
+	int count(const Query& query) const;
+
+	template <typename F>
+	void forEachChunk(const Query& query, F work)
+	{
+		for (size_t a = 0; a < query.archetypes.size(); a++)
+		{
+			const Archetype* archetype = query.archetypes[a];
+			for (size_t c = 0; c < archetype->chunks.size(); c++)
+			{
+				ChunkView view(archetype, &archetype->chunks[c]);
+				work(view);
+			}
+		}
+	}
+	// work(chunk, thread) for every chunk, spread over the pool; not reentrant
+	void parallelForEachChunk(const Query& query, ThreadPool& pool, const std::function<void(ChunkView&, int)>& work);
+
+	// work(components...) for every entity having all of them
+	template <typename... T, typename F>
+	void each(F work)
+	{
+		forEachChunk(query(MaskOf<T...>()), [&](ChunkView& chunk)
+		{
+			eachInChunk<T...>(chunk, work);
+		});
+	}
+	template <typename... T, typename F>
+	void each(ComponentMask exclude, F work)
+	{
+		forEachChunk(query(MaskOf<T...>(), exclude), [&](ChunkView& chunk)
+		{
+			eachInChunk<T...>(chunk, work);
+		});
+	}
+	template <typename... T, typename F>
+	static void eachInChunk(ChunkView& chunk, F& work)
+	{
+		applyRows(chunk.size(), work, chunk.get<T>()...);
+	}
+
+	void apply(CommandBuffer& commands);
+private:
+	struct Record
+	{
+		Archetype* archetype;
+		int chunk;
+		int row;
+		unsigned int generation;
+	};
+
+	std::vector<Record> records;
+	std::vector<unsigned int> freeIndices;
+	int entityCount;
+	std::map<ComponentMask, Archetype*> archetypes;
+	Archetype* empty;
+	std::vector<Query*> queries;
+	std::vector<ChunkView> parallelChunks; // reused, so iterating doesn't allocate
+
+	Archetype* archetypeFor(ComponentMask mask);
+	Archetype* withComponent(Archetype* from, int component);
+	Archetype* withoutComponent(Archetype* from, int component);
+	Entity allocate(Archetype* archetype);
+	// appends a zeroed row to the archetype, returns its chunk and row
+	void appendRow(Archetype* archetype, Entity entity, int& chunk, int& row);
+	// fills the hole with the last row of the archetype
+	void removeRow(Archetype* archetype, int chunk, int row);
+	void moveEntity(Entity entity, Archetype* to);
+	void addComponent(Entity entity, int component, const void* value);
+	void removeComponent(Entity entity, int component);
+	void* getComponent(Entity entity, int component);
+
+	template <typename F, typename... P>
+	static void applyRows(int count, F& work, P... arrays)
+	{
+		for (int i = 0; i < count; i++)
+			work(arrays[i]...);
+	}
+};
+
+#endif
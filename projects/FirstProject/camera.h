@@ -5,8 +5,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <atomic>
 #include <vector>
 
+#include "Frustum.h"
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     CAM_FORWARD = (1 << 0),
@@ -30,7 +33,10 @@ const float ZFAR = 1000.0f;
 const float ASPECTRATIO = 16.f/9.f; //  
 
 
-// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
+// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL.
+// The matrices and the frustum are cached: a getter rebuilds only what depends on the attributes that
+// changed since the last call, whoever changed them (the attributes are public), and the version
+// changes with them, so whatever is derived from the camera can be kept while the version stays the same.
 class Camera
 {
 public:
@@ -60,7 +66,7 @@ public:
         Fov(FOV), zNear(ZNEAR), 
         MovementSpeed(SPEED), zFar(ZFAR), AspectRatio(ASPECTRATIO),
         MouseSensitivity(SENSITIVITY), 
-        Zoom(ZOOM)
+        Zoom(ZOOM), dirty(ALL), version(0)
     {
         Position = position;
         WorldUp = up;
@@ -75,7 +81,7 @@ public:
         Fov(FOV), zNear(ZNEAR),
         MovementSpeed(SPEED), zFar(ZFAR), AspectRatio(ASPECTRATIO),
         MouseSensitivity(SENSITIVITY),
-        Zoom(ZOOM)
+        Zoom(ZOOM), dirty(ALL), version(0)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -85,14 +91,81 @@ public:
     }
 
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix()
+    const glm::mat4& GetViewMatrix()
+    {
+        validate();
+        return view;
+    }
+
+    const glm::mat4& GetProjectionMatrix()
+    {
+        validate();
+        return projection;
+    }
+
+    // projection * view
+    const glm::mat4& GetViewProjectionMatrix()
+    {
+        validate();
+        if (dirty & VIEW_PROJECTION)
+        {
+            viewProjection = projection * view;
+            dirty &= ~VIEW_PROJECTION;
+        }
+        return viewProjection;
+    }
+
+    const glm::mat4& GetInverseViewMatrix()
+    {
+        validate();
+        if (dirty & INVERSE_VIEW)
+        {
+            inverseView = glm::inverse(view);
+            dirty &= ~INVERSE_VIEW;
+        }
+        return inverseView;
+    }
+
+    const glm::mat4& GetInverseProjectionMatrix()
+    {
+        validate();
+        if (dirty & INVERSE_PROJECTION)
+        {
+            inverseProjection = glm::inverse(projection);
+            dirty &= ~INVERSE_PROJECTION;
+        }
+        return inverseProjection;
+    }
+
+    // from clip space to the world
+    const glm::mat4& GetInverseViewProjectionMatrix()
+    {
+        validate();
+        if (dirty & INVERSE_VIEW_PROJECTION)
+        {
+            inverseViewProjection = GetInverseViewMatrix() * GetInverseProjectionMatrix();
+            dirty &= ~INVERSE_VIEW_PROJECTION;
+        }
+        return inverseViewProjection;
+    }
+
+    const Frustum& GetFrustum()
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        validate();
+        if (dirty & FRUSTUM)
+        {
+            frustum = Frustum(GetViewProjectionMatrix());
+            dirty &= ~FRUSTUM;
+        }
+        return frustum;
     }
 
-    glm::mat4 GetProjectionMatrix()
+    // changes whenever the view or the projection does; no two states of any cameras share a
+    // version, and a copy keeps it until it is changed itself
+    unsigned int GetVersion()
     {
-        return glm::perspective(glm::radians(Fov), AspectRatio, zNear, zFar);
+        validate();
+        return version;
     }
 
 
@@ -108,7 +181,6 @@ public:
         Position += Front * velocity * direction.z;
         Position += Right * velocity * direction.x;
         Position += Up * velocity * direction.y;
-        updateCameraVectors();
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -130,6 +202,7 @@ public:
     {
         xoffset *= MouseSensitivity;
         yoffset *= MouseSensitivity;
+        float oldYaw = Yaw, oldPitch = Pitch;
 
         Yaw += xoffset;
         Pitch += yoffset;
@@ -144,7 +217,8 @@ public:
         }
 
         // update Front, Right and Up Vectors using the updated Euler angles
-        updateCameraVectors();
+        if (Yaw != oldYaw || Pitch != oldPitch)
+            updateCameraVectors();
     }
 
     void ChangeFov(float value)
@@ -154,7 +228,6 @@ public:
             Fov = 1.0f;
         if (Fov > 120.0f)
             Fov = 120.0f;
-        updateCameraVectors();
     }
 
 
@@ -169,14 +242,73 @@ public:
     }
 
 private:
+    // what has to be built again
+    enum
+    {
+        INVERSE_VIEW = 1 << 0,
+        INVERSE_PROJECTION = 1 << 1,
+        VIEW_PROJECTION = 1 << 2,
+        INVERSE_VIEW_PROJECTION = 1 << 3,
+        FRUSTUM = 1 << 4,
+        VIEW = 1 << 5,
+        PROJECTION = 1 << 6,
+        ALL = (1 << 7) - 1
+    };
+    unsigned int dirty;
+    unsigned int version;
+    // the attributes the cached matrices were built from
+    glm::vec3 viewPosition, viewFront, viewUp;
+    float projectionFov, projectionAspect, projectionNear, projectionFar;
+    glm::mat4 view, projection, viewProjection;
+    glm::mat4 inverseView, inverseProjection, inverseViewProjection;
+    Frustum frustum;
+
+    // rebuilds the view or the projection if an attribute they depend on changed
+    void validate()
+    {
+        bool viewChanged = (dirty & VIEW) || Position != viewPosition || Front != viewFront || Up != viewUp;
+        bool projectionChanged = (dirty & PROJECTION) || Fov != projectionFov || AspectRatio != projectionAspect
+            || zNear != projectionNear || zFar != projectionFar;
+        if (viewChanged)
+        {
+            viewPosition = Position;
+            viewFront = Front;
+            viewUp = Up;
+            view = glm::lookAt(Position, Position + Front, Up);
+            dirty = (dirty & ~VIEW) | INVERSE_VIEW;
+        }
+        if (projectionChanged)
+        {
+            projectionFov = Fov;
+            projectionAspect = AspectRatio;
+            projectionNear = zNear;
+            projectionFar = zFar;
+            projection = glm::perspective(glm::radians(Fov), AspectRatio, zNear, zFar);
+            dirty = (dirty & ~PROJECTION) | INVERSE_PROJECTION;
+        }
+        if (viewChanged || projectionChanged)
+        {
+            dirty |= VIEW_PROJECTION | INVERSE_VIEW_PROJECTION | FRUSTUM;
+            version = NextVersion();
+        }
+    }
+
+    static unsigned int NextVersion()
+    {
+        static std::atomic<unsigned int> last(0);
+        return ++last;
+    }
+
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
     {
         // calculate the new Front vector
+        float yaw = glm::radians(Yaw), pitch = glm::radians(Pitch);
+        float cosPitch = cos(pitch);
         glm::vec3 front;
-        front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-        front.y = sin(glm::radians(Pitch));
-        front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
+        front.x = cos(yaw) * cosPitch;
+        front.y = sin(pitch);
+        front.z = sin(yaw) * cosPitch;
         Front = glm::normalize(front);
         // also re-calculate the Right and Up vector
         Right = glm::normalize(glm::cross(Front, WorldUp));  // normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
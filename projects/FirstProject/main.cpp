@@ -12,29 +12,61 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
 #include "Shader.h"
 #include "camera.h"
+#include "CascadedShadowMap.h"
+#include "GpuTimer.h"
+#include "Benchmark.h"
+#include "Frustum.h"
+#include "RenderTarget.h"
+#include "HiZCuller.h"
+#include "LodMesh.h"
+#include "StaticBatch.h"
+#include "TextureArray.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "TripleBuffer.h"
+#include "ShaderReloader.h"
+#include "ShaderManager.h"
+#include "ShaderVariants.h"
+#include "SoftwareRasterizer.h"
+#include "GLCapture.h"
+#include "GLReplay.h"
+#include "ModelTransform.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "World.h"
+#include "FrameAllocator.h"
+#include "ResourceManager.h"
+#include "TextureStreamer.h"
+#include "MultiView.h"
+#include "MathKernels.h"
 
-Camera camera(glm::vec3(0.f, 0.f, -5.f));
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
+Camera camera(glm::vec3(0.f, 0.f, -5.f));
 
-struct ModelTransform
-{
-    glm::vec3 position;
-    glm::vec3 rotation; // Euler's angles
-    glm::vec3 scale;
 
-    void setUniformScale(float s)
-    {
-        scale.x = s;
-        scale.y = s;
-        scale.z = s;
-    }
-};
+// the window's framebuffer size, kept by the callback on the main thread; the
+// render thread gets it through the frame snapshot and sets the viewport from it
+int framebufferWidth = 0, framebufferHeight = 0;
 
+// no GL here: with the render thread the main thread has no current context
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 void processInput(GLFWwindow* window, double dt)
@@ -57,7 +89,10 @@ void processInput(GLFWwindow* window, double dt)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         dir |= CAM_RIGHT;
     camera.Move(dir, dt);
+}
 
+void processMouse(GLFWwindow* window)
+{
     // move camera by mouse
     double newX = 0.f, newY = 0.f;
     glfwGetCursorPos(window, &newX, &newY);
@@ -74,10 +109,71 @@ void OnScroll(GLFWwindow* win, double x, double y)
 }
 
 bool wireframeMode = false;
+bool shadowCacheEnabled = true;
+bool depthPrepass = false;
+bool occlusionCulling = false;
+bool lodEnabled = true;
+bool staticBatching = true;
+bool dynamicResolution = true;
+bool lighting = true;
+bool uniformBranches = false;
+int swapInterval = 1;
+
+// the toggles as the renderer sees them for one frame
+struct RenderSettings
+{
+    bool wireframe;
+    bool shadowCache;
+    bool depthPrepass;
+    bool occlusionCulling;
+    bool lod;
+    bool staticBatching;
+    bool dynamicResolution;
+    bool lighting;
+    bool uniformBranches; // the branching reference shader instead of the variants
+    int swapInterval;
+};
 
-void UpdatePolygonMode()
+// Everything the renderer needs from the simulation for one frame. The
+// simulation fills a free slot and publishes it, and never touches it again
+// until the renderer is done with it.
+struct FrameSnapshot
 {
-    if (wireframeMode)
+    Camera camera;
+    std::vector<glm::mat4> models; // per object
+    RenderSettings settings;
+    int fbWidth;
+    int fbHeight;
+    double inputTime; // glfwGetTime() when the input of this frame was read
+    long long simAllocations; // heap allocations of the simulation of this frame
+};
+
+// threads with frame scoped memory
+enum FrameThread { SIM_THREAD, RENDER_THREAD, FRAME_THREAD_COUNT };
+
+// Components of the scene entities; the current transform is a ModelTransform
+struct PreviousTransform
+{
+    ModelTransform value; // at the previous simulation step, for the interpolation
+};
+
+struct RenderData
+{
+    int index;   // in the per object arrays of the renderer (FrameSnapshot::models, ...)
+    int texture; // scene texture
+    float layer; // in the texture array
+};
+
+// only animated entities have it
+struct Animation
+{
+    ModelTransform base; // at t = 0
+    SceneAnimation motion;
+};
+
+void UpdatePolygonMode(bool wireframe)
+{
+    if (wireframe)
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     else
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -89,56 +185,1194 @@ void OnKeyAction(GLFWwindow* win, int key, int scancode, int action, int mods)
         {
         case GLFW_KEY_SPACE:
             wireframeMode = !wireframeMode;
-            UpdatePolygonMode();
+            break;
+        case GLFW_KEY_C:
+            shadowCacheEnabled = !shadowCacheEnabled;
+            break;
+        case GLFW_KEY_P:
+            depthPrepass = !depthPrepass;
+            break;
+        case GLFW_KEY_O:
+            occlusionCulling = !occlusionCulling;
+            break;
+        case GLFW_KEY_L:
+            lodEnabled = !lodEnabled;
+            break;
+        case GLFW_KEY_V:
+            swapInterval = swapInterval != 0 ? 0 : 1;
+            break;
+        case GLFW_KEY_R:
+            dynamicResolution = !dynamicResolution;
+            break;
+        case GLFW_KEY_B:
+            staticBatching = !staticBatching;
+            break;
+        case GLFW_KEY_K:
+            lighting = !lighting;
+            break;
+        case GLFW_KEY_U:
+            uniformBranches = !uniformBranches;
             break;
         }
 }
 
 typedef unsigned char byte;
 
-int main()
+void TintImage(const byte* src, byte* dst, int pixelCount, int channels, const glm::vec3& tint)
 {
-#pragma region WINDOW INITIALIZATION
-    /* GLFW initialization */
-    glfwInit();
-    /* GLFW configuration */
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    for (int i = 0; i < pixelCount; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            float scale = c < 3 ? tint[c] : 1.f;
+            dst[i * channels + c] = (byte)(src[i * channels + c] * scale);
+        }
+}
 
-    /* create window */
-    GLFWwindow* window = glfwCreateWindow(1280, 720, "LearnOpenGL", NULL, NULL);
+// Walls of cubes one behind another, listed back to front, so that without
+// a depth pre-pass every wall is shaded again on top of the previous one.
+void BuildOverdrawScene(std::vector<ModelTransform>& objects)
+{
+    for (int layer = 14; layer >= 0; layer--)
+    {
+        float z = 3.0f * layer;
+        float distance = z - camera.Position.z;
+        // enough 2x2 cubes to cover the whole view at this distance
+        int halfX = (int)(distance * 0.75f * 0.5f) + 1;
+        int halfY = (int)(distance * 0.42f * 0.5f) + 1;
+        for (int y = -halfY; y <= halfY; y++)
+            for (int x = -halfX; x <= halfX; x++)
+            {
+                ModelTransform wall = {
+                    glm::vec3(2.f * x, 2.f * y, z),
+                    glm::vec3(0.f, 0.f, 0.f),
+                    glm::vec3(1.f, 1.f, 1.f),
+                };
+                objects.push_back(wall);
+            }
+    }
+}
+
+// Blocks of buildings of random height along a street grid. Looking down a
+// street from the ground, the first rows hide almost everything behind them.
+void BuildCityScene(std::vector<ModelTransform>& objects)
+{
+    const int blocks = 60;
+    const float spacing = 4.f;
+    unsigned int seed = 12345;
+    for (int z = 0; z < blocks; z++)
+        for (int x = 0; x < blocks; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            float height = 2.f + (seed >> 16) % 100 / 10.f;
+            ModelTransform building = {
+                glm::vec3((x - blocks / 2) * spacing, height * 0.5f, z * spacing),
+                glm::vec3(0.f, 0.f, 0.f),
+                glm::vec3(1.2f, height * 0.5f, 1.2f),
+            };
+            objects.push_back(building);
+        }
+    // ground
+    ModelTransform ground = {
+        glm::vec3(0.f, -0.1f, blocks * spacing * 0.5f),
+        glm::vec3(0.f, 0.f, 0.f),
+        glm::vec3(blocks * spacing * 0.5f, 0.1f, blocks * spacing * 0.5f),
+    };
+    objects.push_back(ground);
+    // stand in the middle of a street
+    camera.Position = glm::vec3(spacing * 0.5f, 1.5f, -spacing);
+}
+
+// A field of detailed spheres reaching far away from the camera
+void BuildLodScene(std::vector<MeshInstance>& instances, int layerCount)
+{
+    for (int z = 0; z < 60; z++)
+        for (int x = -25; x < 25; x++)
+        {
+            MeshInstance sphere = {
+                glm::translate(glm::mat4(1.f), glm::vec3(x * 3.f, 0.f, z * 3.f)),
+                (float)((x + z + 50) % layerCount),
+            };
+            instances.push_back(sphere);
+        }
+    camera.Position = glm::vec3(0.f, 1.5f, -5.f);
+}
+
+// Thousands of small crates scattered on a plane, none of them ever moves
+void BuildStaticScene(std::vector<ModelTransform>& objects)
+{
+    unsigned int seed = 777;
+    for (int z = 0; z < 64; z++)
+        for (int x = -32; x < 32; x++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            float size = 0.3f + (seed >> 16) % 50 / 100.f;
+            ModelTransform crate = {
+                glm::vec3(x * 2.5f, size, z * 2.5f),
+                glm::vec3(0.f, (float)((seed >> 8) % 360), 0.f),
+                glm::vec3(size, size, size),
+            };
+            objects.push_back(crate);
+        }
+    camera.Position = glm::vec3(0.f, 4.f, -5.f);
+}
+
+// world space AABB of the -1..1 cube transformed by the model matrix
+void CubeBounds(const glm::mat4& model, CullBox& box)
+{
+    box.center = glm::vec3(model[3]);
+    box.extent = glm::abs(glm::vec3(model[0])) + glm::abs(glm::vec3(model[1])) + glm::abs(glm::vec3(model[2]));
+}
+
+// the scene of a benchmark, which replaces the objects of the scene file, and
+// the modes it compares; NULL for an unknown name
+Benchmark* CreateBenchmark(const std::string& name, int textureCount, std::vector<ModelTransform>& objects,
+    std::vector<MeshInstance>& lodInstances)
+{
+    Benchmark* benchmark = NULL;
+    if (name == "overdraw")
+    {
+        BuildOverdrawScene(objects);
+        benchmark = new Benchmark("overdraw, " + std::to_string(objects.size()) + " cubes");
+        benchmark->addMode("no pre-pass");
+        benchmark->addMode("depth pre-pass");
+    }
+    else if (name == "city")
+    {
+        BuildCityScene(objects);
+        benchmark = new Benchmark("city, " + std::to_string(objects.size()) + " buildings");
+        benchmark->addMode("frustum culling");
+        benchmark->addMode("frustum + hi-z");
+    }
+    else if (name == "lod")
+    {
+        BuildLodScene(lodInstances, textureCount);
+        benchmark = new Benchmark("lod, " + std::to_string(lodInstances.size()) + " spheres");
+        benchmark->addMode("full detail");
+        benchmark->addMode("lod");
+    }
+    else if (name == "branches")
+    {
+        BuildOverdrawScene(objects);
+        benchmark = new Benchmark("branches, " + std::to_string(objects.size()) + " cubes");
+        benchmark->addMode("uniform branches, lit");
+        benchmark->addMode("variants, lit");
+        benchmark->addMode("uniform branches, unlit");
+        benchmark->addMode("variants, unlit");
+    }
+    else if (name == "static")
+    {
+        BuildStaticScene(objects);
+        benchmark = new Benchmark("static, " + std::to_string(objects.size()) + " crates");
+        benchmark->addMode("individual draws");
+        benchmark->addMode("static batches");
+    }
+    else
+        std::cout << "Unknown benchmark: " << name << std::endl;
+    return benchmark;
+}
+
+// benchmarks pick the techniques themselves
+void ApplyBenchmarkSettings(const std::string& name, int mode, RenderSettings& settings)
+{
+    if (name == "overdraw")
+        settings.depthPrepass = mode == 1;
+    else if (name == "city")
+        settings.occlusionCulling = mode == 1;
+    else if (name == "lod")
+        settings.lod = mode == 1;
+    else if (name == "branches")
+    {
+        // fragment bound: every layer of the wall is shaded
+        settings.depthPrepass = false;
+        settings.uniformBranches = mode % 2 == 0;
+        settings.lighting = mode < 2;
+    }
+    // the other scenes measure per object techniques
+    settings.staticBatching = name == "static" && mode == 1;
+}
+
+// the sphere of the lod benchmark; upload = false for the software renderer
+LodMesh* CreateLodSphere(bool upload)
+{
+    LodMesh* lodMesh = new LodMesh(CreateSphere(96, 192), MAX_LODS, 0.5f, upload);
+    for (int i = 0; i < lodMesh->getLodCount(); i++)
+        std::cout << "LOD " << i << ": " << lodMesh->getLod(i).indexCount / 3 << " triangles, error "
+            << lodMesh->getLod(i).error << std::endl;
+    return lodMesh;
+}
+
+// writes a scene of a million objects in both forms and times loading them
+int RunSceneLoadBenchmark()
+{
+    const int objectCount = 1000000;
+    const int runs = 3;
+    Scene scene;
+    scene.addTexture("images/box.png", glm::vec3(1.f));
+    scene.addMesh("cube");
+    SceneAnimation spin = { glm::vec3(0.f, 45.f, 0.f), 0.f, 0.f, 0.f };
+    scene.addAnimation(spin);
+    unsigned int seed = 4242;
+    for (int i = 0; i < objectCount; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        SceneObject object = {
+            glm::vec3((i % 1000) * 2.f, (seed >> 16) % 100 / 10.f, (i / 1000) * 2.f),
+            glm::vec3(0.f, (float)((seed >> 8) % 360), 0.f),
+            glm::vec3(0.5f, 0.5f, 0.5f),
+            0, 0, (seed >> 20) % 10 == 0 ? 0 : -1,
+        };
+        scene.addObject(object);
+    }
+
+    const char* paths[2] = { "scene_load_bench.scene", "scene_load_bench.bscene" };
+    if (!scene.saveText(paths[0]) || !scene.saveBinary(paths[1]))
+        return -1;
+    std::cout << "Benchmark: scene load, " << objectCount << " objects (best of " << runs << " runs)" << std::endl;
+    std::cout << std::left << std::setw(24) << "form" << std::right << std::setw(12) << "file MB"
+        << std::setw(12) << "load ms" << std::setw(16) << "ms per 1M" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int form = 0; form < 2; form++)
+    {
+        std::ifstream file(paths[form], std::ios::binary | std::ios::ate);
+        double megabytes = (double)file.tellg() / (1024.0 * 1024.0);
+        file.close();
+        double best = 1e30;
+        for (int run = 0; run < runs; run++)
+        {
+            Scene loaded;
+            if (!loaded.load(paths[form]) || loaded.getObjectCount() != objectCount)
+                return -1;
+            best = std::min(best, loaded.getLoadMs());
+        }
+        std::cout << std::left << std::setw(24) << (form == 0 ? "text" : "binary") << std::right
+            << std::setw(12) << megabytes << std::setw(12) << best
+            << std::setw(16) << best * 1000000.0 / objectCount << std::endl;
+        std::remove(paths[form]);
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+    return 0;
+}
+
+// times the entity component system on a million entities: creating them,
+// animating them on one thread and on every thread, adding and removing a
+// component through a command buffer, destroying them
+int RunEcsBenchmark()
+{
+    typedef std::chrono::steady_clock Clock;
+    auto msSince = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    const int entityCount = 1000000;
+    const int runs = 3;
+    SceneAnimation spin = { glm::vec3(0.f, 45.f, 0.f), 1.f, 0.5f, 0.f };
+    ThreadPool pool;
+    double best[6] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+    const char* names[6] = { "create", "animate, 1 thread", "animate, pool", "add component", "remove component", "destroy" };
+    for (int run = 0; run < runs; run++)
+    {
+        World world;
+        std::vector<Entity> entities(entityCount);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < entityCount; i++)
+        {
+            entities[i] = world.create(MaskOf<ModelTransform, RenderData, Animation>());
+            ModelTransform base = { glm::vec3((i % 1000) * 2.f, 0.f, (i / 1000) * 2.f), glm::vec3(0.f), glm::vec3(0.5f) };
+            Animation animation = { base, spin };
+            *world.get<Animation>(entities[i]) = animation;
+            world.get<RenderData>(entities[i])->index = i;
+        }
+        best[0] = std::min(best[0], msSince(start));
+
+        auto move = [](ModelTransform& transform, Animation& animation)
+        {
+            transform = Scene::animate(animation.base, animation.motion, 1.5);
+        };
+        start = Clock::now();
+        world.each<ModelTransform, Animation>(move);
+        best[1] = std::min(best[1], msSince(start));
+        start = Clock::now();
+        world.parallelForEachChunk(world.query(MaskOf<ModelTransform, Animation>()), pool, [&](ChunkView& chunk, int)
+        {
+            World::eachInChunk<ModelTransform, Animation>(chunk, move);
+        });
+        best[2] = std::min(best[2], msSince(start));
+
+        // recorded up front, the time is that of applying the structural changes
+        CommandBuffer commands;
+        for (int i = 0; i < entityCount; i++)
+        {
+            PreviousTransform previous = { *world.get<ModelTransform>(entities[i]) };
+            commands.add(entities[i], previous);
+        }
+        start = Clock::now();
+        world.apply(commands);
+        best[3] = std::min(best[3], msSince(start));
+        for (int i = 0; i < entityCount; i++)
+            commands.remove<PreviousTransform>(entities[i]);
+        start = Clock::now();
+        world.apply(commands);
+        best[4] = std::min(best[4], msSince(start));
+        if (world.count(world.query(MaskOf<PreviousTransform>())) != 0 || world.getEntityCount() != entityCount)
+        {
+            std::cout << "ERROR::ECS_BENCHMARK::WRONG_COUNT" << std::endl;
+            return -1;
+        }
+
+        start = Clock::now();
+        for (int i = 0; i < entityCount; i++)
+            world.destroy(entities[i]);
+        best[5] = std::min(best[5], msSince(start));
+    }
+
+    std::cout << "Benchmark: ecs, " << entityCount << " entities, " << pool.getThreadCount()
+        << " threads (best of " << runs << " runs)" << std::endl;
+    std::cout << std::left << std::setw(24) << "operation" << std::right << std::setw(12) << "ms"
+        << std::setw(16) << "M entities/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int i = 0; i < 6; i++)
+        std::cout << std::left << std::setw(24) << names[i] << std::right << std::setw(12) << best[i]
+            << std::setw(16) << entityCount / (best[i] * 1000.0) << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+    return 0;
+}
+
+// checks the math kernels of every instruction set the CPU has against glm
+// and times them; -1 if a result is off by more than rounding
+int RunSimdBenchmark()
+{
+    typedef std::chrono::steady_clock Clock;
+    const int count = 4096; // items per call, small enough to stay in the cache
+    const int calls = 100;
+    const int runs = 5;
+    const float tolerance = 1e-5f;
+    srand(1);
+    auto random = [](float low, float high)
+    {
+        return low + (high - low) * (float)rand() / RAND_MAX;
+    };
+    std::vector<glm::mat4> a(count), b(count), matrices(count);
+    std::vector<glm::vec4> vectors(count), transformed(count);
+    std::vector<glm::quat> rotations(count);
+    std::vector<glm::vec3> positions(count), scales(count);
+    for (int i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+            {
+                a[i][c][r] = random(-1.f, 1.f);
+                b[i][c][r] = random(-1.f, 1.f);
+            }
+        vectors[i] = glm::vec4(random(-10.f, 10.f), random(-10.f, 10.f), random(-10.f, 10.f), 1.f);
+        rotations[i] = glm::normalize(glm::quat(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f)));
+        positions[i] = glm::vec3(random(-100.f, 100.f), random(-100.f, 100.f), random(-100.f, 100.f));
+        scales[i] = glm::vec3(random(0.1f, 4.f), random(0.1f, 4.f), random(0.1f, 4.f));
+    }
+    const glm::mat4& pv = a[0];
+
+    const int kernelCount = 6;
+    const char* names[kernelCount] = { "mat4 * mat4", "pv * mat4", "mat4 * vec4", "pv * vec4", "quat to mat4", "TRS compose" };
+    auto run = [&](int kernel)
+    {
+        switch (kernel)
+        {
+        case 0: MathKernels::multiply(a.data(), b.data(), matrices.data(), count); break;
+        case 1: MathKernels::multiply(pv, b.data(), matrices.data(), count); break;
+        case 2: MathKernels::transform(a.data(), vectors.data(), transformed.data(), count); break;
+        case 3: MathKernels::transform(pv, vectors.data(), transformed.data(), count); break;
+        case 4: MathKernels::quatToMat4(rotations.data(), matrices.data(), count); break;
+        default: MathKernels::composeTRS(positions.data(), rotations.data(), scales.data(), matrices.data(), count); break;
+        }
+    };
+    // the largest difference to glm relative to the size of glm's result, after a run
+    auto difference = [](const float* result, const float* expected, int n)
+    {
+        float worst = 0.f;
+        for (int i = 0; i < n; i++)
+            worst = std::max(worst, std::abs(result[i] - expected[i]) / std::max(std::abs(expected[i]), 1.f));
+        return worst;
+    };
+    auto error = [&](int kernel)
+    {
+        float worst = 0.f;
+        for (int i = 0; i < count; i++)
+        {
+            glm::mat4 expected;
+            glm::vec4 expectedVector;
+            switch (kernel)
+            {
+            case 0: expected = a[i] * b[i]; break;
+            case 1: expected = pv * b[i]; break;
+            case 2: expectedVector = a[i] * vectors[i]; break;
+            case 3: expectedVector = pv * vectors[i]; break;
+            case 4: expected = glm::mat4_cast(rotations[i]); break;
+            default:
+                expected = glm::translate(glm::mat4(1.f), positions[i]) * glm::mat4_cast(rotations[i])
+                    * glm::scale(glm::mat4(1.f), scales[i]);
+                break;
+            }
+            worst = kernel == 2 || kernel == 3
+                ? std::max(worst, difference(&transformed[i][0], &expectedVector[0], 4))
+                : std::max(worst, difference(&matrices[i][0][0], &expected[0][0], 16));
+        }
+        return worst;
+    };
+
+    double nanoseconds[kernelCount][MATH_ISA_COUNT];
+    float errors[kernelCount][MATH_ISA_COUNT];
+    bool failed = false;
+    for (int isa = 0; isa < MATH_ISA_COUNT; isa++)
+    {
+        if (!MathKernels::setIsa((MathIsa)isa))
+            continue;
+        for (int kernel = 0; kernel < kernelCount; kernel++)
+        {
+            run(kernel);
+            errors[kernel][isa] = error(kernel);
+            if (errors[kernel][isa] > tolerance)
+            {
+                std::cout << "ERROR::SIMD_BENCHMARK::MISMATCH " << names[kernel] << " "
+                    << MathKernels::getIsaName((MathIsa)isa) << " differs from glm by " << errors[kernel][isa] << std::endl;
+                failed = true;
+            }
+            double best = 1e30;
+            for (int r = 0; r < runs; r++)
+            {
+                Clock::time_point start = Clock::now();
+                for (int call = 0; call < calls; call++)
+                    run(kernel);
+                best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+            }
+            nanoseconds[kernel][isa] = best / ((double)calls * count);
+        }
+    }
+    MathKernels::setIsa(MathKernels::getBestIsa());
+
+    std::cout << "Benchmark: simd, " << count << " items per call, best of " << runs << " runs, "
+        << MathKernels::getIsaName(MathKernels::getBestIsa()) << " picked at run time" << std::endl;
+    std::cout << "ns per item (max relative error against glm)" << std::endl;
+    std::cout << std::left << std::setw(24) << "kernel" << std::right;
+    for (int isa = 0; isa < MATH_ISA_COUNT; isa++)
+        std::cout << std::setw(20) << MathKernels::getIsaName((MathIsa)isa);
+    std::cout << std::endl;
+    for (int kernel = 0; kernel < kernelCount; kernel++)
+    {
+        std::cout << std::left << std::setw(24) << names[kernel] << std::right;
+        for (int isa = 0; isa < MATH_ISA_COUNT; isa++)
+        {
+            std::ostringstream cell;
+            if (MathKernels::isSupported((MathIsa)isa))
+                cell << std::fixed << std::setprecision(3) << nanoseconds[kernel][isa]
+                    << " (" << std::scientific << std::setprecision(0) << errors[kernel][isa] << ")";
+            else
+                cell << "-";
+            std::cout << std::setw(20) << cell.str();
+        }
+        std::cout << std::endl;
+    }
+    return failed ? -1 : 0;
+}
+
+// a window for tools that render but show nothing; NULL (GLFW terminated) on failure
+GLFWwindow* CreateHiddenWindow(int width, int height, const char* title)
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return -1;
+        return NULL;
     }
     glfwMakeContextCurrent(window);
-    /* called each time the window is resized */
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    return window;
+}
+
+// plays a capture in a hidden window of the captured size and prints the frame times
+int RunReplay(const std::string& path)
+{
+    GLReplay replay;
+    if (!replay.load(path))
+    {
+        glfwTerminate();
         return -1;
     }
+    GLFWwindow* window = CreateHiddenWindow(replay.getWidth(), replay.getHeight(), "LearnOpenGL replay");
+    if (!window)
+        return -1;
+    replay.run(window);
+    replay.printReport(std::cout);
+    glfwTerminate();
+    return 0;
+}
 
-    glEnable(GL_DEPTH_TEST); //  
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    UpdatePolygonMode();
-    glfwSetScrollCallback(window, OnScroll);
-    glfwSetKeyCallback(window, OnKeyAction);
-    glEnable(GL_CULL_FACE); //    (     )
-    glFrontFace(GL_CCW); //   -      
-                        //     
-                        //   
-#pragma endregion
+// binary PPM files, which stb_image reads; every texture has its own pattern
+std::vector<std::string> WriteTestTextures(const std::string& prefix, int count, int size)
+{
+    std::vector<std::string> paths;
+    std::vector<unsigned char> pixels(size * size * 3);
+    for (int t = 0; t < count; t++)
+    {
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+            {
+                unsigned char* p = &pixels[(y * size + x) * 3];
+                bool check = ((x >> (2 + t % 5)) ^ (y >> (2 + t % 5))) & 1;
+                p[0] = (unsigned char)(check ? 40 + t * 2 : 220 - t);
+                p[1] = (unsigned char)(x * 255 / size);
+                p[2] = (unsigned char)((y + t * 7) & 255);
+            }
+        paths.push_back(prefix + std::to_string(t) + ".ppm");
+        std::ofstream file(paths.back(), std::ios::binary);
+        file << "P6\n" << size << " " << size << "\n255\n";
+        file.write((const char*)pixels.data(), pixels.size());
+    }
+    return paths;
+}
+
+// Cycles through more textures and meshes than fit in the VRAM budget: every
+// frame draws a window of them that moves on by one, so one of each comes back
+// from disk (the textures) or is generated again (the meshes) per frame.
+// Compares an unlimited budget with the given one; the worst frame shows the hitches.
+int RunVramBenchmark(size_t budgetBytes)
+{
+    const int textureCount = 96, meshCount = 32, textureSize = 512;
+    const int texturesPerFrame = 16, meshesPerFrame = 4;
+    const int warmupFrames = 60, measureFrames = 600;
+    GLFWwindow* window = CreateHiddenWindow(1280, 720, "LearnOpenGL vram benchmark");
+    if (!window)
+        return -1;
+    glfwSwapInterval(0);
+    std::vector<std::string> paths = WriteTestTextures("vram_bench_", textureCount, textureSize);
+
+    ShaderManager* shaders = new ShaderManager();
+    Shader* textureShader = shaders->load("shaders/fullscreen.vert", "shaders/upscale_sharpen.frag");
+    Shader* meshShader = shaders->load("shaders/depth_only.vert", "shaders/depth_only.frag");
+    if (!shaders->finish())
+    {
+        glfwTerminate();
+        return -1;
+    }
+    GLuint emptyVAO;
+    glGenVertexArrays(1, &emptyVAO);
+    std::vector<VertexAttribute> layout(1);
+    layout[0].location = 0;
+    layout[0].components = 3;
+    layout[0].offset = 0;
+
+    const char* modeNames[2] = { "unlimited", "budget" };
+    std::cout << "Benchmark: vram, " << textureCount << " textures " << textureSize << "x" << textureSize << ", "
+        << meshCount << " meshes, budget " << budgetBytes / (1024 * 1024) << " MB (" << measureFrames << " frames)" << std::endl;
+    std::cout << std::left << std::setw(24) << "mode" << std::right << std::setw(12) << "avg ms" << std::setw(12) << "worst ms"
+        << std::setw(12) << "peak MB" << std::setw(12) << "reloads" << std::setw(12) << "evictions"
+        << std::setw(12) << "mip drops" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int mode = 0; mode < 2; mode++)
+    {
+        ResourceManager* resources = new ResourceManager();
+        std::vector<ResourceHandle> textures, meshes;
+        for (int t = 0; t < textureCount; t++)
+            textures.push_back(resources->loadTexture(paths[t]));
+        for (int m = 0; m < meshCount; m++)
+        {
+            // spheres of different detail, positions only
+            int stacks = 24 + m;
+            meshes.push_back(resources->createMesh("sphere " + std::to_string(stacks), 3, layout,
+                [stacks](std::vector<float>& vertices)
+            {
+                MeshData sphere = CreateSphere(stacks, stacks * 2);
+                vertices.clear();
+                for (size_t i = 0; i < sphere.indices.size(); i++)
+                {
+                    const glm::vec3& p = sphere.vertices[sphere.indices[i]].position;
+                    vertices.push_back(p.x);
+                    vertices.push_back(p.y);
+                    vertices.push_back(p.z);
+                }
+                return true;
+            }));
+        }
+        if (mode == 1)
+            resources->setBudget(budgetBytes);
+
+        double sumMs = 0.0, worstMs = 0.0;
+        int reloadsBefore = 0, evictionsBefore = 0, mipDropsBefore = 0;
+        for (int frame = 0; frame < warmupFrames + measureFrames; frame++)
+        {
+            if (frame == warmupFrames)
+            {
+                reloadsBefore = resources->getReloadCount();
+                evictionsBefore = resources->getEvictionCount();
+                mipDropsBefore = resources->getMipDropCount();
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, 1280, 720);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // the textures as tiles
+            glDisable(GL_DEPTH_TEST);
+            textureShader->use();
+            textureShader->setInt("source", 0);
+            textureShader->setFloat("sharpness", 0.f);
+            glBindVertexArray(emptyVAO);
+            for (int i = 0; i < texturesPerFrame; i++)
+            {
+                glViewport((i % 8) * 160, (i / 8) * 160, 160, 160);
+                glBindTexture(GL_TEXTURE_2D, resources->use(textures[(frame + i) % textureCount]));
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            glEnable(GL_DEPTH_TEST);
+            glViewport(0, 0, 1280, 720);
+            meshShader->use();
+            glm::mat4 pv = glm::perspective(glm::radians(60.f), 1280.f / 720.f, 0.1f, 100.f);
+            meshShader->setMatrix4f("pv", pv);
+            for (int i = 0; i < meshesPerFrame; i++)
+            {
+                ResourceHandle mesh = meshes[(frame + i) % meshCount];
+                glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(-3.f + i * 2.f, -1.f, -6.f));
+                meshShader->setMatrix4f("model", model);
+                glBindVertexArray(resources->use(mesh));
+                glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(resources->getBytes(mesh) / (3 * sizeof(float))));
+            }
+            glBindVertexArray(0);
+            resources->endFrame();
+            glfwSwapBuffers(window);
+            // uploads finish inside the frame they were made in
+            glFinish();
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (frame >= warmupFrames)
+            {
+                sumMs += ms;
+                worstMs = std::max(worstMs, ms);
+            }
+        }
+        std::cout << std::left << std::setw(24) << modeNames[mode] << std::right << std::setw(12) << sumMs / measureFrames
+            << std::setw(12) << worstMs << std::setw(12) << resources->getPeakResidentBytes() / (1024.0 * 1024.0)
+            << std::setw(12) << resources->getReloadCount() - reloadsBefore
+            << std::setw(12) << resources->getEvictionCount() - evictionsBefore
+            << std::setw(12) << resources->getMipDropCount() - mipDropsBefore << std::endl;
+        for (int t = 0; t < textureCount; t++)
+            resources->release(textures[t]);
+        for (int m = 0; m < meshCount; m++)
+            resources->release(meshes[m]);
+        delete resources;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+
+    for (int t = 0; t < textureCount; t++)
+        std::remove(paths[t].c_str());
+    glDeleteVertexArrays(1, &emptyVAO);
+    delete shaders;
+    glfwTerminate();
+    return 0;
+}
+
+// Flies a camera down a corridor of textured panels and compares three ways
+// of getting their textures:
+//   upfront    every texture in full before the first frame, as the scene loads them
+//   on demand  in full in the frame its first panel comes within the view distance
+//   streaming  through the TextureStreamer, only the levels the panels' size on screen needs
+// A hitch is a frame that took more than twice the median frame of its run.
+int RunStreamingBenchmark()
+{
+    const int textureCount = 32, textureSize = 1024, panelCount = 64;
+    const int frames = 600, width = 1280, height = 720;
+    const float spacing = 4.f, panelSize = 3.f, viewDistance = 40.f;
+    GLFWwindow* window = CreateHiddenWindow(width, height, "LearnOpenGL streaming benchmark");
+    if (!window)
+        return -1;
+    glfwSwapInterval(0);
+    std::vector<std::string> paths = WriteTestTextures("streaming_bench_", textureCount, textureSize);
+
+    ShaderManager* shaders = new ShaderManager();
+    Shader* shader = shaders->load("shaders/streamed.vert", "shaders/streamed.frag");
+    if (!shaders->finish())
+    {
+        glfwTerminate();
+        return -1;
+    }
+    // a panel in the yz plane, facing +x
+    const float quad[] = {
+        0.f, -0.5f, -0.5f,  0.f, 0.f,
+        0.f, -0.5f,  0.5f,  1.f, 0.f,
+        0.f,  0.5f,  0.5f,  1.f, 1.f,
+        0.f, -0.5f, -0.5f,  0.f, 0.f,
+        0.f,  0.5f,  0.5f,  1.f, 1.f,
+        0.f,  0.5f, -0.5f,  0.f, 1.f,
+    };
+    std::vector<VertexAttribute> layout(2);
+    layout[0].location = 0;
+    layout[0].components = 3;
+    layout[0].offset = 0;
+    layout[1].location = 1;
+    layout[1].components = 2;
+    layout[1].offset = 3;
+    // the panels alternate between the walls, every texture is on two of them
+    std::vector<glm::mat4> models;
+    std::vector<glm::vec3> centers;
+    for (int i = 0; i < panelCount; i++)
+    {
+        centers.push_back(glm::vec3(i % 2 ? 3.f : -3.f, 0.f, 4.f + (i / 2) * spacing));
+        glm::mat4 model = glm::translate(glm::mat4(1.f), centers.back());
+        if (i % 2)
+            model = glm::rotate(model, glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f));
+        models.push_back(glm::scale(model, glm::vec3(panelSize)));
+    }
+    float panelRadius = panelSize * 0.7072f;
+    float corridorLength = 4.f + (panelCount / 2 - 1) * spacing;
+
+    const char* modeNames[3] = { "upfront", "on demand", "streaming" };
+    std::cout << "Benchmark: streaming, " << textureCount << " textures " << textureSize << "x" << textureSize << ", "
+        << panelCount << " panels (" << frames << " frames)" << std::endl;
+    std::cout << std::left << std::setw(24) << "mode" << std::right << std::setw(12) << "load ms" << std::setw(12) << "avg ms"
+        << std::setw(12) << "worst ms" << std::setw(12) << "hitches" << std::setw(12) << "peak MB"
+        << std::setw(12) << "upload MB" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (int mode = 0; mode < 3; mode++)
+    {
+        ResourceManager* resources = new ResourceManager();
+        TextureStreamer* streamer = mode == 2 ? new TextureStreamer() : NULL;
+        ResourceHandle panel = resources->createMesh(quad, 6, 5, layout, "panel");
+        std::vector<ResourceHandle> loaded(textureCount, ResourceHandle());
+        std::vector<int> streamed(textureCount, -1);
+
+        std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+        for (int t = 0; t < textureCount; t++)
+            if (mode == 0)
+                loaded[t] = resources->loadTexture(paths[t]);
+            else if (mode == 2)
+                streamed[t] = streamer->add(paths[t]);
+        glFinish();
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+        Camera flyCamera(glm::vec3(0.f, 0.f, 0.f));
+        std::vector<double> times;
+        size_t peakBytes = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            flyCamera.Position.z = corridorLength * frame / (frames - 1);
+            glm::mat4 pv = flyCamera.GetViewProjectionMatrix();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glEnable(GL_DEPTH_TEST);
+            shader->use();
+            shader->setMatrix4f("pv", pv);
+            shader->setInt("source", 0);
+            glBindVertexArray(resources->use(panel));
+            for (int i = 0; i < panelCount; i++)
+            {
+                float depth = glm::dot(centers[i] - flyCamera.Position, flyCamera.Front);
+                if (depth < -panelRadius || depth > viewDistance)
+                    continue;
+                int t = i % textureCount;
+                GLuint texture;
+                if (streamer)
+                {
+                    streamer->request(streamed[t], streamer->requiredLevel(streamed[t], flyCamera, centers[i], panelRadius, height));
+                    texture = streamer->get(streamed[t]);
+                }
+                else
+                {
+                    if (loaded[t].isNull())
+                        loaded[t] = resources->loadTexture(paths[t]);
+                    texture = resources->use(loaded[t]);
+                }
+                shader->setMatrix4f("model", models[i]);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glBindVertexArray(0);
+            if (streamer)
+                streamer->update();
+            resources->endFrame();
+            glfwSwapBuffers(window);
+            // uploads finish inside the frame they were made in
+            glFinish();
+
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            peakBytes = std::max(peakBytes, streamer ? streamer->getStats().residentBytes : resources->getVRAM(RESOURCE_TEXTURE));
+        }
+
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2], sumMs = 0.0;
+        int hitches = 0;
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            sumMs += times[i];
+            if (times[i] > 2.0 * median)
+                hitches++;
+        }
+        double uploadMB = (streamer ? (double)streamer->getStats().uploadedBytes : (double)resources->getVRAM(RESOURCE_TEXTURE))
+            / (1024.0 * 1024.0);
+        std::cout << std::left << std::setw(24) << modeNames[mode] << std::right << std::setw(12) << loadMs
+            << std::setw(12) << sumMs / frames << std::setw(12) << sorted.back() << std::setw(12) << hitches
+            << std::setw(12) << peakBytes / (1024.0 * 1024.0) << std::setw(12) << uploadMB << std::endl;
+        if (streamer)
+        {
+            streamer->printReport(std::cout);
+            delete streamer;
+        }
+        for (int t = 0; t < textureCount; t++)
+            if (!loaded[t].isNull())
+                resources->release(loaded[t]);
+        resources->release(panel);
+        delete resources;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
 
-    int box_width, box_height, channels;
-    byte* data = stbi_load("images/box.png", &box_width, &box_height, &channels, 0);
+    for (int t = 0; t < textureCount; t++)
+        std::remove(paths[t].c_str());
+    delete shaders;
+    glfwTerminate();
+    return 0;
+}
+
+// Draws a field of spheres for 1 to MAX_VIEWS cameras looking out from the
+// middle in evenly spread directions, like a panorama or a cube map capture.
+// Every view count runs with the whole draw loop once per view and with each
+// single pass path the driver supports. "submit ms" is the CPU time of the draw
+// loop; "frame ms" waits for the GPU as well.
+int RunMultiViewBenchmark()
+{
+    const int gridSize = 48, warmupFrames = 30, measureFrames = 200;
+    const int width = 1280, height = 720, viewWidth = 640, viewHeight = 360;
+    GLFWwindow* window = CreateHiddenWindow(width, height, "LearnOpenGL multi-view benchmark");
+    if (!window)
+        return -1;
+    glfwSwapInterval(0);
+
+    ResourceManager* resources = new ResourceManager();
+    std::vector<VertexAttribute> layout(2);
+    layout[0].location = 0;
+    layout[0].components = 3;
+    layout[0].offset = 0;
+    layout[1].location = 1;
+    layout[1].components = 3;
+    layout[1].offset = 3;
+    MeshData sphere = CreateSphere(8, 16);
+    std::vector<float> vertices;
+    for (size_t i = 0; i < sphere.indices.size(); i++)
+    {
+        const Vertex& v = sphere.vertices[sphere.indices[i]];
+        float data[6] = { v.position.x, v.position.y, v.position.z, v.normal.x, v.normal.y, v.normal.z };
+        vertices.insert(vertices.end(), data, data + 6);
+    }
+    GLsizei vertexCount = (GLsizei)sphere.indices.size();
+    ResourceHandle sphereHandle = resources->createMesh(vertices.data(), vertexCount, 6, layout, "multi-view sphere");
+    GLuint sphereVAO = resources->get(sphereHandle);
+    std::vector<glm::mat4> models;
+    for (int z = 0; z < gridSize; z++)
+        for (int x = 0; x < gridSize; x++)
+        {
+            if (std::abs(x - gridSize / 2) < 2 && std::abs(z - gridSize / 2) < 2)
+                continue;
+            glm::vec3 position((x - gridSize / 2) * 2.5f, (float)((x * 7 + z * 3) % 5) - 2.f, (z - gridSize / 2) * 2.5f);
+            models.push_back(glm::translate(glm::mat4(1.f), position));
+        }
+
+    MultiView* multiView = new MultiView(viewWidth, viewHeight, MAX_VIEWS);
+    const char* pathNames[MULTI_VIEW_PATH_COUNT] = { "vertex layer", "geometry shader", "pass per view" };
+    std::cout << "Benchmark: multi-view, " << models.size() << " objects, " << viewWidth << "x" << viewHeight
+        << " per view (" << measureFrames << " frames)" << std::endl;
+    if (!multiView->isVertexLayerSupported())
+        std::cout << "No ARB_shader_viewport_layer_array or AMD_vertex_shader_layer, the vertex layer path is skipped" << std::endl;
+    std::cout << std::left << std::setw(8) << "views" << std::setw(24) << "path" << std::right << std::setw(12) << "submit ms"
+        << std::setw(12) << "frame ms" << std::setw(12) << "draws" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    const int viewCounts[] = { 1, 2, 4, 6, 8 };
+    for (int c = 0; c < 5; c++)
+    {
+        int views = std::min(viewCounts[c], MAX_VIEWS);
+        std::vector<Camera> cameras;
+        cameras.reserve(views);
+        std::vector<Camera*> cameraPointers;
+        for (int v = 0; v < views; v++)
+        {
+            cameras.push_back(Camera(glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f), 360.f * v / views, 0.f));
+            cameras.back().AspectRatio = (float)viewWidth / viewHeight;
+            cameraPointers.push_back(&cameras.back());
+        }
+
+        for (int p = MULTI_VIEW_PATH_COUNT - 1; p >= 0; p--)
+        {
+            if (p == MULTI_VIEW_VERTEX_LAYER && !multiView->isVertexLayerSupported())
+                continue;
+            double submitMs = 0.0, frameMs = 0.0;
+            for (int frame = 0; frame < warmupFrames + measureFrames; frame++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                multiView->begin(cameraPointers, (MultiViewPath)p);
+                for (int pass = 0; pass < multiView->getPassCount(); pass++)
+                {
+                    multiView->beginPass(pass);
+                    for (size_t i = 0; i < models.size(); i++)
+                        multiView->draw(sphereVAO, vertexCount, models[i]);
+                }
+                multiView->end();
+                double submitted = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                glClear(GL_COLOR_BUFFER_BIT);
+                multiView->blitToScreen(width, height);
+                glfwSwapBuffers(window);
+                glFinish();
+                if (frame >= warmupFrames)
+                {
+                    submitMs += submitted;
+                    frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+            }
+            std::cout << std::left << std::setw(8) << views << std::setw(24) << pathNames[p] << std::right
+                << std::setw(12) << submitMs / measureFrames << std::setw(12) << frameMs / measureFrames
+                << std::setw(12) << multiView->getDrawCalls() << std::endl;
+        }
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+
+    delete multiView;
+    resources->release(sphereHandle);
+    delete resources;
+    glfwTerminate();
+    return 0;
+}
+
+// The scene or a benchmark drawn by the CPU rasterizer, without a window or a
+// GL context. The simulation advances by a fixed 1/60s per frame, so the frames
+// are the same on every run; outputPrefix writes each of them as a PPM file.
+int RunSoftware(const MeshData& cubeMesh, const std::string& scenePath, const std::string& benchName,
+    int frameCount, const std::string& outputPrefix)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int width = 1280, height = 720;
+    const double simStep = 1.0 / 60.0;
+    Scene scene;
+    if (!scene.load(scenePath) || scene.getTextureCount() == 0)
+    {
+        std::cout << "Failed to load scene " << scenePath << std::endl;
+        return -1;
+    }
+    camera.AspectRatio = (float)width / height;
+
+    // texture i of the rasterizer is scene texture i
+    SoftwareRasterizer raster(width, height);
+    for (int i = 0; i < scene.getTextureCount(); i++)
+    {
+        const SceneTexture& texture = scene.getTexture(i);
+        int textureWidth, textureHeight, channels;
+        byte* data = stbi_load(texture.path.text, &textureWidth, &textureHeight, &channels, 0);
+        if (!data)
+        {
+            std::cout << "Failed to load texture " << texture.path.text << std::endl;
+            return -1;
+        }
+        std::vector<byte> tinted(textureWidth * textureHeight * channels);
+        TintImage(data, tinted.data(), textureWidth * textureHeight, channels, texture.tint);
+        raster.addTexture(textureWidth, textureHeight, tinted.data(), channels);
+        stbi_image_free(data);
+    }
+
+    std::vector<ModelTransform> benchObjects;
+    std::vector<MeshInstance> lodInstances;
+    Benchmark* benchmark = benchName.empty() ? NULL
+        : CreateBenchmark(benchName, scene.getTextureCount(), benchObjects, lodInstances);
+    LodMesh* lodMesh = benchName == "lod" ? CreateLodSphere(false) : NULL;
+    const int objectCount = benchmark ? (int)benchObjects.size() : scene.getObjectCount();
+    std::vector<glm::mat4> models(objectCount);
+    std::vector<int> textures(objectCount);
+    for (int i = 0; i < objectCount; i++)
+    {
+        models[i] = benchmark ? benchObjects[i].getModelMatrix() : scene.transformAt(i, 0.0).getModelMatrix();
+        textures[i] = benchmark ? i % scene.getTextureCount() : scene.getObject(i).texture;
+    }
+
+    RenderSettings settings = { wireframeMode, shadowCacheEnabled, depthPrepass, occlusionCulling,
+        lodEnabled, staticBatching, dynamicResolution, lighting, uniformBranches, swapInterval };
+    glm::vec3 lightDir = glm::normalize(glm::vec3(0.2f, -1.0f, 0.8f));
+    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    std::vector<unsigned char> pixels(outputPrefix.empty() ? 0 : width * height * 3);
+    double simTime = 0.0, statsMs = 0.0;
+    int statsFrames = 0;
+    for (int frame = 0; benchmark ? !benchmark->isFinished() : frame < frameCount; frame++)
+    {
+        Clock::time_point start = Clock::now();
+        if (benchmark)
+            ApplyBenchmarkSettings(benchName, benchmark->getMode(), settings);
+        if (!benchmark)
+            for (int i = 0; i < objectCount; i++)
+                if (scene.getObject(i).animation >= 0)
+                    models[i] = scene.transformAt(i, simTime).getModelMatrix();
+
+        raster.lighting = settings.lighting;
+        raster.begin(camera.GetViewProjectionMatrix(), lightDir, lightColor, glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+        for (int i = 0; i < objectCount; i++)
+            raster.draw(&cubeMesh, models[i], textures[i]);
+        if (lodMesh)
+        {
+            lodMesh->lodEnabled = settings.lod;
+            lodMesh->select(lodInstances, camera, height, camera.GetFrustum());
+            for (int l = 0; l < lodMesh->getLodCount(); l++)
+            {
+                const std::vector<MeshInstance>& group = lodMesh->getLodGroup(l);
+                for (size_t i = 0; i < group.size(); i++)
+                    raster.draw(&lodMesh->getLodMesh(l), group[i].model, (int)group[i].layer);
+            }
+        }
+        raster.end();
+        double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        if (!outputPrefix.empty())
+        {
+            // the color buffer starts with the bottom row
+            const unsigned int* colors = raster.getColorBuffer();
+            for (int y = 0; y < height; y++)
+            {
+                const unsigned char* row = (const unsigned char*)(colors + (height - 1 - y) * raster.getStride());
+                for (int x = 0; x < width; x++)
+                    for (int c = 0; c < 3; c++)
+                        pixels[(y * width + x) * 3 + c] = row[x * 4 + c];
+            }
+            std::ofstream file(outputPrefix + std::to_string(frame) + ".ppm", std::ios::binary);
+            file << "P6\n" << width << " " << height << "\n255\n";
+            file.write((const char*)pixels.data(), pixels.size());
+        }
+
+        if (benchmark)
+        {
+            benchmark->addCounter("setup ms", raster.getSetupMs());
+            benchmark->addCounter("raster ms", raster.getRasterMs());
+            benchmark->addCounter("triangles", raster.getTriangleCount());
+            benchmark->frameDone(frameMs, 0.0);
+        }
+
+        // once per second of the simulation
+        simTime += simStep;
+        statsMs += frameMs;
+        if (++statsFrames == 60)
+        {
+            std::cout << "software | " << statsFrames * 1000.0 / statsMs << " fps | " << width << "x" << height
+                << ", " << raster.getTriangleCount() << " triangles, " << raster.getThreadCount()
+                << " threads | setup " << raster.getSetupMs() << "ms, raster " << raster.getRasterMs() << "ms" << std::endl;
+            statsFrames = 0;
+            statsMs = 0.0;
+        }
+    }
+    if (benchmark)
+    {
+        std::cout << "software, " << raster.getThreadCount() << " threads" << std::endl;
+        benchmark->printReport(std::cout);
+    }
+
+    delete lodMesh;
+    delete benchmark;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // --bench <name> runs a benchmark scene, prints the results and exits
+    // --budget <ms>, --min-scale <s>, --max-scale <s> configure the dynamic resolution
+    // --vsync <interval> (0, 1, -1 for adaptive) and --fps <limit> configure the frame pacing
+    // --render-thread submits GL from a separate thread
+    // --sim-rate <hz> sets the rate of the fixed simulation steps
+    // --serial-shaders builds the shaders one by one, to compare the startup time
+    // --software renders the scene on the CPU without a window or GL, prints the frame times and exits
+    // --frames <n> sets how many frames it renders outside the benchmarks (600 by default)
+    // --software-out <prefix> writes every frame it renders to <prefix><frame>.ppm
+    // --capture <file> <first> <count> records the GL calls up to frame first + count and exits
+    // --replay <file> plays a capture without the application, prints the frame times and exits
+    // --scene <file> loads a text or binary scene instead of scenes/default.scene
+    // --compile-scene <in> <out> converts a scene to the binary form and exits
+    // --bench scene-load times loading a million objects from both forms of the scene file
+    // --bench ecs times creating, animating, changing and destroying a million entities
+    // --bench vram cycles through more textures and meshes than fit in a VRAM budget,
+    // --vram-budget <MB> sets it (64 MB by default)
+    // --bench streaming flies through textured panels, loading the textures in full or streaming their mip levels
+    // --bench multiview renders up to 8 cameras with a pass per view and in a single layered pass
+    // --bench simd checks the SIMD math kernels against glm and times them per instruction set
+    std::string benchName;
+    float gpuBudgetMs = 16.6f, minScale = 0.5f, maxScale = 1.f;
+    double fpsLimit = 0.0;
+    bool renderThread = false;
+    double simRate = 60.0;
+    bool parallelShaders = true;
+    bool softwareRendering = false;
+    int softwareFrames = 600;
+    std::string softwareOutput;
+    std::string capturePath, replayPath;
+    std::string scenePath = "scenes/default.scene", compileInput, compileOutput;
+    int captureFirst = 0, captureCount = 0;
+    double vramBudgetMB = 0.0;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            benchName = argv[++i];
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+            gpuBudgetMs = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--min-scale") == 0 && i + 1 < argc)
+            minScale = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-scale") == 0 && i + 1 < argc)
+            maxScale = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc)
+            swapInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            fpsLimit = atof(argv[++i]);
+        else if (strcmp(argv[i], "--render-thread") == 0)
+            renderThread = true;
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc)
+            simRate = std::max(atof(argv[++i]), 1.0);
+        else if (strcmp(argv[i], "--serial-shaders") == 0)
+            parallelShaders = false;
+        else if (strcmp(argv[i], "--software") == 0)
+            softwareRendering = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            softwareFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--software-out") == 0 && i + 1 < argc)
+            softwareOutput = argv[++i];
+        else if (strcmp(argv[i], "--capture") == 0 && i + 3 < argc)
+        {
+            capturePath = argv[++i];
+            captureFirst = atoi(argv[++i]);
+            captureCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (strcmp(argv[i], "--vram-budget") == 0 && i + 1 < argc)
+            vramBudgetMB = atof(argv[++i]);
+        else if (strcmp(argv[i], "--compile-scene") == 0 && i + 2 < argc)
+        {
+            compileInput = argv[++i];
+            compileOutput = argv[++i];
+        }
+
+    // tools that don't need a window
+    if (benchName == "scene-load")
+        return RunSceneLoadBenchmark();
+    if (benchName == "ecs")
+        return RunEcsBenchmark();
+    if (benchName == "simd")
+        return RunSimdBenchmark();
+    if (!compileInput.empty())
+    {
+        Scene scene;
+        if (!scene.load(compileInput) || !scene.saveBinary(compileOutput))
+            return -1;
+        std::cout << "Compiled " << compileInput << " to " << compileOutput << ", "
+            << scene.getObjectCount() << " objects" << std::endl;
+        return 0;
+    }
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -189,185 +1423,751 @@ int main()
         -1.0f, 1.0f, 1.0f,	0.0f,  1.0f,  0.0f,		0.0f, 0.0f,		0.0f, 1.0f, 0.0f
     };
 
-    ModelTransform polygonTrans1 = {
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(1.f, 1.f, 1.f),
-    };
-    
-    ModelTransform polygonTrans2 = {
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(1.f, 1.f, 1.f),
-    };
-    ModelTransform polygonTrans3 = {
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(0.f, 0.f, 0.f),
-        glm::vec3(1.f, 1.f, 1.f),
-    };
+    // no window and no GL at all, for machines without a GPU
+    if (softwareRendering)
+        return RunSoftware(MeshFromArray(cube, verts), scenePath, benchName, softwareFrames, softwareOutput);
+
+#pragma region WINDOW INITIALIZATION
+    /* GLFW initialization */
+    glfwInit();
+    /* GLFW configuration */
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (!replayPath.empty())
+        return RunReplay(replayPath);
+    if (benchName == "vram")
+        return RunVramBenchmark((size_t)((vramBudgetMB > 0.0 ? vramBudgetMB : 64.0) * 1024 * 1024));
+    if (benchName == "streaming")
+        return RunStreamingBenchmark();
+    if (benchName == "multiview")
+        return RunMultiViewBenchmark();
+
+    /* create window */
+    GLFWwindow* window = glfwCreateWindow(1280, 720, "LearnOpenGL", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    // benchmarks must not be limited by vsync or the frame limiter
+    FramePacer* pacer = new FramePacer();
+    if (!benchName.empty())
+    {
+        swapInterval = 0;
+        fpsLimit = 0.0;
+    }
+    pacer->setSwapInterval(swapInterval);
+    swapInterval = pacer->getSwapInterval();
+    pacer->setTargetFps(fpsLimit);
+    /* called each time the window is resized */
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    // recording starts before anything is created, so the replay can rebuild it all
+    GLCapture* capture = NULL;
+    if (!capturePath.empty())
+        capture = new GLCapture(window, capturePath, captureFirst, captureCount);
+
+    glEnable(GL_DEPTH_TEST); //  
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    UpdatePolygonMode(wireframeMode);
+    glfwSetScrollCallback(window, OnScroll);
+    glfwSetKeyCallback(window, OnKeyAction);
+    glEnable(GL_CULL_FACE); //    (     )
+    glFrontFace(GL_CCW); //   -      
+                        //     
+                        //   
+#pragma endregion
+
+
+
+    // objects, their textures and animations come from the scene file
+    Scene scene;
+    if (!scene.load(scenePath) || scene.getTextureCount() == 0)
+    {
+        std::cout << "Failed to load scene " << scenePath << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    std::cout << "Scene " << scenePath << ": " << scene.getObjectCount() << " objects, loaded in "
+        << scene.getLoadMs() << "ms (" << (scene.isBinary() ? "binary" : "text") << ")" << std::endl;
+    for (int i = 0; i < scene.getMeshCount(); i++)
+        if (strcmp(scene.getMesh(i).name.text, "cube") != 0)
+            std::cout << "Scene mesh " << scene.getMesh(i).name.text << " isn't built in, drawn as a cube" << std::endl;
+
+    // benchmark scenes replace the default one
+    std::vector<ModelTransform> benchObjects;
+    std::vector<MeshInstance> lodInstances;
+    Benchmark* benchmark = benchName.empty() ? NULL
+        : CreateBenchmark(benchName, scene.getTextureCount(), benchObjects, lodInstances);
+    LodMesh* lodMesh = benchName == "lod" ? CreateLodSphere(true) : NULL;
+    const int objectCount = benchmark ? (int)benchObjects.size() : scene.getObjectCount();
+
+    // every object is an entity; benchmark scenes don't animate and cycle through the textures
+    World world;
+    const ComponentMask staticMask = MaskOf<ModelTransform, RenderData>();
+    const ComponentMask animatedMask = staticMask | MaskOf<PreviousTransform, Animation>();
+    for (int i = 0; i < objectCount; i++)
+    {
+        const SceneObject* object = benchmark ? NULL : &scene.getObject(i);
+        bool moving = object && object->animation >= 0;
+        Entity entity = world.create(moving ? animatedMask : staticMask);
+        ModelTransform transform = object ? scene.transformAt(i, 0.0) : benchObjects[i];
+        *world.get<ModelTransform>(entity) = transform;
+        RenderData render = { i, object ? object->texture : i % scene.getTextureCount(), 0.f };
+        *world.get<RenderData>(entity) = render;
+        if (moving)
+        {
+            ModelTransform base = { object->position, object->rotation, object->scale };
+            Animation animation = { base, scene.getAnimation(object->animation) };
+            *world.get<Animation>(entity) = animation;
+            world.get<PreviousTransform>(entity)->value = transform;
+        }
+    }
+    std::vector<ModelTransform>().swap(benchObjects);
+
 
 #pragma region BUFFERS INITIALIZATION
 
-    unsigned int box_texture;
-    glGenTextures(1, &box_texture);
-    glBindTexture(GL_TEXTURE_2D, box_texture);
+    // the scene textures (tinted crates) become layers of one texture array,
+    // so objects with different textures can share a draw call
+    TextureArrayManager* materials = new TextureArrayManager();
+    std::vector<TextureSlot> textureSlots(scene.getTextureCount());
+    for (int i = 0; i < scene.getTextureCount(); i++)
+    {
+        const SceneTexture& texture = scene.getTexture(i);
+        int width, height, channels;
+        byte* data = stbi_load(texture.path.text, &width, &height, &channels, 0);
+        if (!data)
+        {
+            std::cout << "Failed to load texture " << texture.path.text << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        std::vector<byte> tinted(width * height * channels);
+        TintImage(data, tinted.data(), width * height, channels, texture.tint);
+        textureSlots[i] = materials->add(width, height, tinted.data(), channels == 3 ? GL_RGB : GL_RGBA);
+        if (textureSlots[i].array != textureSlots[0].array)
+            std::cout << "Texture " << texture.path.text << " differs in size from the first one, it won't be bound" << std::endl;
+        stbi_image_free(data);
+    }
+    GLuint crateTexture = materials->getTexture(textureSlots[0]);
+    // per object views of the entities for the renderer, indexed by RenderData::index
+    std::vector<float> objectLayers(objectCount);
+    std::vector<char> animated(objectCount, 0);
+    world.each<RenderData>([&](RenderData& render)
+    {
+        render.layer = materials->getLayer(textureSlots[render.texture]);
+        objectLayers[render.index] = render.layer;
+    });
+    world.each<RenderData, Animation>([&](RenderData& render, Animation&)
+    {
+        animated[render.index] = 1;
+    });
+
+    // GL buffers and vertex arrays are owned by the resource manager, the
+    // scene holds handles; loading the same vertices again reuses them
+    ResourceManager* resources = new ResourceManager();
+    std::vector<VertexAttribute> cubeLayout;
+    VertexAttribute position = { 0, 3, 0 }, normal = { 1, 3, 3 }, texCoords = { 2, 2, 6 }, color = { 3, 3, 8 };
+    cubeLayout.push_back(position);
+    cubeLayout.push_back(normal);
+    cubeLayout.push_back(texCoords);
+    cubeLayout.push_back(color);
+    ResourceHandle cubeHandle = resources->createMesh(cube, verts, 11, cubeLayout, "cube");
+    GLuint VAO = resources->get(cubeHandle);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // position-only copy of the vertices for depth-only passes (pre-pass, shadows),
+    // so they don't fetch normals, texture coords and colors they never use
+    GLfloat cubePositions[verts * 3];
+    for (int i = 0; i < verts; i++)
+        for (int j = 0; j < 3; j++)
+            cubePositions[i * 3 + j] = cube[i * 11 + j];
 
-    if (channels == 3)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, box_width, box_height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    else
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, box_width, box_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    //glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-
-    /* Vertex Buffer Object */
-    /* Vertex Array Object */
-    /* Element Buffer Object */
-    GLuint VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
-
-    // position attribute   
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture coords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    // color attribute
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-
-    // note that this is allowed, the call to glVertexAttribPointer registered VBO as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    // You can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO, but this rarely happens. Modifying other
-    // VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
-    glBindVertexArray(0);
+    ResourceHandle cubePositionHandle = resources->createMesh(cubePositions, verts, 3,
+        std::vector<VertexAttribute>(1, position), "cube positions");
+    GLuint positionVAO = resources->get(cubePositionHandle);
 
     // uncomment this call to draw in wireframe polygons.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 #pragma endregion
 
-    Shader* polygonShader = new Shader("shaders/basic.vert", "shaders/basic.frag");
+    // the programs compile while the rest of the scene is set up, finish() below waits for them
+    ShaderManager* shaderManager = new ShaderManager(parallelShaders);
+    // the scene shader is specialized per feature set, the render loop picks a variant
+    ShaderVariants* sceneShaders = new ShaderVariants(*shaderManager, "shaders/basic.vert", "shaders/basic.frag");
+    Shader* depthShader = shaderManager->load("shaders/depth_only.vert", "shaders/depth_only.frag");
+
+    // edited shaders are rebuilt in the background and swapped in when they link;
+    // every program of the manager is watched once they are all loaded
+    ShaderReloader* shaderReloader = new ShaderReloader(window, "shaders");
+
+    // objects that never move are merged into world space chunks of 16x16x16 units
+    std::vector<StaticInstance> staticInstances;
+    world.each<ModelTransform, RenderData>(MaskOf<Animation>(), [&](ModelTransform& transform, RenderData& render)
+    {
+        StaticInstance instance = { transform.getModelMatrix(), crateTexture, render.layer };
+        staticInstances.push_back(instance);
+    });
+    StaticBatch* staticBatch = new StaticBatch(MeshFromArray(cube, verts), staticInstances, 16.f);
+    std::cout << "Static batch: " << staticInstances.size() << " objects in " << staticBatch->getChunkCount()
+        << " chunks, built in " << staticBatch->getBuildMs() << "ms" << std::endl;
+    resources->printReport(std::cout);
+    glm::mat4 identity(1.f);
 
     //   wireframe ( )
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     glm::mat4 pvm;
 
-    double oldTime = glfwGetTime();
-    double newTime, deltaTime;
-
-    glm::vec3 lightPos = glm::vec3(5.0f, 0.0f, 0.0f);
+    glm::vec3 lightDir = glm::normalize(glm::vec3(0.2f, -1.0f, 0.8f));
     glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    /* simple render loop */
-    while (!glfwWindowShouldClose(window))
+
+    CascadedShadowMap* shadowMap = new CascadedShadowMap(*shaderManager, 2048);
+    std::vector<ShadowCaster> casters(objectCount);
+
+    GpuTimer* frameTimer = new GpuTimer();
+    GpuQuery* shadedSamples[2] = { new GpuQuery(GL_SAMPLES_PASSED), new GpuQuery(GL_SAMPLES_PASSED) };
+
+    // the scene is rendered offscreen so its depth can feed the Hi-Z pyramid
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    RenderTarget* sceneTarget = new RenderTarget(fbWidth, fbHeight);
+    HiZCuller* hiZ = new HiZCuller(*shaderManager, fbWidth, fbHeight);
+    DynamicResolution* dynamicRes = new DynamicResolution(*shaderManager, gpuBudgetMs, minScale, maxScale);
+
+    if (!shaderManager->finish())
+    {
+        std::cout << "Failed to load the shaders" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    for (size_t i = 0; i < shaderManager->getPrograms().size(); i++)
+        shaderReloader->watch(shaderManager->getPrograms()[i]);
+    const char* shaderMode = !shaderManager->isParallel() ? "serial"
+        : shaderManager->hasParallelExtension() ? "parallel compile" : "batched, no parallel compile extension";
+    std::cout << "Shaders: " << shaderManager->getProgramCount() << " programs (" << shaderManager->getCacheHits()
+        << " cache hits) in " << shaderManager->getStartupMs()
+        << "ms (" << shaderMode << "), waited " << shaderManager->getWaitMs() << "ms, warm-up "
+        << shaderManager->getWarmupMs() << "ms" << std::endl;
+
+    // per object culling state
+    std::vector<CullBox> bounds(objectCount);
+    std::vector<CullBox> testBoxes;
+    std::vector<GLint> testResults;
+
+    // the simulation publishes snapshots, the renderer draws the newest one
+    TripleBuffer<FrameSnapshot> snapshots;
+    FramePacer* simClock = new FramePacer(); // only measures the time between simulate() calls
+    std::atomic<int> simSteps(0);
+    std::mutex titleMutex;
+    std::string pendingTitle;
+
+    double statsTime = glfwGetTime();
+    int frames = 0;
+    int statsSimSteps = 0;
+    double latencySum = 0.0, latencyMs = 0.0;
+    long long allocationSum = 0;
+    // per frame lists of the simulation and the renderer; 1 MB grows to whatever a frame needs
+    FrameAllocator* frameMemory = new FrameAllocator(FRAME_THREAD_COUNT, 1024 * 1024);
+    int requestedSwapInterval = swapInterval;
+
+    // fixed timestep simulation: the animation and the keyboard movement advance
+    // in steps of simStep seconds, rendering interpolates between the last two steps
+    const double simStep = 1.0 / simRate;
+    const int maxSimSteps = 5; // per frame; beyond that the simulation slows down instead of spiralling
+    double simTime = 0.0, simAccumulator = 0.0;
+    // the models of the static entities never change, the animated ones overwrite theirs every frame
+    std::vector<glm::mat4> staticModels(objectCount);
+    world.each<ModelTransform, RenderData>([&](ModelTransform& transform, RenderData& render)
     {
-        newTime = glfwGetTime();
-        deltaTime = newTime - oldTime;
-        oldTime = newTime;
+        staticModels[render.index] = transform.getModelMatrix();
+    });
+    glm::vec3 previousCameraPos = camera.Position;
 
-        // Process some keys
-        processInput(window, deltaTime);
+    // many animated entities are animated chunk by chunk on every thread
+    const int parallelAnimationCount = 16384;
+    Query& animatedQuery = world.query(MaskOf<ModelTransform, Animation>());
+    ThreadPool* animationPool = world.count(animatedQuery) >= parallelAnimationCount ? new ThreadPool() : NULL;
+    auto animate = [&](double t)
+    {
+        auto move = [t](ModelTransform& transform, Animation& animation)
+        {
+            transform = Scene::animate(animation.base, animation.motion, t);
+        };
+        if (animationPool)
+            world.parallelForEachChunk(animatedQuery, *animationPool, [&](ChunkView& chunk, int)
+            {
+                World::eachInChunk<ModelTransform, Animation>(chunk, move);
+            });
+        else
+            world.each<ModelTransform, Animation>(move);
+    };
+    animate(simTime);
+
+    // input, animation and camera; runs on the main thread, which owns GLFW events
+    auto simulate = [&](FrameSnapshot& frame)
+    {
+        long long allocationsBefore = HeapCounter::getThreadAllocations();
+        FrameArena& arena = frameMemory->beginFrame(SIM_THREAD);
+        frame.inputTime = glfwGetTime();
+        simAccumulator += simClock->beginFrame();
+        // looking around follows the mouse every frame, it must not lag behind
+        if (!benchmark)
+            processMouse(window);
 
-        polygonTrans1.rotation.z = glfwGetTime() * 60.0;
-        polygonTrans1.rotation.x = glfwGetTime() * 45.0;
-        polygonTrans1.position.x = 3.0f * cos(glfwGetTime());
-        polygonTrans1.position.y = 3.0f * sin(glfwGetTime());
-        polygonTrans1.setUniformScale(0.2);
+        int steps = 0;
+        while (simAccumulator >= simStep && steps < maxSimSteps)
+        {
+            world.each<ModelTransform, PreviousTransform>([](ModelTransform& transform, PreviousTransform& previous)
+            {
+                previous.value = transform;
+            });
+            previousCameraPos = camera.Position;
 
-        polygonTrans2.rotation.z = glfwGetTime() * 30.0;
-        polygonTrans2.rotation.y = glfwGetTime() * 45.0;
-        polygonTrans2.position.x = 3.0f * cos(glfwGetTime() + 3.14f);
-        polygonTrans2.position.y = 3.0f * sin(glfwGetTime() + 3.14f);
-        polygonTrans2.setUniformScale(0.2f);
+            if (!benchmark)
+                processInput(window, simStep);
+            simTime += simStep;
+            animate(simTime);
+            simAccumulator -= simStep;
+            steps++;
+        }
+        if (steps == maxSimSteps)
+            simAccumulator = std::min(simAccumulator, simStep);
+        simSteps += steps;
 
-        polygonTrans3.rotation.x = glfwGetTime() * 45.0;
-        polygonTrans3.rotation.y = glfwGetTime() * 45.0;
-        polygonTrans3.setUniformScale(0.2f);
+        // state between the last two steps
+        float alpha = (float)(simAccumulator / simStep);
+        // validated before the copy, so a camera that didn't move keeps its version in the snapshot
+        camera.GetVersion();
+        frame.camera = camera;
+        if (previousCameraPos != camera.Position)
+            frame.camera.Position = glm::mix(previousCameraPos, camera.Position, alpha);
+        frame.models = staticModels;
+        // the interpolated states of the animated entities, composed into matrices in one batch
+        FrameVector<int> blendedIndices(arena);
+        FrameVector<glm::vec3> blendedPositions(arena), blendedScales(arena);
+        FrameVector<glm::quat> blendedRotations(arena);
+        blendedIndices.reserve(objectCount);
+        blendedPositions.reserve(objectCount);
+        blendedRotations.reserve(objectCount);
+        blendedScales.reserve(objectCount);
+        world.each<ModelTransform, PreviousTransform, RenderData>(
+            [&](ModelTransform& transform, PreviousTransform& previous, RenderData& render)
+        {
+            ModelTransform blended = Interpolate(previous.value, transform, alpha);
+            blendedIndices.push_back(render.index);
+            blendedPositions.push_back(blended.position);
+            blendedRotations.push_back(blended.getRotation());
+            blendedScales.push_back(blended.scale);
+        });
+        FrameVector<glm::mat4> blendedModels(blendedIndices.size(), arena);
+        MathKernels::composeTRS(blendedPositions.data(), blendedRotations.data(), blendedScales.data(),
+            blendedModels.data(), (int)blendedModels.size());
+        for (size_t i = 0; i < blendedIndices.size(); i++)
+            frame.models[blendedIndices[i]] = blendedModels[i];
+        RenderSettings settings = { wireframeMode, shadowCacheEnabled, depthPrepass, occlusionCulling,
+            lodEnabled, staticBatching, dynamicResolution, lighting, uniformBranches, swapInterval };
+        frame.settings = settings;
+        frame.fbWidth = framebufferWidth;
+        frame.fbHeight = framebufferHeight;
+        frame.simAllocations = HeapCounter::getThreadAllocations() - allocationsBefore;
+    };
+
+    // ends the capture frame; the run is over after the last one
+    auto captureFrame = [&]()
+    {
+        if (!capture || capture->isFinished())
+            return;
+        capture->frameDone();
+        if (capture->isFinished())
+        {
+            std::cout << "Captured " << capturePath << " (" << capture->getBytesWritten() / 1024 << " KB)" << std::endl;
+            glfwSetWindowShouldClose(window, true);
+        }
+    };
+
+    // draws a snapshot; runs on the thread that owns the GL context
+    auto renderFrame = [&](FrameSnapshot& frame)
+    {
+        long long allocationsBefore = HeapCounter::getThreadAllocations();
+        FrameArena& arena = frameMemory->beginFrame(RENDER_THREAD);
+        double newTime = glfwGetTime();
+        shaderReloader->applyPending();
+        double deltaTime = pacer->beginFrame();
+        RenderSettings& settings = frame.settings;
+        Camera& frameCamera = frame.camera;
+        if (settings.swapInterval != requestedSwapInterval)
+        {
+            requestedSwapInterval = settings.swapInterval;
+            pacer->setSwapInterval(requestedSwapInterval);
+        }
+
+        if (benchmark)
+            ApplyBenchmarkSettings(benchName, benchmark->getMode(), settings);
+
+        int fbWidth = frame.fbWidth, fbHeight = frame.fbHeight;
+        if (fbWidth > 0 && fbHeight > 0)
+        {
+            // benchmarks compare fixed amounts of work
+            dynamicRes->enabled = settings.dynamicResolution && !benchmark;
+            int sceneWidth = dynamicRes->scaledWidth(fbWidth);
+            int sceneHeight = dynamicRes->scaledHeight(fbHeight);
+            sceneTarget->resize(sceneWidth, sceneHeight);
+            hiZ->resize(sceneWidth, sceneHeight);
+        }
+
+        frameTimer->begin();
+
+        // shadows
+        for (int i = 0; i < objectCount; i++)
+        {
+            ShadowCaster& caster = casters[i];
+            caster.model = frame.models[i];
+            caster.center = glm::vec3(caster.model[3]);
+            // the cube spans -1..1, the lengths of the axes are the scale
+            caster.radius = sqrt(glm::dot(glm::vec3(caster.model[0]), glm::vec3(caster.model[0]))
+                + glm::dot(glm::vec3(caster.model[1]), glm::vec3(caster.model[1]))
+                + glm::dot(glm::vec3(caster.model[2]), glm::vec3(caster.model[2])));
+            caster.VAO = positionVAO;
+            caster.vertexCount = verts;
+            caster.moved = animated[i];
+            CubeBounds(caster.model, bounds[i]);
+        }
+        shadowMap->cacheEnabled = settings.shadowCache;
+        shadowMap->update(frameCamera, lightDir, casters);
+        shadowMap->render(casters);
+        UpdatePolygonMode(settings.wireframe);
 
         // render
+        sceneTarget->bind();
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // draw our first triangle
-        polygonShader->use();
-        glm::mat4 pv = camera.GetProjectionMatrix() * camera.GetViewMatrix(); // projection-view-matrix
-
-        // 1
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, polygonTrans1.position);
-        model = glm::rotate(model, glm::radians(polygonTrans1.rotation.x), glm::vec3(1.f, 0.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans1.rotation.y), glm::vec3(0.f, 1.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans1.rotation.z), glm::vec3(0.f, 0.f, 1.f));
-        model = glm::scale(model, polygonTrans1.scale);
-
-        polygonShader->setMatrix4f("pv", pv);
-        polygonShader->setMatrix4f("model", model);
-        polygonShader->setBool("wireframeMode", wireframeMode);
-        polygonShader->setVec3("lightPos", lightPos);
-        polygonShader->setVec3("lightColor", lightColor);
-
-        glBindTexture(GL_TEXTURE_2D, box_texture);
-        //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glDrawArrays(GL_TRIANGLES, 0, verts);
-
-        // 2
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, polygonTrans2.position);
-        model = glm::rotate(model, glm::radians(polygonTrans2.rotation.x), glm::vec3(1.f, 0.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans2.rotation.y), glm::vec3(0.f, 1.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans2.rotation.z), glm::vec3(0.f, 0.f, 1.f));
-        model = glm::scale(model, polygonTrans2.scale);
-
-        polygonShader->setMatrix4f("pv", pv);
-        polygonShader->setMatrix4f("model", model);
-        polygonShader->setBool("wireframeMode", wireframeMode);
-        polygonShader->setVec3("lightPos", lightPos);
-        polygonShader->setVec3("lightColor", lightColor);
-
-        //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glDrawArrays(GL_TRIANGLES, 0, verts);
-
-        // 3
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, polygonTrans3.position);
-        model = glm::rotate(model, glm::radians(polygonTrans3.rotation.x), glm::vec3(1.f, 0.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans3.rotation.y), glm::vec3(0.f, 1.f, 0.f));
-        model = glm::rotate(model, glm::radians(polygonTrans3.rotation.z), glm::vec3(0.f, 0.f, 1.f));
-        model = glm::scale(model, polygonTrans3.scale);
-
-        polygonShader->setMatrix4f("pv", pv);
-        polygonShader->setMatrix4f("model", model);
-        polygonShader->setBool("wireframeMode", wireframeMode);
-        polygonShader->setVec3("lightPos", lightPos);
-        polygonShader->setVec3("lightColor", lightColor);
-
-        //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glDrawArrays(GL_TRIANGLES, 0, verts);
+        glm::mat4 pv = frameCamera.GetViewProjectionMatrix(); // projection-view-matrix
+
+        // frustum culling; batched objects are culled per chunk
+        const Frustum& frustum = frameCamera.GetFrustum();
+        FrameVector<int> inFrustum(arena), phase1(arena), retest(arena), phase2(arena);
+        inFrustum.reserve(objectCount);
+        int individualCount = 0;
+        for (int i = 0; i < objectCount; i++)
+        {
+            if (settings.staticBatching && !animated[i])
+                continue;
+            individualCount++;
+            if (frustum.intersectsBox(bounds[i].center, bounds[i].extent))
+                inFrustum.push_back(i);
+        }
+
+        bool prepass = settings.depthPrepass && !settings.wireframe;
+        depthShader->use();
+        depthShader->setMatrix4f("pv", pv);
+
+        // the variant replaces per fragment branches on the render mode
+        unsigned int features = settings.wireframe ? ShaderVariants::WIREFRAME
+            : ShaderVariants::TEXTURED | (settings.lighting ? ShaderVariants::LIT : 0);
+        Shader* sceneShader = sceneShaders->use(features, settings.uniformBranches);
+        sceneShader->setMatrix4f("pv", pv);
+        sceneShader->setVec3("lightDir", lightDir);
+        sceneShader->setVec3("lightColor", lightColor);
+        shadowMap->apply(*sceneShader, 1);
+
+        int drawCalls = 0;
+        auto drawObjects = [&](const FrameVector<int>& list, GpuQuery* samples, bool withBatch)
+        {
+            withBatch = withBatch && settings.staticBatching;
+            // depth pre-pass: lay down the final depth from the position-only stream,
+            // then shade only the fragments that match it, once per pixel
+            if (prepass)
+            {
+                depthShader->use();
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                glBindVertexArray(positionVAO);
+                for (size_t i = 0; i < list.size(); i++)
+                {
+                    glm::mat4 model = casters[list[i]].model;
+                    depthShader->setMatrix4f("model", model);
+                    glDrawArrays(GL_TRIANGLES, 0, verts);
+                }
+                drawCalls += (int)list.size();
+                if (withBatch)
+                {
+                    // the chunks are already in world space
+                    depthShader->setMatrix4f("model", identity);
+                    drawCalls += staticBatch->drawDepth(frameCamera);
+                }
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_EQUAL);
+            }
+
+            // draw our first triangle
+            sceneShader->use();
+            samples->begin();
+            glBindTexture(GL_TEXTURE_2D_ARRAY, crateTexture);
+            glBindVertexArray(VAO);
+            for (size_t i = 0; i < list.size(); i++)
+            {
+                glm::mat4 model = casters[list[i]].model;
+                sceneShader->setMatrix4f("model", model);
+                // the material layer is a constant attribute, no texture rebinding
+                glVertexAttrib1f(4, objectLayers[list[i]]);
+                glDrawArrays(GL_TRIANGLES, 0, verts);
+            }
+            drawCalls += (int)list.size();
+            if (withBatch)
+            {
+                sceneShader->setMatrix4f("model", identity);
+                drawCalls += staticBatch->draw(frameCamera);
+            }
+            samples->end();
+
+            if (prepass)
+            {
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LESS);
+            }
+        };
+
+        int drawnObjects = 0;
+        if (!settings.occlusionCulling)
+        {
+            drawObjects(inFrustum, shadedSamples[0], true);
+            drawnObjects = (int)inFrustum.size();
+        }
+        else
+        {
+            // phase 1: test against the pyramid of the previous frame, projected with
+            // that frame's matrix, and draw what passes along with the static batches
+            testBoxes.clear();
+            for (size_t i = 0; i < inFrustum.size(); i++)
+                testBoxes.push_back(bounds[inFrustum[i]]);
+            hiZ->test(testBoxes, testResults);
+            phase1.reserve(inFrustum.size());
+            retest.reserve(inFrustum.size());
+            for (size_t i = 0; i < inFrustum.size(); i++)
+                (testResults[i] ? phase1 : retest).push_back(inFrustum[i]);
+            drawObjects(phase1, shadedSamples[0], true);
+
+            // phase 2: the depth of phase 1 becomes the pyramid, the objects phase 1
+            // culled are tested again and the ones that became visible are drawn.
+            // The pyramid stays for phase 1 of the next frame; without the objects
+            // of phase 2 its depth is only farther, so the test stays conservative
+            hiZ->buildPyramid(sceneTarget->getDepthTexture(), pv);
+            testBoxes.clear();
+            for (size_t i = 0; i < retest.size(); i++)
+                testBoxes.push_back(bounds[retest[i]]);
+            hiZ->test(testBoxes, testResults);
+            phase2.reserve(retest.size());
+            for (size_t i = 0; i < retest.size(); i++)
+                if (testResults[i])
+                    phase2.push_back(retest[i]);
+            drawObjects(phase2, shadedSamples[1], false);
+            drawnObjects = (int)(phase1.size() + phase2.size());
+        }
+
+        // instanced meshes with LODs
+        size_t lodTriangles = 0;
+        if (lodMesh)
+        {
+            Shader* instancedShader = sceneShaders->use(features | ShaderVariants::INSTANCED, settings.uniformBranches);
+            instancedShader->setMatrix4f("pv", pv);
+            instancedShader->setVec3("lightDir", lightDir);
+            instancedShader->setVec3("lightColor", lightColor);
+            shadowMap->apply(*instancedShader, 1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, crateTexture);
+            lodMesh->lodEnabled = settings.lod;
+            lodTriangles = lodMesh->draw(lodInstances, frameCamera, sceneTarget->getHeight(), frustum);
+        }
+
+        dynamicRes->present(*sceneTarget, fbWidth, fbHeight);
+        frameTimer->end();
+        dynamicRes->update(frameTimer->getMs());
 
         /* see info about Double Buffer concept */
+        pacer->waitForFrame();
+        latencyMs = (glfwGetTime() - frame.inputTime) * 1000.0; // input to submit
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        captureFrame();
+        resources->endFrame();
+
+        // fragments shaded per pixel of the window
+        GLuint64 samples = shadedSamples[0]->getResult() + (settings.occlusionCulling ? shadedSamples[1]->getResult() : 0);
+        double overdraw = (double)samples / std::max(sceneTarget->getWidth() * sceneTarget->getHeight(), 1);
+        double culled = 100.0 * (individualCount - drawnObjects) / std::max(individualCount, 1);
+        // zero once the frame loop has warmed up; the title below isn't counted
+        long long frameAllocations = frame.simAllocations + HeapCounter::getThreadAllocations() - allocationsBefore;
+
+        if (benchmark)
+        {
+            benchmark->addCounter("overdraw", overdraw);
+            benchmark->addCounter("drawn", drawnObjects);
+            benchmark->addCounter("culled %", culled);
+            benchmark->addCounter("draw calls", drawCalls);
+            benchmark->addCounter("jitter ms", pacer->getJitterMs());
+            benchmark->addCounter("latency ms", latencyMs);
+            benchmark->addCounter("heap allocs", (double)frameAllocations);
+            if (lodMesh)
+                benchmark->addCounter("triangles", (double)lodTriangles);
+            benchmark->frameDone(deltaTime * 1000.0, frameTimer->getMs());
+            if (benchmark->isFinished())
+            {
+                std::cout << (renderThread ? "render thread" : "single thread") << std::endl;
+                benchmark->printReport(std::cout);
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
+
+        // fps and shadow cost per cascade in the title
+        frames++;
+        latencySum += latencyMs;
+        allocationSum += frameAllocations;
+        if (newTime - statsTime >= 1.0)
+        {
+            int steps = simSteps;
+            std::ostringstream title;
+            title.precision(3);
+            title << "LearnOpenGL | " << frames / (newTime - statsTime) << " fps | gpu "
+                << frameTimer->getMs() << "ms | pre-pass " << (prepass ? "on" : "off")
+                << ", overdraw " << overdraw << " | " << (settings.occlusionCulling ? "hi-z" : "frustum")
+                << " culled " << culled << "% | shadows:";
+            for (int i = 0; i < shadowMap->getCascadeCount(); i++)
+            {
+                title << " c" << i << " ";
+                if (shadowMap->getCascade(i).rendered)
+                    title << shadowMap->getCascadeGpuMs(i) << "ms";
+                else
+                    title << "cached";
+            }
+            if (lodMesh)
+                title << " | " << lodTriangles << " triangles, lod " << (settings.lod ? "on" : "off");
+            title << " | " << drawCalls << " draws, static batches ";
+            if (settings.staticBatching)
+                title << staticBatch->getChunkCount();
+            else
+                title << "off";
+            title << " | res " << (int)(dynamicRes->getScale() * 100.f + 0.5f) << "% "
+                << (settings.dynamicResolution ? "auto" : "fixed") << ", gpu " << dynamicRes->getSmoothedMs()
+                << "/" << dynamicRes->budgetMs << "ms";
+            title << " | vsync " << pacer->getSwapInterval() << ", limit ";
+            if (pacer->getTargetFps() > 0.0)
+                title << pacer->getTargetFps();
+            else
+                title << "off";
+            title << ", jitter " << pacer->getJitterMs() << "ms";
+            title << " | shader " << (settings.uniformBranches ? "uniform branches" : "variants");
+            if (shaderReloader->getReloadCount() > 0 || shaderReloader->lastReloadFailed())
+            {
+                title << " | shaders reloaded " << shaderReloader->getReloadCount() << "x, last "
+                    << shaderReloader->getLastReloadMs() << "ms to screen (compile "
+                    << shaderReloader->getLastCompileMs() << "ms)";
+                if (shaderReloader->lastReloadFailed())
+                    title << ", last edit failed";
+            }
+            title << " | " << (renderThread ? "render thread" : "single thread") << ", "
+                << (steps - statsSimSteps) / (newTime - statsTime) << " sim/s, latency "
+                << latencySum / frames << "ms";
+            title << " | heap allocs/frame " << (double)allocationSum / frames << ", frame arena "
+                << arena.getHighWater() / 1024 << " KB";
+            // only the main thread may set the title
+            std::lock_guard<std::mutex> lock(titleMutex);
+            pendingTitle = title.str();
+            frames = 0;
+            latencySum = 0.0;
+            allocationSum = 0;
+            statsSimSteps = steps;
+            statsTime = newTime;
+        }
+    };
+
+    auto updateTitle = [&]()
+    {
+        std::lock_guard<std::mutex> lock(titleMutex);
+        if (!pendingTitle.empty())
+            glfwSetWindowTitle(window, pendingTitle.c_str());
+        pendingTitle.clear();
+    };
+
+    if (!renderThread)
+    {
+        /* simple render loop */
+        while (!glfwWindowShouldClose(window))
+        {
+            simulate(snapshots.writeBuffer());
+            snapshots.publish();
+            snapshots.acquire();
+            renderFrame(snapshots.readBuffer());
+            updateTitle();
+            glfwPollEvents();
+        }
+    }
+    else
+    {
+        // the context moves to the render thread; the simulation of the next
+        // frame overlaps with the submission of the current one
+        glfwMakeContextCurrent(NULL);
+        std::thread renderer([&]()
+        {
+            glfwMakeContextCurrent(window);
+            while (snapshots.acquire())
+                renderFrame(snapshots.readBuffer());
+            glfwMakeContextCurrent(NULL);
+        });
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwPollEvents();
+            simulate(snapshots.writeBuffer());
+            snapshots.publish();
+            // don't run ahead of the renderer, the input would only get older
+            snapshots.waitUntilTaken();
+            updateTitle();
+        }
+        snapshots.close();
+        renderer.join();
+        glfwMakeContextCurrent(window);
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    delete polygonShader;
+    // an unfinished capture keeps the frames it has, without the clean up
+    delete capture;
+    // stop the compiler thread first, it refers to the shaders
+    delete shaderReloader;
+    resources->release(cubeHandle);
+    resources->release(cubePositionHandle);
+    resources->printReport(std::cout);
+    delete resources;
+    delete materials;
+    delete benchmark;
+    delete shadedSamples[0];
+    delete shadedSamples[1];
+    delete hiZ;
+    delete sceneTarget;
+
+    delete frameTimer;
+    delete shadowMap;
+    delete lodMesh;
+    delete staticBatch;
+    delete dynamicRes;
+    delete pacer;
+    delete simClock;
+    delete sceneShaders;
+    delete animationPool;
+    delete frameMemory;
+    // owns the shaders
+    delete shaderManager;
+
 
     /* As soon as we exit the render loop
        we would like to properly clean/delete
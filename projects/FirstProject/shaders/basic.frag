@@ -3,23 +3,46 @@ in vec3 vertColor;
 in vec2 texCoords;
 in vec3 vertNormal;
 in vec3 fragPos; // world position of fragment
+flat in float texLayer;
 out vec4 outColor;
 
-uniform sampler2D ourTexture;
-uniform bool wireframeMode;
-uniform vec3 lightPos;
+uniform sampler2DArray materials; // textures of one size, picked by texLayer
+uniform vec3 lightDir; // directional light, direction the light travels
 uniform vec3 lightColor;
 
-void main()
-{
-	vec3 norm = normalize(vertNormal);
-	vec3 lightDir = normalize(fragPos - lightPos);
+// the features are defines of the variant; the reference program reads them
+// from uniforms and branches on every fragment
+#if UNIFORM_BRANCHES
+uniform bool wireframeMode;
+uniform bool texturedMode;
+uniform bool litMode;
+#else
+const bool wireframeMode = WIREFRAME != 0;
+const bool texturedMode = TEXTURED != 0;
+const bool litMode = LIT != 0;
+#endif
 
-	float diffCoeff = dot(norm, -lightDir);
-	vec3 diffuse = diffCoeff * lightColor;
+#include "shadow.glsl"
 
+void main()
+{
+	// constant conditions, the compiler drops the code of disabled features
 	if (wireframeMode)
+	{
 		outColor = vec4(vertColor, 1.f);
-	else
-		outColor = texture(ourTexture, texCoords) * vec4(diffuse, 1.0);
-}
\ No newline at end of file
+		return;
+	}
+
+	vec4 albedo = texturedMode ? texture(materials, vec3(texCoords, texLayer)) : vec4(vertColor, 1.0);
+	vec3 light = lightColor;
+	if (litMode)
+	{
+		vec3 norm = normalize(vertNormal);
+		float diffCoeff = max(dot(norm, -lightDir), 0.0);
+		vec3 ambient = 0.15 * lightColor;
+		vec3 diffuse = diffCoeff * shadowFactor() * lightColor;
+		light = ambient + diffuse;
+	}
+
+	outColor = albedo * vec4(light, 1.0);
+}
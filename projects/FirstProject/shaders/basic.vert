@@ -3,20 +3,37 @@ layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec2 inTexCoords;
 layout (location = 3) in vec3 inColors;
+#if INSTANCED
+layout (location = 4) in mat4 instanceModel; // takes locations 4..7
+layout (location = 8) in float inLayer;
+#else
+layout (location = 4) in float inLayer; // material layer; a constant attribute for single objects
+#endif
 out vec3 vertColor;
 out vec2 texCoords;
 out vec3 vertNormal;
 out vec3 fragPos;
+flat out float texLayer;
 
 uniform mat4 pv;
+#if !INSTANCED
 uniform mat4 model;
+#endif
+
+// the depth pre-pass (depth_only.vert) must produce the same depth
+invariant gl_Position;
+
 
 void main()
 {
+#if INSTANCED
+	mat4 model = instanceModel;
+#endif
 	vec4 vertPos = model * vec4(inPos, 1.0);
     gl_Position = pv * vertPos;
     vertColor = inColors;
     texCoords = inTexCoords;
     vertNormal = mat3(model) * inNormal;
     fragPos = vertPos.xyz;
+    texLayer = inLayer;
 };
\ No newline at end of file
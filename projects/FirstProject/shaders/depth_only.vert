@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 inPos;
+
+uniform mat4 pv;
+uniform mat4 model;
+
+// must give bit-exact depth with basic.vert for the GL_EQUAL color pass
+invariant gl_Position;
+
+void main()
+{
+	vec4 vertPos = model * vec4(inPos, 1.0);
+    gl_Position = pv * vertPos;
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 330 core
+
+// never runs: the culling pass is drawn with GL_RASTERIZER_DISCARD
+void main()
+{
+}
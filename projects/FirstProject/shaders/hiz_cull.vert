@@ -0,0 +1,47 @@
+#version 330 core
+layout (location = 0) in vec3 boxCenter;
+layout (location = 1) in vec3 boxExtent;
+flat out int visible; // captured with transform feedback
+
+uniform mat4 pv;
+uniform sampler2D hiZ;
+uniform vec2 hiZSize; // size of level 0
+uniform int hiZLevels;
+
+void main()
+{
+	// screen rectangle and nearest depth of the box
+	vec3 ndcMin = vec3(1.0);
+	vec3 ndcMax = vec3(-1.0);
+	for (int i = 0; i < 8; ++i)
+	{
+		vec3 corner = boxCenter + boxExtent * vec3(
+			(i & 1) != 0 ? 1.0 : -1.0,
+			(i & 2) != 0 ? 1.0 : -1.0,
+			(i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = pv * vec4(corner, 1.0);
+		// crosses the camera plane - can't say anything
+		if (clip.w <= 0.0)
+		{
+			visible = 1;
+			return;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+	vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+	float nearest = ndcMin.z * 0.5 + 0.5;
+
+	// the level where the rectangle is at most one texel big,
+	// so the 4 texels under its corners cover it
+	vec2 size = (uvMax - uvMin) * hiZSize;
+	float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+	level = min(level, float(hiZLevels - 1));
+
+	float farthest = max(
+		max(textureLod(hiZ, uvMin, level).r, textureLod(hiZ, vec2(uvMax.x, uvMin.y), level).r),
+		max(textureLod(hiZ, vec2(uvMin.x, uvMax.y), level).r, textureLod(hiZ, uvMax, level).r));
+	visible = nearest <= farthest ? 1 : 0;
+}
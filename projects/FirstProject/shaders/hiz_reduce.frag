@@ -0,0 +1,27 @@
+#version 330 core
+out float maxDepth;
+
+uniform sampler2D source; // depth buffer or the previous pyramid level
+uniform int sourceWidth;
+uniform int sourceHeight;
+uniform int targetWidth;  // the level being written
+uniform int targetHeight;
+
+// every texel keeps the farthest depth of the source texels it covers. The
+// levels of the pyramid halve exactly, but level 0 is rounded up to a power
+// of two, so a texel of it may cover 1 to 3 depth texels in each direction.
+void main()
+{
+	ivec2 dst = ivec2(gl_FragCoord.xy);
+	ivec2 sourceSize = ivec2(sourceWidth, sourceHeight);
+	ivec2 targetSize = ivec2(targetWidth, targetHeight);
+	ivec2 first = dst * sourceSize / targetSize;
+	ivec2 end = ((dst + 1) * sourceSize + targetSize - 1) / targetSize;
+	ivec2 last = sourceSize - 1;
+
+	float depth = 0.0;
+	for (int y = first.y; y < end.y; ++y)
+		for (int x = first.x; x < end.x; ++x)
+			depth = max(depth, texelFetch(source, min(ivec2(x, y), last), 0).r);
+	maxDepth = depth;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+in vec3 vertNormal;
+out vec4 outColor;
+
+void main()
+{
+	vec3 lightDir = normalize(vec3(0.3, 1.0, 0.5));
+	float diffuse = max(dot(normalize(vertNormal), lightDir), 0.0);
+	outColor = vec4(vec3(0.15) + vec3(0.8, 0.75, 0.7) * diffuse, 1.0);
+}
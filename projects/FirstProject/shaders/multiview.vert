@@ -0,0 +1,38 @@
+#version 330 core
+// VERTEX_LAYER: 0 none, 1 ARB_shader_viewport_layer_array, 2 AMD_vertex_shader_layer
+#if VERTEX_LAYER == 1
+#extension GL_ARB_shader_viewport_layer_array : require
+#elif VERTEX_LAYER == 2
+#extension GL_AMD_vertex_shader_layer : require
+#endif
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+
+uniform mat4 views[MAX_VIEWS]; // projection * view of every camera
+uniform mat4 model;
+// the pass per view draws only views[viewIndex]
+uniform int viewIndex;
+
+#if GEOMETRY_LAYER
+// the geometry shader projects into the views, gl_Position stays in world space
+out vec3 geomNormal;
+#else
+out vec3 vertNormal;
+#endif
+
+void main()
+{
+	vec4 worldPos = model * vec4(inPos, 1.0);
+#if GEOMETRY_LAYER
+	gl_Position = worldPos;
+	geomNormal = mat3(model) * inNormal;
+#elif VERTEX_LAYER
+	// an instance per view
+	gl_Position = views[gl_InstanceID] * worldPos;
+	gl_Layer = gl_InstanceID;
+	vertNormal = mat3(model) * inNormal;
+#else
+	gl_Position = views[viewIndex] * worldPos;
+	vertNormal = mat3(model) * inNormal;
+#endif
+}
@@ -0,0 +1,38 @@
+// cascaded shadow map lookup, needs fragPos
+#define MAX_CASCADES 4
+
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpaceMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform int cascadeCount;
+uniform vec3 shadowCameraPos;
+uniform vec3 shadowCameraFront;
+
+float shadowFactor()
+{
+	float viewDepth = dot(fragPos - shadowCameraPos, shadowCameraFront);
+	int cascade = cascadeCount;
+	for (int i = 0; i < cascadeCount; ++i)
+	{
+		if (viewDepth < cascadeSplits[i])
+		{
+			cascade = i;
+			break;
+		}
+	}
+	if (cascade == cascadeCount)
+		return 1.0;
+
+	vec4 lightSpacePos = lightSpaceMatrices[cascade] * vec4(fragPos, 1.0);
+	vec3 proj = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+	if (proj.z > 1.0)
+		return 1.0;
+
+	// 3x3 PCF on top of the hardware 2x2 filter
+	vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+	float lit = 0.0;
+	for (int x = -1; x <= 1; ++x)
+		for (int y = -1; y <= 1; ++y)
+			lit += texture(shadowMap, vec4(proj.xy + vec2(x, y) * texel, float(cascade), proj.z));
+	return lit / 9.0;
+}
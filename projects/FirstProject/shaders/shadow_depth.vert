@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 inPos;
+
+uniform mat4 lightSpace;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = lightSpace * model * vec4(inPos, 1.0);
+}
\ No newline at end of file
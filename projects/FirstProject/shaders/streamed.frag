@@ -0,0 +1,10 @@
+#version 330 core
+in vec2 texCoords;
+out vec4 outColor;
+
+uniform sampler2D source; // only the levels the object's size on screen needs are resident
+
+void main()
+{
+	outColor = texture(source, texCoords);
+}
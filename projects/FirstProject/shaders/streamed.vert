@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec2 inTexCoords;
+out vec2 texCoords;
+
+uniform mat4 pv;
+uniform mat4 model;
+
+void main()
+{
+	gl_Position = pv * model * vec4(inPos, 1.0);
+	texCoords = inTexCoords;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+in vec2 texCoords;
+out vec4 outColor;
+
+uniform sampler2D source;   // the scene at the reduced resolution
+uniform float sharpness;    // 0..1
+
+// bilinear upscale followed by an unsharp mask in source texels; the result is
+// clamped to the local min/max so edges don't get halos
+void main()
+{
+	vec2 texel = 1.0 / vec2(textureSize(source, 0));
+	vec3 center = texture(source, texCoords).rgb;
+	vec3 left = texture(source, texCoords - vec2(texel.x, 0.0)).rgb;
+	vec3 right = texture(source, texCoords + vec2(texel.x, 0.0)).rgb;
+	vec3 down = texture(source, texCoords - vec2(0.0, texel.y)).rgb;
+	vec3 up = texture(source, texCoords + vec2(0.0, texel.y)).rgb;
+
+	vec3 minColor = min(center, min(min(left, right), min(down, up)));
+	vec3 maxColor = max(center, max(max(left, right), max(down, up)));
+	vec3 blur = (left + right + down + up) * 0.25;
+	vec3 sharpened = center + (center - blur) * sharpness * 2.0;
+	outColor = vec4(clamp(sharpened, minColor, maxColor), 1.0);
+}